@@ -1,58 +1,389 @@
 #include <soul/ecs.h>
+#include <soul/ecs_commands.h>
 #include <soul/json.h>
 #include <soul/file.h>
 #include <soul/debug.h>
 #include <soul/callbacks.h>
+#include <soul/math/macros.h>
 
-static void destroy_component_instance(struct entity *entity, struct component_reference ref)
+struct entity_array
+{
+    struct entity **    entities;
+    int                 count;
+    int                 capacity;
+};
+
+struct doomed_component
+{
+    struct entity *                 entity;
+    struct component_reference *    ref;
+};
+
+static void entity_array_push(struct entity_array *array, struct entity *entity)
+{
+    if (array->count == array->capacity) {
+        array->capacity = max(array->capacity*2, 64);
+        array->entities = realloc(array->entities, array->capacity*sizeof(struct entity *));
+    }
+
+    array->entities[array->count++] = entity;
+}
+
+static struct string create_name(struct context *context, const char *name)
+{
+    size_t length = strlen(name);
+
+    char *chars = (length < ECS_CONTEXT_NAME_SIZE) ?
+                  pool_alloc(&context->name_pool) :
+                  malloc(length + 1);
+
+    memcpy(chars, name, length + 1);
+
+    return (struct string){ chars, length };
+}
+
+static void destroy_name(struct context *context, struct string name)
+{
+    if (name.length < ECS_CONTEXT_NAME_SIZE)
+        pool_free(&context->name_pool, name.chars);
+    else
+        free(name.chars);
+}
+
+// FNV-1a
+static uint32_t hash_name(const char *chars, size_t length)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ (unsigned char)chars[i])*16777619u;
+    }
+
+    return hash;
+}
+
+static uint32_t hash_child(struct entity *parent, uint32_t name_hash)
+{
+    uint64_t key = (uintptr_t)parent;
+
+    key ^= key >> 33;
+    key *= UINT64_C(0xff51afd7ed558ccd);
+    key ^= key >> 33;
+
+    return name_hash ^ (uint32_t)key;
+}
+
+static void link_name(struct context *context, struct entity *entity)
+{
+    uint32_t mask = context->bucket_count - 1;
+
+    struct entity **name_bucket = context->name_buckets + (entity->name_hash & mask);
+    struct entity **child_bucket = context->child_buckets +
+                                   (hash_child(entity->parent, entity->name_hash) & mask);
+
+    entity->next_by_name    = *name_bucket;
+    entity->next_by_child   = *child_bucket;
+    *name_bucket            = entity;
+    *child_bucket           = entity;
+}
+
+static void unlink_name(struct context *context, struct entity *entity)
+{
+    uint32_t mask = context->bucket_count - 1;
+
+    struct entity **p_entity = context->name_buckets + (entity->name_hash & mask);
+
+    while (*p_entity != entity) {
+        p_entity = &(*p_entity)->next_by_name;
+    }
+
+    *p_entity = entity->next_by_name;
+
+    p_entity = context->child_buckets + (hash_child(entity->parent, entity->name_hash) & mask);
+
+    while (*p_entity != entity) {
+        p_entity = &(*p_entity)->next_by_child;
+    }
+
+    *p_entity = entity->next_by_child;
+}
+
+/*
+ * Rebuilding walks the context's entity list, which already holds an entity being created, so
+ * that entity gets linked by the rebuild itself.
+ */
+static void index_name(struct context *context, struct entity *entity)
+{
+    entity->name_hash = hash_name(entity->name.chars, entity->name.length);
+
+    if (context->entity_count <= context->bucket_count) {
+        link_name(context, entity);
+        return;
+    }
+
+    free(context->name_buckets);
+    free(context->child_buckets);
+
+    context->bucket_count   = max(context->bucket_count*2, ECS_NAME_INDEX_MIN_BUCKETS);
+    context->name_buckets   = calloc(context->bucket_count, sizeof(struct entity *));
+    context->child_buckets  = calloc(context->bucket_count, sizeof(struct entity *));
+
+    list_for_each (struct entity, indexed, context->entities) {
+        link_name(context, indexed);
+    }
+}
+
+static struct pool *get_component_pool(struct context *context,
+                                       struct component_descriptor *descriptor,
+                                       int kind)
+{
+    struct pool *pool = &context->component_pools[descriptor->type_id][kind];
+
+    if (!pool->block_size) {
+        struct list *storage = (kind == ECS_STORAGE_ACTIVE) ?
+                               &descriptor->active_storage :
+                               &descriptor->passive_storage;
+
+        pool_init(pool, list_node_size(storage->data_size), ECS_CONTEXT_POOL_CHUNK_BLOCKS);
+    }
+
+    return pool;
+}
+
+/*
+ * Component storage is listed by its descriptor, so systems can walk every instance of a type,
+ * but the nodes themselves belong to the context of the entity holding them.
+ */
+static void *alloc_storage(struct context *context,
+                           struct component_descriptor *descriptor,
+                           int kind)
+{
+    struct list *storage = (kind == ECS_STORAGE_ACTIVE) ?
+                           &descriptor->active_storage :
+                           &descriptor->passive_storage;
+
+    if (!storage->data_size)
+        return 0;
+
+    return list_append_node(storage, pool_alloc(get_component_pool(context, descriptor, kind)));
+}
+
+static void unlink_storage(struct component_descriptor *descriptor,
+                           struct component_storage storage)
+{
+    if (storage.active)
+        list_unlink(&descriptor->active_storage, storage.active);
+
+    if (storage.passive)
+        list_unlink(&descriptor->passive_storage, storage.passive);
+}
+
+static void free_storage(struct context *context,
+                         struct component_descriptor *descriptor,
+                         struct component_storage storage)
+{
+    unlink_storage(descriptor, storage);
+
+    if (storage.active) {
+        pool_free(
+            &context->component_pools[descriptor->type_id][ECS_STORAGE_ACTIVE],
+            list_node_from_data(storage.active)
+        );
+    }
+
+    if (storage.passive) {
+        pool_free(
+            &context->component_pools[descriptor->type_id][ECS_STORAGE_PASSIVE],
+            list_node_from_data(storage.passive)
+        );
+    }
+}
+
+static void destroy_component_instance(struct ecs_service *ecs,
+                                       struct entity *entity,
+                                       struct component_reference ref)
 {
     if (ref.descriptor->cleanup)
         ref.descriptor->cleanup(entity, ref.storage, ref.descriptor->callback_data);
 
-    if (ref.descriptor->active_storage.data_size)
-        list_remove(&ref.descriptor->active_storage, ref.storage.active);
+    ++ecs->structure_version;
 
-    if (ref.descriptor->passive_storage.data_size)
-        list_remove(&ref.descriptor->passive_storage, ref.storage.passive);
+    free_storage(entity->context, ref.descriptor, ref.storage);
 }
 
-static void cleanup_entity(struct ecs_service *ecs, struct entity *entity)
+static void init_context_storage(struct context *context)
 {
-    string_destroy(entity->name);
-    list_remove(&ecs->transforms, entity->transform);
+    pool_init(
+        &context->entity_pool,
+        list_node_size(sizeof(struct entity)),
+        ECS_CONTEXT_POOL_CHUNK_BLOCKS
+    );
+    pool_init(
+        &context->transform_pool,
+        list_node_size(sizeof(struct transform)),
+        ECS_CONTEXT_POOL_CHUNK_BLOCKS
+    );
+    pool_init(
+        &context->reference_pool,
+        list_node_size(sizeof(struct component_reference)),
+        ECS_CONTEXT_POOL_CHUNK_BLOCKS
+    );
+    pool_init(
+        &context->child_pool,
+        list_node_size(sizeof(struct entity *)),
+        ECS_CONTEXT_POOL_CHUNK_BLOCKS
+    );
+    pool_init(&context->name_pool, ECS_CONTEXT_NAME_SIZE, ECS_CONTEXT_POOL_CHUNK_BLOCKS);
 
-    list_for_each (struct component_reference, ref, entity->components) {
-        destroy_component_instance(entity, *ref);
+    // Component pools are set up on first use, since most contexts only hold a few types.
+    memset(context->component_pools, 0, sizeof(context->component_pools));
+
+    list_init_pooled(&context->entities, sizeof(struct entity), &context->entity_pool);
+    list_init_pooled(&context->transforms, sizeof(struct transform), &context->transform_pool);
+
+    context->entity_count   = 0;
+    context->name_buckets   = 0;
+    context->child_buckets  = 0;
+    context->bucket_count   = 0;
+}
+
+static void destroy_context_storage(struct context *context)
+{
+    pool_destroy(&context->entity_pool);
+    pool_destroy(&context->transform_pool);
+    pool_destroy(&context->reference_pool);
+    pool_destroy(&context->child_pool);
+    pool_destroy(&context->name_pool);
+
+    for (int i = 0; i < ECS_MAX_COMPONENT_TYPES; ++i) {
+        pool_destroy(&context->component_pools[i][ECS_STORAGE_ACTIVE]);
+        pool_destroy(&context->component_pools[i][ECS_STORAGE_PASSIVE]);
     }
 
-    list_destroy(&entity->children);
-    list_destroy(&entity->components);
+    free(context->name_buckets);
+    free(context->child_buckets);
+}
+
+/*
+ * Cleanup callbacks run type by type over the whole batch, and storage is only released once
+ * they have all returned, so a callback may still look at components of other doomed entities.
+ * Storage nodes are only unlinked when their context is about to drop its pools anyway.
+ */
+static void destroy_doomed_components(struct ecs_service *ecs,
+                                      struct entity_array *doomed,
+                                      bool_t release_storage)
+{
+    int offsets[ECS_MAX_COMPONENT_TYPES + 1] = { 0 };
+
+    for (int i = 0; i < doomed->count; ++i) {
+        list_for_each (struct component_reference, ref, doomed->entities[i]->components) {
+            ++offsets[ref->descriptor->type_id + 1];
+        }
+    }
+
+    for (int i = 0; i < ECS_MAX_COMPONENT_TYPES; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    int total = offsets[ECS_MAX_COMPONENT_TYPES];
+
+    if (!total)
+        return;
+
+    struct doomed_component *components = malloc(total*sizeof(struct doomed_component));
+
+    for (int i = 0; i < doomed->count; ++i) {
+        list_for_each (struct component_reference, ref, doomed->entities[i]->components) {
+            components[offsets[ref->descriptor->type_id]++] = (struct doomed_component){
+                doomed->entities[i],
+                ref
+            };
+        }
+    }
+
+    for (int i = 0; i < total; ++i) {
+        struct component_descriptor *descriptor = components[i].ref->descriptor;
+
+        if (descriptor->cleanup) {
+            descriptor->cleanup(
+                components[i].entity,
+                components[i].ref->storage,
+                descriptor->callback_data
+            );
+        }
+    }
+
+    for (int i = 0; i < total; ++i) {
+        struct component_reference *ref = components[i].ref;
+
+        if (release_storage)
+            free_storage(components[i].entity->context, ref->descriptor, ref->storage);
+        else
+            unlink_storage(ref->descriptor, ref->storage);
+    }
+
+    free(components);
+
+    ++ecs->structure_version;
+}
+
+/*
+ * Destroys every entity in the context, then drops its pools whole instead of freeing each
+ * entity's allocations one by one.
+ */
+static void release_context_entities(struct ecs_service *ecs, struct context *context)
+{
+    struct entity_array doomed = { 0 };
+
+    list_for_each (struct entity, entity, context->entities) {
+        entity->destroying = TRUE;
+        entity_array_push(&doomed, entity);
+    }
+
+    destroy_doomed_components(ecs, &doomed, FALSE);
+
+    for (int i = 0; i < doomed.count; ++i) {
+        struct entity *entity = doomed.entities[i];
+
+        slot_map_remove(&ecs->entity_slots, entity->handle);
+        free(entity->component_table);
+
+        if (entity->name.length >= ECS_CONTEXT_NAME_SIZE)
+            free(entity->name.chars);
+    }
+
+    free(doomed.entities);
+
+    destroy_context_storage(context);
+    init_context_storage(context);
 }
 
 static void cleanup_context(struct ecs_service *ecs, struct context *context)
 {
+    release_context_entities(ecs, context);
+    destroy_context_storage(context);
+
     string_destroy(context->name);
 }
 
 static void cleanup_component_descriptor(struct ecs_service *ecs,
                                          struct component_descriptor *descriptor)
 {
-    if (descriptor->active_storage.data_size)
-        list_destroy(&descriptor->active_storage);
-
-    if (descriptor->passive_storage.data_size)
-        list_destroy(&descriptor->passive_storage);
-
+    // Storage nodes belong to contexts, which have all been cleaned up by now.
     string_destroy(descriptor->name);
 
     string_map_destroy(&descriptor->properties);
 }
 
+static void cleanup_query(struct ecs_query *query)
+{
+    free(query->entities);
+    free(query->storages);
+}
+
 static void deallocate_service(struct ecs_service *ecs)
 {
-    list_for_each (struct entity, entity, ecs->entities) {
-        cleanup_entity(ecs, entity);
-    }
+    ecs_commands_destroy(ecs);
 
     list_for_each (struct context, context, ecs->contexts) {
         cleanup_context(ecs, context);
@@ -62,11 +393,17 @@ static void deallocate_service(struct ecs_service *ecs)
         cleanup_component_descriptor(ecs, descriptor);
     }
 
+    list_for_each (struct ecs_query, query, ecs->queries) {
+        cleanup_query(query);
+    }
+
+    list_destroy(&ecs->queries);
     list_destroy(&ecs->components);
+
+    string_map_destroy(&ecs->component_names);
     list_destroy(&ecs->contexts);
-    list_destroy(&ecs->entities);
-    list_destroy(&ecs->transforms);
 
+    slot_map_destroy(&ecs->entity_slots);
     string_map_destroy(&ecs->property_serializers);
 }
 
@@ -81,12 +418,27 @@ void ecs_service_create_resource(struct soul_instance *instance)
 
     list_init(&ecs->components, sizeof(struct component_descriptor));
     list_init(&ecs->contexts, sizeof(struct context));
-    list_init(&ecs->entities, sizeof(struct entity));
-    list_init(&ecs->transforms, sizeof(struct transform));
+    list_init(&ecs->queries, sizeof(struct ecs_query));
+
+    string_map_init(&ecs->component_names, sizeof(struct component_descriptor *));
+    slot_map_init(&ecs->entity_slots, sizeof(struct entity *));
 
     ecs->default_context = context_create(ecs, "default");
 
     string_map_init(&ecs->property_serializers, sizeof(struct property_serializer));
+
+    ecs_commands_init(ecs, instance);
+}
+
+static struct context *resolve_context(struct ecs_service *ecs,
+                                       struct context *context,
+                                       struct entity *parent)
+{
+    // Children always live in their parent's context, so a subtree never spans two of them.
+    if (parent)
+        return parent->context;
+
+    return (context) ? context : ecs->default_context;
 }
 
 struct entity *entity_create(struct ecs_service *ecs,
@@ -94,50 +446,216 @@ struct entity *entity_create(struct ecs_service *ecs,
                              struct context *context,
                              struct entity *parent)
 {
-    struct entity *entity = list_alloc(&ecs->entities);
+    context = resolve_context(ecs, context, parent);
+
+    struct entity *entity = list_alloc(&context->entities);
 
-    struct transform *transform = list_alloc(&ecs->transforms);
+    struct transform *transform = list_alloc(&context->transforms);
 
     entity->parent      = parent;
+    entity->context     = context;
     entity->transform   = transform;
-    entity->name        = string_create(name);
+    entity->name        = create_name(context, name);
+    entity->handle      = slot_map_insert(&ecs->entity_slots, &entity);
 
-    if (entity->parent)
-        entity->context = entity->parent->context;
-    else
-        entity->context = (context) ? context : ecs->default_context;
+    ++context->entity_count;
 
-    entity->transform->scale = VEC3F_ONE;
+    index_name(context, entity);
+
+    entity->transform->rotation = QUAT_IDENTITY;
+    entity->transform->scale    = VEC3F_ONE;
 
     if (parent)
-        list_push(&parent->children, &entity);
+        entity->parent_link = list_push(&parent->children, &entity);
 
-    list_init(&entity->components, sizeof(struct component_reference));
-    list_init(&entity->children, sizeof(struct enitity *));
+    list_init_pooled(
+        &entity->components,
+        sizeof(struct component_reference),
+        &context->reference_pool
+    );
+    list_init_pooled(&entity->children, sizeof(struct entity *), &context->child_pool);
 
     return entity;
 }
 
-void entity_destroy(struct ecs_service *ecs, struct entity *entity)
+/*
+ * Every allocation the batch needs is reserved up front, so creating it takes at most one new
+ * chunk per pool.
+ */
+void entity_create_batch(struct ecs_service *ecs,
+                         const char **names,
+                         int count,
+                         struct context *context,
+                         struct entity *parent,
+                         struct entity **entities)
+{
+    context = resolve_context(ecs, context, parent);
+
+    pool_reserve(&context->entity_pool, count);
+    pool_reserve(&context->transform_pool, count);
+    slot_map_reserve(&ecs->entity_slots, count);
+
+    if (parent)
+        pool_reserve(&context->child_pool, count);
+
+    for (int i = 0; i < count; ++i) {
+        entities[i] = entity_create(ecs, names[i], context, parent);
+    }
+}
+
+// Entities already being destroyed are skipped, so overlapping subtrees are only visited once.
+static void doom_recursive(struct entity_array *doomed, struct entity *entity)
+{
+    if (entity->destroying)
+        return;
+
+    entity->destroying = TRUE;
+    entity_array_push(doomed, entity);
+
+    list_for_each (struct entity *, p_child, entity->children) {
+        doom_recursive(doomed, *p_child);
+    }
+}
+
+static void release_entity(struct ecs_service *ecs, struct entity *entity)
+{
+    struct context *context = entity->context;
+
+    unlink_name(context, entity);
+    destroy_name(context, entity->name);
+    list_remove(&context->transforms, entity->transform);
+    slot_map_remove(&ecs->entity_slots, entity->handle);
+
+    list_destroy(&entity->children);
+    list_destroy(&entity->components);
+
+    free(entity->component_table);
+
+    list_remove(&context->entities, entity);
+    --context->entity_count;
+}
+
+void entity_destroy_batch(struct ecs_service *ecs, struct entity **entities, int count)
 {
-    list_for_each (struct entity *, p_entity, entity->children) {
-        entity_destroy(ecs, *p_entity);
+    struct entity_array doomed = { 0 };
+
+    for (int i = 0; i < count; ++i) {
+        doom_recursive(&doomed, entities[i]);
+    }
+
+    // Only the roots of the batch have a surviving parent to unlink from, and their node is
+    // known, so no children list is ever searched.
+    for (int i = 0; i < doomed.count; ++i) {
+        struct entity *entity = doomed.entities[i];
+
+        if (entity->parent && !entity->parent->destroying)
+            list_remove(&entity->parent->children, entity->parent_link);
     }
 
-    if (entity->parent) {
-        list_remove_value(&entity->parent->children, &entity);
+    destroy_doomed_components(ecs, &doomed, TRUE);
+
+    for (int i = 0; i < doomed.count; ++i) {
+        release_entity(ecs, doomed.entities[i]);
+    }
+
+    free(doomed.entities);
+}
+
+void entity_destroy(struct ecs_service *ecs, struct entity *entity)
+{
+    entity_destroy_batch(ecs, &entity, 1);
+}
+
+static int get_table_index(struct entity *entity, int type_id)
+{
+    uint64_t lower = entity->component_mask & ((UINT64_C(1) << type_id) - 1);
+
+    return __builtin_popcountll(lower);
+}
+
+static void table_insert(struct entity *entity, int type_id, struct component_storage storage)
+{
+    // Later instances of a type already on the entity are only reachable through the list.
+    if (entity_has_component(entity, type_id))
+        return;
+
+    int count = __builtin_popcountll(entity->component_mask);
+    int index = get_table_index(entity, type_id);
+
+    entity->component_table = realloc(
+        entity->component_table,
+        (count + 1)*sizeof(struct component_storage)
+    );
+
+    memmove(
+        entity->component_table + index + 1,
+        entity->component_table + index,
+        (count - index)*sizeof(struct component_storage)
+    );
+
+    entity->component_table[index] = storage;
+    entity->component_mask |= UINT64_C(1) << type_id;
+}
+
+static void table_remove(struct entity *entity, struct component_reference *removed)
+{
+    int type_id = removed->descriptor->type_id;
+    int index = get_table_index(entity, type_id);
+
+    struct component_storage *entry = entity->component_table + index;
+
+    if (entry->active != removed->storage.active || entry->passive != removed->storage.passive)
+        return;
+
+    list_for_each (struct component_reference, ref, entity->components) {
+        if (ref != removed && ref->descriptor == removed->descriptor) {
+            *entry = ref->storage;
+            return;
+        }
     }
 
-    cleanup_entity(ecs, entity);
-    list_remove(&ecs->entities, entity);
+    int count = __builtin_popcountll(entity->component_mask);
+
+    memmove(
+        entity->component_table + index,
+        entity->component_table + index + 1,
+        (count - index - 1)*sizeof(struct component_storage)
+    );
+
+    entity->component_mask &= ~(UINT64_C(1) << type_id);
+}
+
+struct entity *entity_resolve(struct ecs_service *ecs, entity_handle_t handle)
+{
+    struct entity **p_entity = slot_map_get(&ecs->entity_slots, handle);
+
+    return p_entity ? *p_entity : 0;
+}
+
+bool_t entity_is_valid(struct ecs_service *ecs, entity_handle_t handle)
+{
+    return slot_map_valid(&ecs->entity_slots, handle);
+}
+
+bool_t entity_destroy_handle(struct ecs_service *ecs, entity_handle_t handle)
+{
+    struct entity *entity = entity_resolve(ecs, handle);
+
+    if (!entity)
+        return FALSE;
+
+    entity_destroy(ecs, entity);
+
+    return TRUE;
 }
 
-static struct component_storage alloc_component(struct component_descriptor *descriptor,
+static struct component_storage alloc_component(struct ecs_service *ecs,
+                                                struct component_descriptor *descriptor,
                                                 struct entity *entity)
 {
     struct component_storage storage = {
-        (descriptor->active_storage.data_size) ? list_alloc(&descriptor->active_storage) : 0,
-        (descriptor->passive_storage.data_size) ? list_alloc(&descriptor->passive_storage) : 0,
+        alloc_storage(entity->context, descriptor, ECS_STORAGE_ACTIVE),
+        alloc_storage(entity->context, descriptor, ECS_STORAGE_PASSIVE)
     };
 
     struct component_reference ref = {
@@ -146,6 +664,9 @@ static struct component_storage alloc_component(struct component_descriptor *des
     };
 
     list_push(&entity->components, &ref);
+    table_insert(entity, descriptor->type_id, storage);
+
+    ++ecs->structure_version;
 
     return storage;
 }
@@ -205,7 +726,7 @@ static void parse_component_json(struct ecs_service *ecs,
     }
 #endif // DEBUG
 
-    struct component_storage instance = alloc_component(descriptor, entity);
+    struct component_storage instance = alloc_component(ecs, descriptor, entity);
 
     struct json_object *properties = json_index_object(component, "properties");
     if (properties)
@@ -392,17 +913,86 @@ struct entity *entity_load(struct ecs_service *ecs,
 
 void entity_set_name(struct entity *entity, const char *name)
 {
-    string_destroy(entity->name);
-    entity->name = string_create(name);
+    unlink_name(entity->context, entity);
+    destroy_name(entity->context, entity->name);
+
+    entity->name = create_name(entity->context, name);
+
+    index_name(entity->context, entity);
 }
 
-struct entity *entity_find_child_recursive(struct entity *entity, const char *child)
+static bool_t name_matches(struct entity *entity, uint32_t hash, const char *chars, size_t length)
+{
+    return entity->name_hash == hash &&
+           entity->name.length == length &&
+           memcmp(entity->name.chars, chars, length) == 0;
+}
+
+// First match in child order, with a null parent standing for the context's root entities.
+static struct entity *find_child_linear(struct context *context,
+                                        struct entity *parent,
+                                        uint32_t hash,
+                                        const char *chars,
+                                        size_t length)
+{
+    if (parent) {
+        list_for_each (struct entity *, p_child, parent->children) {
+            if (name_matches(*p_child, hash, chars, length))
+                return *p_child;
+        }
+    } else {
+        list_for_each (struct entity, entity, context->entities) {
+            if (!entity->parent && name_matches(entity, hash, chars, length))
+                return entity;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Siblings sharing a name are rare, so when the index finds more than one the children are
+ * scanned instead, keeping the first in child order as the answer.
+ */
+static struct entity *find_child(struct context *context,
+                                 struct entity *parent,
+                                 const char *chars,
+                                 size_t length)
+{
+    if (!context->bucket_count)
+        return 0;
+
+    uint32_t hash = hash_name(chars, length);
+    uint32_t bucket = hash_child(parent, hash) & (context->bucket_count - 1);
+
+    struct entity *found = 0;
+    struct entity *entity = context->child_buckets[bucket];
+
+    for (; entity; entity = entity->next_by_child) {
+        if (entity->parent != parent || !name_matches(entity, hash, chars, length))
+            continue;
+
+        if (found)
+            return find_child_linear(context, parent, hash, chars, length);
+
+        found = entity;
+    }
+
+    return found;
+}
+
+struct entity *entity_find_child(struct entity *entity, const char *child)
+{
+    return find_child(entity->context, entity, child, strlen(child));
+}
+
+static struct entity *find_child_recursive_walk(struct entity *entity, const char *child)
 {
     list_for_each (struct entity *, p_child, entity->children) {
         if (string_eq_ptr(child, (*p_child)->name.chars)) {
             return *p_child;
         } else {
-            struct entity *entity = entity_find_child_recursive(*p_child, child);
+            struct entity *entity = find_child_recursive_walk(*p_child, child);
             if (entity)
                 return entity;
         }
@@ -411,6 +1001,135 @@ struct entity *entity_find_child_recursive(struct entity *entity, const char *ch
     return 0;
 }
 
+static bool_t is_descendant(struct entity *entity, struct entity *ancestor)
+{
+    for (entity = entity->parent; entity; entity = entity->parent) {
+        if (entity == ancestor)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/*
+ * Candidates come from the context's name index. Only when several of them sit under the entity
+ * is the subtree walked, so the first match in depth first order is still the one returned.
+ */
+struct entity *entity_find_child_recursive(struct entity *entity, const char *child)
+{
+    struct context *context = entity->context;
+
+    size_t length = strlen(child);
+    uint32_t hash = hash_name(child, length);
+
+    struct entity *found = 0;
+    struct entity *candidate = context->name_buckets[hash & (context->bucket_count - 1)];
+
+    for (; candidate; candidate = candidate->next_by_name) {
+        if (!name_matches(candidate, hash, child, length) || !is_descendant(candidate, entity))
+            continue;
+
+        if (found)
+            return find_child_recursive_walk(entity, child);
+
+        found = candidate;
+    }
+
+    return found;
+}
+
+/*
+ * Consecutive paths sharing leading segments, such as "hud/health/bar" followed by
+ * "hud/health/text", only resolve the shared part once.
+ */
+static void find_paths(struct context *context,
+                       struct entity *entity,
+                       const char **paths,
+                       int count,
+                       struct entity **results)
+{
+    const char separators[] = { ECS_PATH_SEPARATOR, 0 };
+
+    struct entity *resolved[ECS_PATH_CACHE_DEPTH]; // after each segment of the previous path
+    size_t ends[ECS_PATH_CACHE_DEPTH]; // offset just past each of those segments
+
+    const char *previous = 0;
+    int depth = 0;
+
+    for (int i = 0; i < count; ++i) {
+        const char *path = paths[i];
+        int shared = 0;
+
+        while (shared < depth) {
+            size_t end = ends[shared];
+
+            // Compared first, so path is known to be at least end characters long.
+            if (strncmp(path, previous, end) != 0)
+                break;
+
+            if (path[end] != ECS_PATH_SEPARATOR && path[end] != 0)
+                break;
+
+            ++shared;
+        }
+
+        struct entity *current = shared ? resolved[shared - 1] : entity;
+        const char *cursor = path + (shared ? ends[shared - 1] : 0);
+
+        if (shared && *cursor)
+            ++cursor;
+
+        bool_t missing = shared && !current;
+
+        depth = shared;
+
+        while (!missing && *cursor) {
+            size_t length = strcspn(cursor, separators);
+
+            current = find_child(context, current, cursor, length);
+            cursor += length;
+            missing = !current;
+
+            if (depth < ECS_PATH_CACHE_DEPTH) {
+                resolved[depth] = current;
+                ends[depth]     = cursor - path;
+                ++depth;
+            }
+
+            if (*cursor)
+                ++cursor;
+        }
+
+        results[i]  = current;
+        previous    = path;
+    }
+}
+
+struct entity *entity_find_path(struct entity *entity, const char *path)
+{
+    struct entity *result;
+    find_paths(entity->context, entity, &path, 1, &result);
+
+    return result;
+}
+
+void entity_find_paths(struct entity *entity,
+                       const char **paths,
+                       int count,
+                       struct entity **results)
+{
+    find_paths(entity->context, entity, paths, count, results);
+}
+
+// The first segment names one of the context's root entities.
+struct entity *context_find_path(struct context *context, const char *path)
+{
+    struct entity *result;
+    find_paths(context, 0, &path, 1, &result);
+
+    return result;
+}
+
 struct component_storage component_instance(struct ecs_service *ecs,
                                             struct entity *entity,
                                             const char *component)
@@ -430,7 +1149,22 @@ struct component_storage component_instance(struct ecs_service *ecs,
     }
 #endif
 
-    struct component_storage storage = alloc_component(descriptor, entity);
+    return component_instance_descriptor(ecs, entity, descriptor, 0);
+}
+
+/*
+ * Passive data, when given, is copied in before the init callback runs, the same way properties
+ * loaded from json are.
+ */
+struct component_storage component_instance_descriptor(struct ecs_service *ecs,
+                                                       struct entity *entity,
+                                                       struct component_descriptor *descriptor,
+                                                       const void *passive_data)
+{
+    struct component_storage storage = alloc_component(ecs, descriptor, entity);
+
+    if (passive_data && storage.passive)
+        memcpy(storage.passive, passive_data, descriptor->passive_storage.data_size);
 
     if (descriptor->init)
         descriptor->init(entity, storage, descriptor->callback_data);
@@ -448,7 +1182,8 @@ void component_destroy_instance(struct ecs_service *ecs,
     list_for_each (struct component_reference, ref, entity->components) {
         if (ref->storage.active == storage.active &&
             ref->storage.passive == storage.passive) {
-            destroy_component_instance(entity, *ref);
+            table_remove(entity, ref);
+            destroy_component_instance(ecs, entity, *ref);
             list_remove(&entity->components, ref);
 
             return;
@@ -462,12 +1197,10 @@ struct component_storage component_get_storage(struct ecs_service *ecs,
 {
     struct component_descriptor *descriptor = component_match_descriptor(ecs, name);
 
-    list_for_each (struct component_reference, ref, entity->components) {
-        if (ref->descriptor == descriptor)
-            return ref->storage;
-    }
+    if (!descriptor)
+        return (struct component_storage){ 0, 0 };
 
-    return (struct component_storage){ 0, 0 };
+    return entity_get_storage(entity, descriptor->type_id);
 }
 
 struct context *context_create(struct ecs_service *ecs, const char *name)
@@ -475,15 +1208,52 @@ struct context *context_create(struct ecs_service *ecs, const char *name)
     struct context *context = list_alloc(&ecs->contexts);
     context->name = string_create(name);
 
+    init_context_storage(context);
+
     return context;
 }
 
+/*
+ * Destroys every entity in the context along with it.
+ */
 void context_destroy(struct ecs_service *ecs, struct context *context)
 {
     cleanup_context(ecs, context);
     list_remove(&ecs->contexts, context);
 }
 
+void context_destroy_entities(struct ecs_service *ecs, struct context *context)
+{
+    release_context_entities(ecs, context);
+}
+
+static void add_pool_usage(struct context_memory_usage *usage, struct pool *pool)
+{
+    usage->reserved_bytes   += pool->reserved_bytes;
+    usage->used_bytes       += pool->used_count*pool->block_size;
+}
+
+/*
+ * Component tables and names too long for the name pool come from the heap and are not counted.
+ */
+void context_get_memory_usage(struct context *context, struct context_memory_usage *usage)
+{
+    memset(usage, 0, sizeof(struct context_memory_usage));
+
+    usage->entity_count = context->entity_count;
+
+    add_pool_usage(usage, &context->entity_pool);
+    add_pool_usage(usage, &context->transform_pool);
+    add_pool_usage(usage, &context->reference_pool);
+    add_pool_usage(usage, &context->child_pool);
+    add_pool_usage(usage, &context->name_pool);
+
+    for (int i = 0; i < ECS_MAX_COMPONENT_TYPES; ++i) {
+        add_pool_usage(usage, &context->component_pools[i][ECS_STORAGE_ACTIVE]);
+        add_pool_usage(usage, &context->component_pools[i][ECS_STORAGE_PASSIVE]);
+    }
+}
+
 static void register_component_properties(struct ecs_service *ecs,
                                           struct component_descriptor *descriptor,
                                           struct component_registry_info *info)
@@ -518,8 +1288,23 @@ static void register_component_properties(struct ecs_service *ecs,
 struct component_descriptor *component_register(struct ecs_service *ecs,
                                                 struct component_registry_info *info)
 {
+#ifdef DEBUG
+    if (ecs->component_type_count == ECS_MAX_COMPONENT_TYPES) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Failed to register component '%s'. Only %d component types are supported.\n",
+            info->name,
+            ECS_MAX_COMPONENT_TYPES
+        );
+
+        abort();
+    }
+#endif // DEBUG
+
     struct component_descriptor *descriptor = list_alloc(&ecs->components);
 
+    descriptor->type_id = ecs->component_type_count++;
+
     if (info->passive_storage_size)
         list_init(&descriptor->passive_storage, info->passive_storage_size);
 
@@ -536,16 +1321,170 @@ struct component_descriptor *component_register(struct ecs_service *ecs,
     descriptor->entered_tree    = info->callbacks.entered_tree;
     descriptor->cleanup         = info->callbacks.cleanup;
 
+    string_map_insert(&ecs->component_names, info->name, &descriptor);
+
     return descriptor;
 }
 
 struct component_descriptor *component_match_descriptor(struct ecs_service *ecs,
                                                         const char *component)
 {
-    list_for_each (struct component_descriptor, iter, ecs->components) {
-        if (string_eq_ptr(iter->name.chars, component))
-            return iter;
+    struct component_descriptor **p_descriptor = string_map_index(
+        &ecs->component_names,
+        component
+    );
+
+    return p_descriptor ? *p_descriptor : 0;
+}
+
+static bool_t query_matches(struct ecs_query *query,
+                            struct component_descriptor **descriptors,
+                            int component_count)
+{
+    if (query->component_count != component_count)
+        return FALSE;
+
+    for (int i = 0; i < component_count; ++i) {
+        if (query->descriptors[i] != descriptors[i])
+            return FALSE;
     }
 
-    return 0;
-}
\ No newline at end of file
+    return TRUE;
+}
+
+/*
+ * Queries over the same components, in the same order, share one cached result set.
+ */
+struct ecs_query *ecs_query_create(struct ecs_service *ecs,
+                                   const char **components,
+                                   int component_count)
+{
+    struct component_descriptor *descriptors[ECS_QUERY_MAX_COMPONENTS];
+
+#ifdef DEBUG
+    if (component_count > ECS_QUERY_MAX_COMPONENTS) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Failed to create query. %d components exceeds the limit of %d.\n",
+            component_count,
+            ECS_QUERY_MAX_COMPONENTS
+        );
+
+        abort();
+    }
+#endif // DEBUG
+
+    for (int i = 0; i < component_count; ++i) {
+        descriptors[i] = component_match_descriptor(ecs, components[i]);
+
+#ifdef DEBUG
+        if (!descriptors[i]) {
+            debug_log(
+                SEVERITY_ERROR,
+                "Failed to create query. Component '%s' does not exist.\n",
+                components[i]
+            );
+
+            abort();
+        }
+#endif // DEBUG
+    }
+
+    list_for_each (struct ecs_query, query, ecs->queries) {
+        if (query_matches(query, descriptors, component_count)) {
+            ++query->ref_count;
+            return query;
+        }
+    }
+
+    struct ecs_query *query = list_alloc(&ecs->queries);
+
+    query->ecs              = ecs;
+    query->component_count  = component_count;
+    query->ref_count        = 1;
+    query->version          = ecs->structure_version - 1;
+
+    memcpy(query->descriptors, descriptors, component_count*sizeof(struct component_descriptor *));
+
+    for (int i = 0; i < component_count; ++i) {
+        query->mask |= UINT64_C(1) << descriptors[i]->type_id;
+    }
+
+    return query;
+}
+
+void ecs_query_destroy(struct ecs_query *query)
+{
+    if (--query->ref_count > 0)
+        return;
+
+    cleanup_query(query);
+    list_remove(&query->ecs->queries, query);
+}
+
+static bool_t match_entity(struct ecs_query *query,
+                           struct entity *entity,
+                           struct component_storage *storages)
+{
+    if ((entity->component_mask & query->mask) != query->mask)
+        return FALSE;
+
+    for (int i = 0; i < query->component_count; ++i) {
+        storages[i] = entity_get_storage(entity, query->descriptors[i]->type_id);
+    }
+
+    return TRUE;
+}
+
+static void append_row(struct ecs_query *query,
+                       struct entity *entity,
+                       struct component_storage *storages)
+{
+    if (query->count == query->capacity) {
+        query->capacity = max(query->capacity*2, 16);
+
+        query->entities = realloc(
+            query->entities,
+            query->capacity*sizeof(struct entity *)
+        );
+
+        query->storages = realloc(
+            query->storages,
+            query->capacity*query->component_count*sizeof(struct component_storage)
+        );
+    }
+
+    query->entities[query->count] = entity;
+
+    memcpy(
+        &ecs_query_storage(query, query->count, 0),
+        storages,
+        query->component_count*sizeof(struct component_storage)
+    );
+
+    ++query->count;
+}
+
+static void rebuild_query(struct ecs_query *query)
+{
+    struct component_storage storages[ECS_QUERY_MAX_COMPONENTS];
+
+    query->count = 0;
+
+    list_for_each (struct context, context, query->ecs->contexts) {
+        list_for_each (struct entity, entity, context->entities) {
+            if (match_entity(query, entity, storages))
+                append_row(query, entity, storages);
+        }
+    }
+
+    query->version = query->ecs->structure_version;
+}
+
+struct ecs_query *ecs_query_refresh(struct ecs_query *query)
+{
+    if (query->version != query->ecs->structure_version)
+        rebuild_query(query);
+
+    return query;
+}
@@ -0,0 +1,311 @@
+#include <soul/ecs_commands.h>
+#include <soul/debug.h>
+#include <soul/math/macros.h>
+
+static void cleanup_buffer(struct ecs_command_buffer *buffer)
+{
+    free(buffer->commands);
+    free(buffer->payload);
+    free(buffer->created);
+}
+
+void ecs_commands_init(struct ecs_service *ecs, struct soul_instance *instance)
+{
+    list_init(&ecs->command_buffers, sizeof(struct ecs_command_buffer));
+    pthread_mutex_init(&ecs->command_mutex, 0);
+
+    ordered_callbacks_insert(
+        &instance->callbacks,
+        (ordered_callback_t)&ecs_commands_playback,
+        EXECUTION_ORDER_COMMAND_PLAYBACK,
+        ecs,
+        FALSE
+    );
+}
+
+void ecs_commands_destroy(struct ecs_service *ecs)
+{
+    list_for_each (struct ecs_command_buffer, buffer, ecs->command_buffers) {
+        cleanup_buffer(buffer);
+    }
+
+    list_destroy(&ecs->command_buffers);
+    pthread_mutex_destroy(&ecs->command_mutex);
+}
+
+/*
+ * Each thread gets one buffer that lives as long as the ecs, so after the first few frames
+ * recording no longer allocates. Acquire once per job and record freely without locking.
+ */
+struct ecs_command_buffer *ecs_commands_acquire(struct ecs_service *ecs)
+{
+    pthread_t self = pthread_self();
+
+    pthread_mutex_lock(&ecs->command_mutex);
+
+    list_for_each (struct ecs_command_buffer, buffer, ecs->command_buffers) {
+        if (pthread_equal(buffer->owner, self)) {
+            pthread_mutex_unlock(&ecs->command_mutex);
+            return buffer;
+        }
+    }
+
+    struct ecs_command_buffer *buffer = list_alloc(&ecs->command_buffers);
+
+    buffer->ecs     = ecs;
+    buffer->owner   = self;
+
+    pthread_mutex_unlock(&ecs->command_mutex);
+
+    return buffer;
+}
+
+static struct ecs_command *push_command(struct ecs_command_buffer *buffer,
+                                        enum ecs_command_type type,
+                                        entity_handle_t entity)
+{
+    if (buffer->command_count == buffer->command_capacity) {
+        buffer->command_capacity = max(
+            buffer->command_capacity*2,
+            ECS_COMMAND_BUFFER_MIN_CAPACITY
+        );
+
+        buffer->commands = realloc(
+            buffer->commands,
+            buffer->command_capacity*sizeof(struct ecs_command)
+        );
+    }
+
+    struct ecs_command *command = buffer->commands + buffer->command_count++;
+
+    memset(command, 0, sizeof(struct ecs_command));
+
+    command->type   = type;
+    command->entity = entity;
+
+    return command;
+}
+
+static size_t push_payload(struct ecs_command_buffer *buffer, const void *data, size_t size)
+{
+    if (buffer->payload_size + size > buffer->payload_capacity) {
+        buffer->payload_capacity = max(
+            buffer->payload_size + size,
+            max(buffer->payload_capacity*2, ECS_COMMAND_BUFFER_MIN_CAPACITY)
+        );
+
+        buffer->payload = realloc(buffer->payload, buffer->payload_capacity);
+    }
+
+    size_t offset = buffer->payload_size;
+
+    memcpy(buffer->payload + offset, data, size);
+    buffer->payload_size += size;
+
+    return offset;
+}
+
+static struct component_descriptor *match_descriptor(struct ecs_command_buffer *buffer,
+                                                     const char *component)
+{
+    struct component_descriptor *descriptor = component_match_descriptor(buffer->ecs, component);
+
+#ifdef DEBUG
+    if (!descriptor) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Failed to record command. Component '%s' does not exist.\n",
+            component
+        );
+
+        abort();
+    }
+#endif // DEBUG
+
+    return descriptor;
+}
+
+entity_handle_t ecs_command_create_entity(struct ecs_command_buffer *buffer,
+                                          const char *name,
+                                          struct context *context,
+                                          entity_handle_t parent)
+{
+    entity_handle_t pending = slot_handle(++buffer->create_count, 0);
+
+    struct ecs_command *command = push_command(buffer, ECS_COMMAND_CREATE_ENTITY, pending);
+
+    command->parent         = parent;
+    command->context        = context;
+    command->payload_offset = push_payload(buffer, name, strlen(name) + 1);
+
+    return pending;
+}
+
+void ecs_command_destroy_entity(struct ecs_command_buffer *buffer, entity_handle_t entity)
+{
+    push_command(buffer, ECS_COMMAND_DESTROY_ENTITY, entity);
+}
+
+void ecs_command_add_component(struct ecs_command_buffer *buffer,
+                               entity_handle_t entity,
+                               const char *component,
+                               const void *passive_data)
+{
+    struct component_descriptor *descriptor = match_descriptor(buffer, component);
+    size_t passive_size = descriptor->passive_storage.data_size;
+
+    struct ecs_command *command = push_command(buffer, ECS_COMMAND_ADD_COMPONENT, entity);
+
+    command->descriptor     = descriptor;
+    command->payload_offset = SIZE_MAX;
+
+    if (passive_data && passive_size)
+        command->payload_offset = push_payload(buffer, passive_data, passive_size);
+}
+
+void ecs_command_remove_component(struct ecs_command_buffer *buffer,
+                                  entity_handle_t entity,
+                                  const char *component)
+{
+    struct ecs_command *command = push_command(buffer, ECS_COMMAND_REMOVE_COMPONENT, entity);
+
+    command->descriptor = match_descriptor(buffer, component);
+}
+
+static struct entity *resolve(struct ecs_command_buffer *buffer, entity_handle_t handle)
+{
+    if (ecs_command_is_pending(handle)) {
+        uint32_t index = slot_handle_index(handle);
+
+#ifdef DEBUG
+        if (index > buffer->create_count) {
+            debug_log(
+                SEVERITY_ERROR,
+                "Pending entity handle %u was not recorded by this command buffer.\n",
+                index
+            );
+
+            abort();
+        }
+#endif // DEBUG
+
+        handle = buffer->created[index - 1];
+    }
+
+    return entity_resolve(buffer->ecs, handle);
+}
+
+static void play_create(struct ecs_command_buffer *buffer,
+                        struct ecs_command *command,
+                        int create_index)
+{
+    struct entity *parent = 0;
+
+    // A parent destroyed before playback takes its pending children with it.
+    if (command->parent) {
+        parent = resolve(buffer, command->parent);
+
+        if (!parent) {
+            buffer->created[create_index] = ENTITY_HANDLE_NULL;
+            return;
+        }
+    }
+
+    struct entity *entity = entity_create(
+        buffer->ecs,
+        buffer->payload + command->payload_offset,
+        command->context,
+        parent
+    );
+
+    buffer->created[create_index] = entity->handle;
+}
+
+static void play_command(struct ecs_command_buffer *buffer, struct ecs_command *command)
+{
+    if (command->type == ECS_COMMAND_CREATE_ENTITY) {
+        play_create(buffer, command, slot_handle_index(command->entity) - 1);
+        return;
+    }
+
+    // Commands against entities that no longer exist are dropped.
+    struct entity *entity = resolve(buffer, command->entity);
+
+    if (!entity)
+        return;
+
+    switch (command->type) {
+    case ECS_COMMAND_DESTROY_ENTITY:
+        entity_destroy(buffer->ecs, entity);
+        break;
+    case ECS_COMMAND_ADD_COMPONENT:
+        component_instance_descriptor(
+            buffer->ecs,
+            entity,
+            command->descriptor,
+            (command->payload_offset != SIZE_MAX) ? buffer->payload + command->payload_offset : 0
+        );
+        break;
+    case ECS_COMMAND_REMOVE_COMPONENT: {
+        int type_id = command->descriptor->type_id;
+
+        if (entity_has_component(entity, type_id))
+            component_destroy_instance(buffer->ecs, entity, entity_get_storage(entity, type_id));
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void reserve_created(struct ecs_command_buffer *buffer)
+{
+    if (buffer->create_count <= buffer->create_capacity)
+        return;
+
+    buffer->create_capacity = max(buffer->create_count, buffer->create_capacity*2);
+    buffer->created = realloc(
+        buffer->created,
+        buffer->create_capacity*sizeof(entity_handle_t)
+    );
+}
+
+/*
+ * Component callbacks may record more commands while the buffer plays, which can move its
+ * arrays, so each command is copied out first and the count is re-read every step.
+ */
+static void play_buffer(struct ecs_command_buffer *buffer)
+{
+    for (int i = 0; i < buffer->command_count; ++i) {
+        struct ecs_command command = buffer->commands[i];
+
+        reserve_created(buffer);
+        play_command(buffer, &command);
+    }
+
+    buffer->command_count   = 0;
+    buffer->payload_size    = 0;
+    buffer->create_count    = 0;
+}
+
+/*
+ * Runs on the main thread once no jobs are recording. Buffers are applied one after another in
+ * the order their threads first acquired them, and commands within a buffer in the order they
+ * were recorded.
+ */
+void ecs_commands_playback(struct ecs_service *ecs)
+{
+    uint32_t create_count = 0;
+
+    list_for_each (struct ecs_command_buffer, buffer, ecs->command_buffers) {
+        create_count += buffer->create_count;
+    }
+
+    // Entity slots for the whole batch are allocated up front rather than grown per create.
+    slot_map_reserve(&ecs->entity_slots, create_count);
+
+    list_for_each (struct ecs_command_buffer, buffer, ecs->command_buffers) {
+        if (buffer->command_count)
+            play_buffer(buffer);
+    }
+}
@@ -0,0 +1,118 @@
+#include <soul/ecs_parallel.h>
+#include <soul/math/macros.h>
+
+struct parallel_for
+{
+    void **             instances;
+    component_chunk_t   fn;
+    void *              data;
+};
+
+struct parallel_reduce
+{
+    void **             instances;
+    component_map_t     map;
+    char *              partials;
+    size_t              result_size;
+    void *              data;
+};
+
+/*
+ * Storage nodes are scattered across context pools, so their addresses are gathered into one
+ * array first. Chunks are then contiguous runs of that array, in storage order.
+ */
+static int gather_instances(struct list *storage, void ***p_instances)
+{
+    void **instances = 0;
+    int count = 0;
+    int capacity = 0;
+
+    list_for_each (void, instance, *storage) {
+        if (count == capacity) {
+            capacity    = max(capacity*2, COMPONENT_DEFAULT_CHUNK_SIZE);
+            instances   = realloc(instances, capacity*sizeof(void *));
+        }
+
+        instances[count++] = instance;
+    }
+
+    *p_instances = instances;
+
+    return count;
+}
+
+static void run_chunk(int begin, int end, int chunk_index, struct parallel_for *parallel_for)
+{
+    parallel_for->fn(
+        parallel_for->instances + begin,
+        end - begin,
+        chunk_index,
+        parallel_for->data
+    );
+}
+
+void component_parallel_for(struct thread_pool_service *pool,
+                            struct component_descriptor *descriptor,
+                            int chunk_size,
+                            component_chunk_t fn,
+                            void *data)
+{
+    if (chunk_size <= 0)
+        chunk_size = COMPONENT_DEFAULT_CHUNK_SIZE;
+
+    struct parallel_for parallel_for = { 0, fn, data };
+
+    int count = gather_instances(&descriptor->passive_storage, &parallel_for.instances);
+
+    thread_pool_parallel_for(pool, count, chunk_size, (range_job_t)&run_chunk, &parallel_for);
+
+    free(parallel_for.instances);
+}
+
+static void map_chunk(int begin, int end, int chunk_index, struct parallel_reduce *reduce)
+{
+    reduce->map(
+        reduce->instances + begin,
+        end - begin,
+        reduce->partials + chunk_index*reduce->result_size,
+        reduce->data
+    );
+}
+
+/*
+ * Each chunk folds into its own partial, and the partials are combined in chunk order on the
+ * calling thread, so the result does not depend on how the chunks were scheduled. The result
+ * must hold the identity value on entry.
+ */
+void component_parallel_reduce(struct thread_pool_service *pool,
+                               struct component_descriptor *descriptor,
+                               int chunk_size,
+                               component_map_t map,
+                               component_reduce_t reduce,
+                               void *result,
+                               size_t result_size,
+                               void *data)
+{
+    if (chunk_size <= 0)
+        chunk_size = COMPONENT_DEFAULT_CHUNK_SIZE;
+
+    struct parallel_reduce parallel_reduce = { 0, map, 0, result_size, data };
+
+    int count = gather_instances(&descriptor->passive_storage, &parallel_reduce.instances);
+    int chunk_count = (count + chunk_size - 1)/chunk_size;
+
+    parallel_reduce.partials = malloc(chunk_count*result_size);
+
+    for (int i = 0; i < chunk_count; ++i) {
+        memcpy(parallel_reduce.partials + i*result_size, result, result_size);
+    }
+
+    thread_pool_parallel_for(pool, count, chunk_size, (range_job_t)&map_chunk, &parallel_reduce);
+
+    for (int i = 0; i < chunk_count; ++i) {
+        reduce(result, parallel_reduce.partials + i*result_size, data);
+    }
+
+    free(parallel_reduce.partials);
+    free(parallel_reduce.instances);
+}
@@ -1,3 +1,12 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -35,4 +44,93 @@ char *file_to_buffer(const char *path, size_t *bytes)
 void file_free_buffer(char *buffer)
 {
     free(buffer);
+}
+
+/*
+ * Pages are read in as they are touched rather than up front. Empty files cannot be mapped and
+ * fail like missing ones.
+ */
+result_t file_map(const char *path, struct file_mapping *mapping)
+{
+    *mapping = (struct file_mapping){ 0 };
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        0,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        0
+    );
+
+    if (file == INVALID_HANDLE_VALUE)
+        return FAIL;
+
+    LARGE_INTEGER file_size;
+
+    if (!GetFileSizeEx(file, &file_size) || !file_size.QuadPart) {
+        CloseHandle(file);
+        return FAIL;
+    }
+
+    // The mapping keeps the file open on its own.
+    HANDLE handle = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    CloseHandle(file);
+
+    if (!handle)
+        return FAIL;
+
+    void *data = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+
+    if (!data) {
+        CloseHandle(handle);
+        return FAIL;
+    }
+
+    size_t size = file_size.QuadPart;
+
+    mapping->handle = handle;
+#else
+    int file = open(path, O_RDONLY);
+
+    if (file < 0)
+        return FAIL;
+
+    struct stat info;
+
+    if (fstat(file, &info) || !info.st_size) {
+        close(file);
+        return FAIL;
+    }
+
+    size_t size = info.st_size;
+
+    void *data = mmap(0, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (data == MAP_FAILED)
+        return FAIL;
+#endif
+
+    mapping->data = data;
+    mapping->size = size;
+
+    return SUCCESS;
+}
+
+void file_unmap(struct file_mapping *mapping)
+{
+    if (!mapping->data)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapping->data);
+    CloseHandle(mapping->handle);
+#else
+    munmap(mapping->data, mapping->size);
+#endif
+
+    *mapping = (struct file_mapping){ 0 };
 }
\ No newline at end of file
@@ -5,6 +5,25 @@ void list_init(struct list *list, size_t data_size)
     list->data_size = data_size;
     list->head      = 0;
     list->tail      = 0;
+    list->pool      = 0;
+}
+
+/*
+ * Nodes are taken from a pool of list_node_size(data_size) blocks, which may be shared between
+ * lists holding the same type.
+ */
+void list_init_pooled(struct list *list, size_t data_size, struct pool *pool)
+{
+    list_init(list, data_size);
+    list->pool = pool;
+}
+
+static void free_node(struct list *list, struct list_node_header *node)
+{
+    if (list->pool)
+        pool_free(list->pool, node);
+    else
+        free(node);
 }
 
 void list_destroy(struct list *list)
@@ -13,7 +32,7 @@ void list_destroy(struct list *list)
 
     while (node) {
         struct list_node_header *next = node->next;
-        free(node);
+        free_node(list, node);
 
         node = next;
     }
@@ -21,28 +40,36 @@ void list_destroy(struct list *list)
 
 struct list_node_header *list_alloc_node(struct list *list)
 {
-    size_t size = sizeof(struct list_node_header) + list->data_size;
-    struct list_node_header *node = (struct list_node_header *)calloc(1, size);
+    if (list->pool)
+        return pool_alloc(list->pool);
 
-    return node;
+    return calloc(1, list_node_size(list->data_size));
 }
 
-void *list_alloc(struct list *list)
+/*
+ * Links a node obtained elsewhere onto the tail. Paired with list_unlink(), this lets nodes
+ * owned by some other allocator be tracked in a list.
+ */
+void *list_append_node(struct list *list, struct list_node_header *node)
 {
-    struct list_node_header *node = list_alloc_node(list);
+    node->next = 0;
+    node->prev = list->tail;
 
-    if (list->tail) {
-        list->tail->next    = node;
-        node->prev          = list->tail;
-        list->tail          = node;
-    } else {
-        list->head  = node;
-        list->tail  = node;
-    }
+    if (list->tail)
+        list->tail->next = node;
+    else
+        list->head = node;
+
+    list->tail = node;
 
     return list_node_data_ptr(void, node);
 }
 
+void *list_alloc(struct list *list)
+{
+    return list_append_node(list, list_alloc_node(list));
+}
+
 void *list_push(struct list *list, void *p_data)
 {
     void *p_new_data = list_alloc(list);
@@ -51,7 +78,7 @@ void *list_push(struct list *list, void *p_data)
     return p_new_data;
 }
 
-void list_remove(struct list *list, void *p_data)
+struct list_node_header *list_unlink(struct list *list, void *p_data)
 {
     struct list_node_header *node = list_node_from_data(p_data);
 
@@ -67,7 +94,12 @@ void list_remove(struct list *list, void *p_data)
     if (node == list->tail)
         list->tail = node->prev;
 
-    free(node);
+    return node;
+}
+
+void list_remove(struct list *list, void *p_data)
+{
+    free_node(list, list_unlink(list, p_data));
 }
 
 void list_remove_value(struct list *list, void *p_data)
@@ -0,0 +1,95 @@
+#include <string.h>
+
+#include <soul/pool.h>
+#include <soul/math/macros.h>
+
+#define align_up(size, alignment) (((size) + (alignment) - 1) & ~((size_t)(alignment) - 1))
+
+#define CHUNK_HEADER_SIZE align_up(sizeof(struct pool_chunk), POOL_ALIGNMENT)
+
+void pool_init(struct pool *pool, size_t block_size, size_t chunk_blocks)
+{
+    memset(pool, 0, sizeof(struct pool));
+
+    // Free blocks hold the link to the next one.
+    pool->block_size    = align_up(max(block_size, sizeof(void *)), POOL_ALIGNMENT);
+    pool->chunk_blocks  = chunk_blocks ? chunk_blocks : POOL_DEFAULT_CHUNK_BLOCKS;
+}
+
+void pool_destroy(struct pool *pool)
+{
+    struct pool_chunk *chunk = pool->chunks;
+
+    while (chunk) {
+        struct pool_chunk *next = chunk->next;
+        free(chunk);
+
+        chunk = next;
+    }
+
+    pool->chunks            = 0;
+    pool->free_head         = 0;
+    pool->free_count        = 0;
+    pool->used_count        = 0;
+    pool->reserved_bytes    = 0;
+}
+
+static void add_chunk(struct pool *pool, size_t block_count)
+{
+    // malloc already returns memory aligned for any fundamental type, which covers 16 bytes.
+    size_t size = CHUNK_HEADER_SIZE + block_count*pool->block_size;
+    struct pool_chunk *chunk = malloc(size);
+
+    chunk->next         = pool->chunks;
+    chunk->block_count  = block_count;
+    pool->chunks        = chunk;
+
+    char *blocks = (char *)chunk + CHUNK_HEADER_SIZE;
+
+    // Chained back to front so the chunk is handed out in address order.
+    for (size_t i = block_count; i-- > 0;) {
+        void *block = blocks + i*pool->block_size;
+
+        *(void **)block = pool->free_head;
+        pool->free_head = block;
+    }
+
+    pool->free_count        += block_count;
+    pool->reserved_bytes    += size;
+}
+
+// Makes room for count more allocations in at most one new chunk.
+void pool_reserve(struct pool *pool, size_t count)
+{
+    if (pool->free_count >= count)
+        return;
+
+    add_chunk(pool, max(count - pool->free_count, pool->chunk_blocks));
+}
+
+void *pool_alloc(struct pool *pool)
+{
+    if (!pool->free_head) {
+        add_chunk(pool, pool->chunk_blocks);
+        pool->chunk_blocks = min(pool->chunk_blocks*2, POOL_MAX_CHUNK_BLOCKS);
+    }
+
+    void *block = pool->free_head;
+
+    pool->free_head = *(void **)block;
+    --pool->free_count;
+    ++pool->used_count;
+
+    memset(block, 0, pool->block_size);
+
+    return block;
+}
+
+void pool_free(struct pool *pool, void *block)
+{
+    *(void **)block = pool->free_head;
+    pool->free_head = block;
+
+    ++pool->free_count;
+    --pool->used_count;
+}
@@ -0,0 +1,325 @@
+#include <soul/scheduler.h>
+#include <soul/debug.h>
+
+static void cleanup_system(struct system *system)
+{
+    string_destroy(system->name);
+
+    list_for_each (struct string, name, system->reads) {
+        string_destroy(*name);
+    }
+
+    list_for_each (struct string, name, system->writes) {
+        string_destroy(*name);
+    }
+
+    list_destroy(&system->reads);
+    list_destroy(&system->writes);
+}
+
+static void free_graph(struct system_phase *phase)
+{
+    free(phase->nodes);
+    free(phase->dependents);
+    free(phase->main_queue);
+
+    phase->nodes        = 0;
+    phase->dependents   = 0;
+    phase->main_queue   = 0;
+    phase->node_count   = 0;
+}
+
+static void cleanup_phase(struct system_phase *phase)
+{
+    list_for_each (struct system, system, phase->systems) {
+        cleanup_system(system);
+    }
+
+    list_destroy(&phase->systems);
+    free_graph(phase);
+
+    pthread_cond_destroy(&phase->main_ready);
+    pthread_mutex_destroy(&phase->mutex);
+}
+
+static void deallocate_service(struct scheduler_service *scheduler)
+{
+    list_for_each (struct system_phase, phase, scheduler->phases) {
+        cleanup_phase(phase);
+    }
+
+    list_destroy(&scheduler->phases);
+}
+
+void scheduler_service_create_resource(struct soul_instance *soul_instance)
+{
+    struct scheduler_service *scheduler = resource_create(
+        soul_instance,
+        SCHEDULER_SERVICE,
+        sizeof(struct scheduler_service),
+        (resource_deallocator_t)&deallocate_service
+    );
+
+    scheduler->soul_instance    = soul_instance;
+    scheduler->ecs              = resource_get(soul_instance, ECS_SERVICE);
+    scheduler->thread_pool      = resource_get(soul_instance, THREAD_POOL_SERVICE);
+
+    list_init(&scheduler->phases, sizeof(struct system_phase));
+}
+
+static uint64_t resolve_mask(struct system_phase *phase,
+                             struct system *system,
+                             struct list *names)
+{
+    uint64_t mask = 0;
+
+    list_for_each (struct string, name, *names) {
+        struct component_descriptor *descriptor = component_match_descriptor(
+            phase->scheduler->ecs,
+            name->chars
+        );
+
+#ifdef DEBUG
+        if (!descriptor) {
+            debug_log(
+                SEVERITY_ERROR,
+                "System '%s' accesses component '%s', which does not exist.\n",
+                system->name.chars,
+                name->chars
+            );
+
+            abort();
+        }
+#endif // DEBUG
+
+        mask |= UINT64_C(1) << descriptor->type_id;
+    }
+
+    return mask;
+}
+
+static bool_t must_precede(struct system *first, struct system *second)
+{
+    if (first->main_thread && second->main_thread)
+        return TRUE;
+
+    return (first->write_mask & (second->read_mask | second->write_mask)) ||
+           (first->read_mask & second->write_mask);
+}
+
+/*
+ * Edges only ever point from an earlier registered system to a later one, so the graph can not
+ * contain a cycle.
+ */
+static void build_graph(struct system_phase *phase)
+{
+    free_graph(phase);
+
+    int count = 0;
+
+    list_for_each (struct system, system, phase->systems) {
+        system->read_mask   = resolve_mask(phase, system, &system->reads);
+        system->write_mask  = resolve_mask(phase, system, &system->writes);
+
+        ++count;
+    }
+
+    phase->node_count   = count;
+    phase->nodes        = calloc(count, sizeof(struct system_node));
+    phase->main_queue   = malloc(count*sizeof(struct system_node *));
+
+    int i = 0;
+
+    list_for_each (struct system, system, phase->systems) {
+        phase->nodes[i].phase   = phase;
+        phase->nodes[i].system  = system;
+        ++i;
+    }
+
+    int edge_count = 0;
+
+    for (int a = 0; a < count; ++a) {
+        for (int b = a + 1; b < count; ++b) {
+            if (must_precede(phase->nodes[a].system, phase->nodes[b].system))
+                ++edge_count;
+        }
+    }
+
+    phase->dependents = malloc(edge_count*sizeof(int));
+
+    int *next_dependent = phase->dependents;
+
+    for (int a = 0; a < count; ++a) {
+        struct system_node *node = phase->nodes + a;
+
+        node->dependents = next_dependent;
+
+        for (int b = a + 1; b < count; ++b) {
+            if (must_precede(node->system, phase->nodes[b].system)) {
+                node->dependents[node->dependent_count++] = b;
+                ++phase->nodes[b].dependency_count;
+            }
+        }
+
+        next_dependent += node->dependent_count;
+    }
+
+    phase->dirty = FALSE;
+}
+
+static void run_node(struct system_node *node);
+
+// Expects the phase mutex to be held.
+static void dispatch(struct system_node *node)
+{
+    struct system_phase *phase = node->phase;
+
+    if (node->system->main_thread) {
+        phase->main_queue[phase->main_queue_tail++] = node;
+        pthread_cond_signal(&phase->main_ready);
+    } else {
+        thread_pool_submit(phase->scheduler->thread_pool, 0, (job_t)&run_node, node);
+    }
+}
+
+// Expects the phase mutex to be held.
+static void complete(struct system_node *node)
+{
+    struct system_phase *phase = node->phase;
+
+    for (int i = 0; i < node->dependent_count; ++i) {
+        struct system_node *dependent = phase->nodes + node->dependents[i];
+
+        if (--dependent->remaining == 0)
+            dispatch(dependent);
+    }
+
+    ++phase->finished;
+    pthread_cond_signal(&phase->main_ready);
+}
+
+static void run_node(struct system_node *node)
+{
+    node->system->fn(node->system->data);
+
+    pthread_mutex_lock(&node->phase->mutex);
+    complete(node);
+    pthread_mutex_unlock(&node->phase->mutex);
+}
+
+/*
+ * Worker systems are handed to the thread pool as soon as their dependencies finish, while the
+ * calling thread runs main thread systems as they become ready. Returns once every system in
+ * the phase has finished.
+ */
+static void run_phase(struct system_phase *phase)
+{
+    if (phase->dirty)
+        build_graph(phase);
+
+    if (!phase->node_count)
+        return;
+
+    pthread_mutex_lock(&phase->mutex);
+
+    phase->finished         = 0;
+    phase->main_queue_head  = 0;
+    phase->main_queue_tail  = 0;
+
+    for (int i = 0; i < phase->node_count; ++i) {
+        phase->nodes[i].remaining = phase->nodes[i].dependency_count;
+    }
+
+    for (int i = 0; i < phase->node_count; ++i) {
+        if (!phase->nodes[i].dependency_count)
+            dispatch(phase->nodes + i);
+    }
+
+    while (phase->finished < phase->node_count) {
+        if (phase->main_queue_head == phase->main_queue_tail) {
+            pthread_cond_wait(&phase->main_ready, &phase->mutex);
+            continue;
+        }
+
+        struct system_node *node = phase->main_queue[phase->main_queue_head++];
+
+        pthread_mutex_unlock(&phase->mutex);
+        node->system->fn(node->system->data);
+        pthread_mutex_lock(&phase->mutex);
+
+        complete(node);
+    }
+
+    pthread_mutex_unlock(&phase->mutex);
+}
+
+static struct system_phase *get_phase(struct scheduler_service *scheduler, int order)
+{
+    list_for_each (struct system_phase, phase, scheduler->phases) {
+        if (phase->order == order)
+            return phase;
+    }
+
+    struct system_phase *phase = list_alloc(&scheduler->phases);
+
+    phase->scheduler    = scheduler;
+    phase->order        = order;
+
+    list_init(&phase->systems, sizeof(struct system));
+    pthread_mutex_init(&phase->mutex, 0);
+    pthread_cond_init(&phase->main_ready, 0);
+
+    ordered_callbacks_insert(
+        &scheduler->soul_instance->callbacks,
+        (ordered_callback_t)&run_phase,
+        order,
+        phase,
+        FALSE
+    );
+
+    return phase;
+}
+
+static void copy_names(struct list *list, const char **names, int count)
+{
+    list_init(list, sizeof(struct string));
+
+    for (int i = 0; i < count; ++i) {
+        struct string name = string_create(names[i]);
+        list_push(list, &name);
+    }
+}
+
+/*
+ * Component names are resolved when the phase next runs, so a system may be registered before
+ * the components it accesses.
+ */
+struct system *system_register(struct scheduler_service *scheduler,
+                               struct system_registry_info *info)
+{
+    struct system_phase *phase = get_phase(scheduler, info->order);
+    struct system *system = list_alloc(&phase->systems);
+
+    system->name        = string_create(info->name);
+    system->phase       = phase;
+    system->fn          = info->fn;
+    system->data        = info->data;
+    system->main_thread = info->main_thread;
+
+    copy_names(&system->reads, info->reads, info->read_count);
+    copy_names(&system->writes, info->writes, info->write_count);
+
+    phase->dirty = TRUE;
+
+    return system;
+}
+
+void system_unregister(struct scheduler_service *scheduler, struct system *system)
+{
+    struct system_phase *phase = system->phase;
+
+    cleanup_system(system);
+    list_remove(&phase->systems, system);
+
+    phase->dirty = TRUE;
+}
@@ -1,5 +1,8 @@
 #include <soul/services.h>
 #include <soul/ecs.h>
+#include <soul/thread_pool.h>
+#include <soul/scheduler.h>
+#include <soul/spatial.h>
 #include <soul/ui/window.h>
 #include <soul/ui/font.h>
 #include <soul/graphics/core.h>
@@ -13,6 +16,9 @@ void services_create_all(struct soul_instance *soul_instance)
     window_service_create_resource(soul_instance);
     graphics_service_create_resource(soul_instance);
     shader_service_create_resource(soul_instance);
+    thread_pool_service_create_resource(soul_instance);
+    scheduler_service_create_resource(soul_instance);
+    spatial_service_create_resource(soul_instance);
     texture_service_create_resource(soul_instance);
     mesh_service_create_resource(soul_instance);
     font_service_create_resource(soul_instance);
@@ -0,0 +1,95 @@
+#include <string.h>
+
+#include <soul/slot_map.h>
+#include <soul/math/macros.h>
+
+#define SLOT_MAP_MIN_CAPACITY 64
+
+void slot_map_init(struct slot_map *map, size_t data_size)
+{
+    memset(map, 0, sizeof(struct slot_map));
+
+    map->data_size  = data_size;
+    map->free_head  = SLOT_MAP_NO_FREE_SLOT;
+}
+
+void slot_map_destroy(struct slot_map *map)
+{
+    free(map->data);
+    free(map->generations);
+    free(map->next_free);
+}
+
+static void grow(struct slot_map *map)
+{
+    uint32_t capacity = max(map->capacity*2, SLOT_MAP_MIN_CAPACITY);
+
+    map->data           = realloc(map->data, capacity*map->data_size);
+    map->generations    = realloc(map->generations, capacity*sizeof(uint32_t));
+    map->next_free      = realloc(map->next_free, capacity*sizeof(uint32_t));
+
+    // New slots are chained in index order, so the lowest ones are handed out first.
+    for (uint32_t i = map->capacity; i < capacity; ++i) {
+        map->generations[i] = 0;
+        map->next_free[i]   = (i + 1 < capacity) ? i + 1 : map->free_head;
+    }
+
+    map->free_head  = map->capacity;
+    map->capacity   = capacity;
+}
+
+// Makes room for count more insertions without growing in between.
+void slot_map_reserve(struct slot_map *map, uint32_t count)
+{
+    while (map->capacity - map->count < count) {
+        grow(map);
+    }
+}
+
+slot_handle_t slot_map_alloc(struct slot_map *map, void **p_data)
+{
+    if (map->free_head == SLOT_MAP_NO_FREE_SLOT)
+        grow(map);
+
+    uint32_t index = map->free_head;
+
+    map->free_head = map->next_free[index];
+    ++map->generations[index];
+    ++map->count;
+
+    void *data = map->data + index*map->data_size;
+    memset(data, 0, map->data_size);
+
+    if (p_data)
+        *p_data = data;
+
+    return slot_handle(index, map->generations[index]);
+}
+
+slot_handle_t slot_map_insert(struct slot_map *map, void *data)
+{
+    void *allocation;
+    slot_handle_t handle = slot_map_alloc(map, &allocation);
+
+    memcpy(allocation, data, map->data_size);
+
+    return handle;
+}
+
+bool_t slot_map_remove(struct slot_map *map, slot_handle_t handle)
+{
+    if (!slot_map_valid(map, handle))
+        return FALSE;
+
+    uint32_t index = slot_handle_index(handle);
+
+    // Wrapping lands on zero, which is even, so parity and the null handle both still hold.
+    ++map->generations[index];
+
+    map->next_free[index]   = map->free_head;
+    map->free_head          = index;
+
+    --map->count;
+
+    return TRUE;
+}
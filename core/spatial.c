@@ -0,0 +1,702 @@
+#include <math.h>
+#include <string.h>
+
+#include <soul/spatial.h>
+#include <soul/debug.h>
+#include <soul/math/macros.h>
+#include <soul/math/simd.h>
+
+#define MIN_ITEM_CAPACITY 64
+
+// Keeps cell coordinates of far away items from overflowing.
+#define CELL_LIMIT 1073741824.0f
+
+struct location
+{
+    int32_t x;
+    int32_t y;
+    int     level;
+    int32_t slot;
+};
+
+struct cell_range
+{
+    int32_t x0;
+    int32_t y0;
+    int32_t x1;
+    int32_t y1;
+};
+
+static void cleanup_index(struct spatial_index *index)
+{
+    string_destroy(index->name);
+
+    free(index->min_x);
+    free(index->min_y);
+    free(index->max_x);
+    free(index->max_y);
+    free(index->data);
+    free(index->cell_x);
+    free(index->cell_y);
+    free(index->slot);
+    free(index->next);
+    free(index->prev);
+    free(index->level);
+    free(index->heads);
+}
+
+static void deallocate_service(struct spatial_service *service)
+{
+    list_for_each (struct spatial_index, index, service->indices) {
+        cleanup_index(index);
+    }
+
+    list_destroy(&service->indices);
+}
+
+void spatial_service_create_resource(struct soul_instance *soul_instance)
+{
+    struct spatial_service *service = resource_create(
+        soul_instance,
+        SPATIAL_SERVICE,
+        sizeof(struct spatial_service),
+        (resource_deallocator_t)&deallocate_service
+    );
+
+    list_init(&service->indices, sizeof(struct spatial_index));
+}
+
+static spatial_item_t *alloc_heads(int count)
+{
+    spatial_item_t *heads = malloc(count*sizeof(spatial_item_t));
+
+    for (int i = 0; i < count; ++i) {
+        heads[i] = SPATIAL_ITEM_NULL;
+    }
+
+    return heads;
+}
+
+struct spatial_index *spatial_index_create(struct spatial_service *service,
+                                           struct spatial_index_info *info)
+{
+#ifdef DEBUG
+    if (info->cell_size <= 0) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Spatial index '%s' needs a positive cell size.\n",
+            info->name
+        );
+
+        abort();
+    }
+#endif // DEBUG
+
+    struct spatial_index *index = list_alloc(&service->indices);
+
+    index->name         = string_create(info->name);
+    index->type         = info->type;
+    index->free_head    = SPATIAL_ITEM_NULL;
+
+    if (info->type == SPATIAL_INDEX_HASH) {
+        index->cell_size    = info->cell_size;
+        index->slot_count   = SPATIAL_HASH_MIN_BUCKETS;
+    } else {
+        index->world        = info->world;
+        index->world_size   = max(
+            info->world.max.x - info->world.min.x,
+            info->world.max.y - info->world.min.y
+        );
+
+        while (index->depth < SPATIAL_QUADTREE_MAX_DEPTH &&
+               index->world_size/(2 << index->depth) >= info->cell_size)
+            ++index->depth;
+
+        for (int level = 0; level <= index->depth; ++level) {
+            index->level_offsets[level] = index->slot_count;
+            index->slot_count += 1 << 2*level;
+        }
+
+        index->cell_size = index->world_size/(1 << index->depth);
+    }
+
+    index->inverse_cell_size    = 1.0f/index->cell_size;
+    index->heads                = alloc_heads(index->slot_count);
+
+    return index;
+}
+
+void spatial_index_destroy(struct spatial_service *service, struct spatial_index *index)
+{
+    cleanup_index(index);
+    list_remove(&service->indices, index);
+}
+
+struct spatial_index *spatial_get_index(struct spatial_service *service, const char *name)
+{
+    list_for_each (struct spatial_index, index, service->indices) {
+        if (string_eq_ptr(name, index->name.chars))
+            return index;
+    }
+
+    return 0;
+}
+
+static int32_t to_cell(float coordinate)
+{
+    return floorf(fminf(fmaxf(coordinate, -CELL_LIMIT), CELL_LIMIT));
+}
+
+static uint32_t hash_cell(int32_t x, int32_t y)
+{
+    return ((uint32_t)x*73856093u) ^ ((uint32_t)y*19349663u);
+}
+
+static struct location locate(struct spatial_index *index, struct spatial_rect bounds)
+{
+    float centre_x = (bounds.min.x + bounds.max.x)*0.5f;
+    float centre_y = (bounds.min.y + bounds.max.y)*0.5f;
+
+    struct location location = { 0 };
+
+    if (index->type == SPATIAL_INDEX_HASH) {
+        location.x      = to_cell(centre_x*index->inverse_cell_size);
+        location.y      = to_cell(centre_y*index->inverse_cell_size);
+        location.slot   = hash_cell(location.x, location.y) & (index->slot_count - 1);
+
+        return location;
+    }
+
+    float local_x = (centre_x - index->world.min.x)/index->world_size;
+    float local_y = (centre_y - index->world.min.y)/index->world_size;
+
+    if (!(local_x >= 0 && local_x < 1 && local_y >= 0 && local_y < 1))
+        return location;
+
+    float size = max(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y);
+
+    int level = index->depth;
+
+    while (level > 0 && index->world_size/(1 << level) < size)
+        --level;
+
+    int dimension = 1 << level;
+
+    location.level  = level;
+    location.x      = min((int32_t)(local_x*dimension), dimension - 1);
+    location.y      = min((int32_t)(local_y*dimension), dimension - 1);
+    location.slot   = index->level_offsets[level] + location.y*dimension + location.x;
+
+    return location;
+}
+
+static void link_item(struct spatial_index *index, spatial_item_t item, struct location location)
+{
+    spatial_item_t head = index->heads[location.slot];
+
+    index->cell_x[item] = location.x;
+    index->cell_y[item] = location.y;
+    index->slot[item]   = location.slot;
+    index->level[item]  = location.level;
+    index->next[item]   = head;
+    index->prev[item]   = SPATIAL_ITEM_NULL;
+
+    if (head != SPATIAL_ITEM_NULL)
+        index->prev[head] = item;
+
+    index->heads[location.slot] = item;
+
+    ++index->level_counts[location.level];
+}
+
+static void unlink_item(struct spatial_index *index, spatial_item_t item)
+{
+    spatial_item_t next = index->next[item];
+    spatial_item_t prev = index->prev[item];
+
+    if (prev != SPATIAL_ITEM_NULL)
+        index->next[prev] = next;
+    else
+        index->heads[index->slot[item]] = next;
+
+    if (next != SPATIAL_ITEM_NULL)
+        index->prev[next] = prev;
+
+    --index->level_counts[index->level[item]];
+}
+
+static void grow_items(struct spatial_index *index)
+{
+    int old_capacity = index->item_capacity;
+    int capacity = max(old_capacity*2, MIN_ITEM_CAPACITY);
+
+    index->item_capacity    = capacity;
+    index->min_x            = realloc(index->min_x, capacity*sizeof(float));
+    index->min_y            = realloc(index->min_y, capacity*sizeof(float));
+    index->max_x            = realloc(index->max_x, capacity*sizeof(float));
+    index->max_y            = realloc(index->max_y, capacity*sizeof(float));
+    index->data             = realloc(index->data, capacity*sizeof(void *));
+    index->cell_x           = realloc(index->cell_x, capacity*sizeof(int32_t));
+    index->cell_y           = realloc(index->cell_y, capacity*sizeof(int32_t));
+    index->slot             = realloc(index->slot, capacity*sizeof(int32_t));
+    index->next             = realloc(index->next, capacity*sizeof(spatial_item_t));
+    index->prev             = realloc(index->prev, capacity*sizeof(spatial_item_t));
+    index->level            = realloc(index->level, capacity*sizeof(uint8_t));
+
+    // Free slots never overlap anything, so whole vectors can be tested past the last item.
+    for (int i = old_capacity; i < capacity; ++i) {
+        index->min_x[i] = NAN;
+        index->min_y[i] = NAN;
+        index->max_x[i] = NAN;
+        index->max_y[i] = NAN;
+        index->slot[i]  = -1;
+    }
+}
+
+static void rehash(struct spatial_index *index)
+{
+    free(index->heads);
+
+    index->slot_count       *= 2;
+    index->heads            = alloc_heads(index->slot_count);
+    index->level_counts[0]  = 0;
+
+    for (spatial_item_t item = 0; item < index->item_high; ++item) {
+        if (index->slot[item] < 0)
+            continue;
+
+        struct location location = {
+            .x      = index->cell_x[item],
+            .y      = index->cell_y[item],
+            .slot   = hash_cell(index->cell_x[item], index->cell_y[item]) & (index->slot_count - 1)
+        };
+
+        link_item(index, item, location);
+    }
+}
+
+static void store_bounds(struct spatial_index *index,
+                         spatial_item_t item,
+                         struct spatial_rect bounds)
+{
+#ifdef DEBUG
+    if (isnan(bounds.min.x) || isnan(bounds.min.y) || isnan(bounds.max.x) || isnan(bounds.max.y)) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Spatial index '%s' was given NaN bounds.\n",
+            index->name.chars
+        );
+
+        abort();
+    }
+#endif // DEBUG
+
+    index->min_x[item] = bounds.min.x;
+    index->min_y[item] = bounds.min.y;
+    index->max_x[item] = bounds.max.x;
+    index->max_y[item] = bounds.max.y;
+
+    if (index->type == SPATIAL_INDEX_HASH) {
+        float extent = max(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y)*0.5f;
+        index->max_extent = max(index->max_extent, extent);
+    }
+}
+
+spatial_item_t spatial_index_insert(struct spatial_index *index,
+                                    struct spatial_rect bounds,
+                                    void *data)
+{
+    spatial_item_t item = index->free_head;
+
+    if (item != SPATIAL_ITEM_NULL) {
+        index->free_head = index->next[item];
+    } else {
+        if (index->item_high == index->item_capacity)
+            grow_items(index);
+
+        item = index->item_high++;
+    }
+
+    index->data[item] = data;
+
+    store_bounds(index, item, bounds);
+    link_item(index, item, locate(index, bounds));
+
+    ++index->item_count;
+
+    if (index->type == SPATIAL_INDEX_HASH && index->item_count > index->slot_count)
+        rehash(index);
+
+    return item;
+}
+
+/*
+ * Cheap to call every frame for every item: the item is only moved between chains when its
+ * centre crosses into another cell, or for the quadtree when its size changes level.
+ */
+void spatial_index_update(struct spatial_index *index,
+                          spatial_item_t item,
+                          struct spatial_rect bounds)
+{
+    store_bounds(index, item, bounds);
+
+    struct location location = locate(index, bounds);
+
+    if (location.slot == index->slot[item]) {
+        // Different hash cells can share a bucket.
+        index->cell_x[item] = location.x;
+        index->cell_y[item] = location.y;
+        return;
+    }
+
+    unlink_item(index, item);
+    link_item(index, item, location);
+}
+
+void spatial_index_remove(struct spatial_index *index, spatial_item_t item)
+{
+    unlink_item(index, item);
+
+    index->min_x[item]  = NAN;
+    index->min_y[item]  = NAN;
+    index->max_x[item]  = NAN;
+    index->max_y[item]  = NAN;
+    index->data[item]   = 0;
+    index->slot[item]   = -1;
+    index->next[item]   = index->free_head;
+    index->free_head    = item;
+
+    --index->item_count;
+}
+
+static void push_hit(struct spatial_results *results, struct spatial_index *index, int item)
+{
+    if (results->count == results->capacity) {
+        results->capacity   = max(results->capacity*2, MIN_ITEM_CAPACITY);
+        results->hits       = realloc(results->hits, results->capacity*sizeof(struct spatial_hit));
+    }
+
+    results->hits[results->count++] = (struct spatial_hit){
+        .data   = index->data[item],
+        .item   = item
+    };
+}
+
+static bool_t overlaps(struct spatial_index *index, int item, struct spatial_rect rect)
+{
+    return index->min_x[item] <= rect.max.x && index->max_x[item] >= rect.min.x &&
+           index->min_y[item] <= rect.max.y && index->max_y[item] >= rect.min.y;
+}
+
+static void scan_rect(struct spatial_index *index,
+                      struct spatial_rect rect,
+                      struct spatial_results *results)
+{
+    simd4f_t rect_min_x = simd4f_set1(rect.min.x);
+    simd4f_t rect_min_y = simd4f_set1(rect.min.y);
+    simd4f_t rect_max_x = simd4f_set1(rect.max.x);
+    simd4f_t rect_max_y = simd4f_set1(rect.max.y);
+
+    for (int i = 0; i < index->item_high; i += 4) {
+        simd4f_t overlap = simd4f_and(
+            simd4f_and(
+                simd4f_cmple(simd4f_loadu(index->min_x + i), rect_max_x),
+                simd4f_cmpge(simd4f_loadu(index->max_x + i), rect_min_x)
+            ),
+            simd4f_and(
+                simd4f_cmple(simd4f_loadu(index->min_y + i), rect_max_y),
+                simd4f_cmpge(simd4f_loadu(index->max_y + i), rect_min_y)
+            )
+        );
+
+        int mask = simd4f_movemask(overlap);
+
+        for (int lane = 0; mask; ++lane, mask >>= 1) {
+            if (mask & 1)
+                push_hit(results, index, i + lane);
+        }
+    }
+}
+
+static void walk_chain(struct spatial_index *index,
+                       int32_t slot,
+                       struct spatial_rect rect,
+                       struct spatial_results *results)
+{
+    for (spatial_item_t item = index->heads[slot]; item != SPATIAL_ITEM_NULL;) {
+        if (overlaps(index, item, rect))
+            push_hit(results, index, item);
+
+        item = index->next[item];
+    }
+}
+
+static void collect_hash(struct spatial_index *index,
+                         struct spatial_rect rect,
+                         struct spatial_results *results)
+{
+    float pad = index->max_extent;
+
+    struct cell_range range = {
+        .x0 = to_cell((rect.min.x - pad)*index->inverse_cell_size),
+        .y0 = to_cell((rect.min.y - pad)*index->inverse_cell_size),
+        .x1 = to_cell((rect.max.x + pad)*index->inverse_cell_size),
+        .y1 = to_cell((rect.max.y + pad)*index->inverse_cell_size)
+    };
+
+    int64_t cell_count = (int64_t)(range.x1 - range.x0 + 1)*(range.y1 - range.y0 + 1);
+
+    if (cell_count > index->item_count) {
+        scan_rect(index, rect, results);
+        return;
+    }
+
+    for (int32_t y = range.y0; y <= range.y1; ++y) {
+        for (int32_t x = range.x0; x <= range.x1; ++x) {
+            int32_t slot = hash_cell(x, y) & (index->slot_count - 1);
+
+            // Other cells hashing to the same bucket are skipped, or they would be found twice.
+            for (spatial_item_t item = index->heads[slot]; item != SPATIAL_ITEM_NULL;) {
+                if (index->cell_x[item] == x && index->cell_y[item] == y &&
+                    overlaps(index, item, rect))
+                    push_hit(results, index, item);
+
+                item = index->next[item];
+            }
+        }
+    }
+}
+
+// Nodes of a level whose loose bounds, half a node past the node itself, touch the rect.
+static bool_t level_range(struct spatial_index *index,
+                          int level,
+                          struct spatial_rect rect,
+                          struct cell_range *range)
+{
+    int dimension = 1 << level;
+    float scale = dimension/index->world_size;
+
+    float x0 = (rect.min.x - index->world.min.x)*scale - 0.5f;
+    float y0 = (rect.min.y - index->world.min.y)*scale - 0.5f;
+    float x1 = (rect.max.x - index->world.min.x)*scale + 0.5f;
+    float y1 = (rect.max.y - index->world.min.y)*scale + 0.5f;
+
+    if (x1 < 0 || y1 < 0 || x0 >= dimension || y0 >= dimension)
+        return FALSE;
+
+    range->x0 = max(to_cell(x0), 0);
+    range->y0 = max(to_cell(y0), 0);
+    range->x1 = min(to_cell(x1), dimension - 1);
+    range->y1 = min(to_cell(y1), dimension - 1);
+
+    return TRUE;
+}
+
+static void collect_quadtree(struct spatial_index *index,
+                             struct spatial_rect rect,
+                             struct spatial_results *results)
+{
+    struct cell_range ranges[SPATIAL_QUADTREE_MAX_DEPTH + 1];
+    bool_t visible[SPATIAL_QUADTREE_MAX_DEPTH + 1];
+
+    int64_t cell_count = 0;
+
+    for (int level = 1; level <= index->depth; ++level) {
+        visible[level] = index->level_counts[level] &&
+                         level_range(index, level, rect, ranges + level);
+
+        if (visible[level])
+            cell_count += (int64_t)(ranges[level].x1 - ranges[level].x0 + 1)*
+                                   (ranges[level].y1 - ranges[level].y0 + 1);
+    }
+
+    if (cell_count > index->item_count) {
+        scan_rect(index, rect, results);
+        return;
+    }
+
+    // The root also holds everything centred outside the world, so it is always walked.
+    walk_chain(index, 0, rect, results);
+
+    for (int level = 1; level <= index->depth; ++level) {
+        if (!visible[level])
+            continue;
+
+        struct cell_range range = ranges[level];
+        int dimension = 1 << level;
+
+        for (int32_t y = range.y0; y <= range.y1; ++y) {
+            for (int32_t x = range.x0; x <= range.x1; ++x) {
+                walk_chain(index, index->level_offsets[level] + y*dimension + x, rect, results);
+            }
+        }
+    }
+}
+
+static void collect(struct spatial_index *index,
+                    struct spatial_rect rect,
+                    struct spatial_results *results)
+{
+    if (index->type == SPATIAL_INDEX_HASH)
+        collect_hash(index, rect, results);
+    else
+        collect_quadtree(index, rect, results);
+}
+
+void spatial_index_query_rect(struct spatial_index *index,
+                              struct spatial_rect rect,
+                              struct spatial_results *results)
+{
+    results->count = 0;
+
+    collect(index, rect, results);
+}
+
+void spatial_index_query_radius(struct spatial_index *index,
+                                struct vec2f centre,
+                                float radius,
+                                struct spatial_results *results)
+{
+    results->count = 0;
+
+    collect(
+        index,
+        spatial_rect(centre.x - radius, centre.y - radius, centre.x + radius, centre.y + radius),
+        results
+    );
+
+    int kept = 0;
+
+    for (int i = 0; i < results->count; ++i) {
+        spatial_item_t item = results->hits[i].item;
+
+        float dx = centre.x - max(index->min_x[item], min(centre.x, index->max_x[item]));
+        float dy = centre.y - max(index->min_y[item], min(centre.y, index->max_y[item]));
+
+        if (dx*dx + dy*dy <= radius*radius)
+            results->hits[kept++] = results->hits[i];
+    }
+
+    results->count = kept;
+}
+
+// Slab test of a single axis, narrowing the range of distances the ray spends in the bounds.
+static bool_t clip_axis(float origin,
+                        float direction,
+                        float low,
+                        float high,
+                        float *enter,
+                        float *exit)
+{
+    if (direction == 0)
+        return origin >= low && origin <= high;
+
+    float t0 = (low - origin)/direction;
+    float t1 = (high - origin)/direction;
+
+    *enter  = max(*enter, min(t0, t1));
+    *exit   = min(*exit, max(t0, t1));
+
+    return *enter <= *exit;
+}
+
+static int compare_hits(const void *a, const void *b)
+{
+    const struct spatial_hit *first = a;
+    const struct spatial_hit *second = b;
+
+    if (first->distance != second->distance)
+        return (first->distance < second->distance) ? -1 : 1;
+
+    return first->item - second->item;
+}
+
+/*
+ * Hits are sorted nearest first. The ray is walked in pieces a cell long, gathering the items
+ * around each piece, so a long ray through a sparse index only visits cells near it. An item
+ * spanning several pieces is found more than once, and the copies are dropped after sorting.
+ */
+void spatial_index_query_ray(struct spatial_index *index,
+                             struct vec2f origin,
+                             struct vec2f direction,
+                             float max_distance,
+                             struct spatial_results *results)
+{
+#ifdef DEBUG
+    if (!isfinite(max_distance)) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Rays cast into spatial index '%s' need a finite length.\n",
+            index->name.chars
+        );
+
+        abort();
+    }
+#endif // DEBUG
+
+    results->count = 0;
+
+    float length = sqrtf(direction.x*direction.x + direction.y*direction.y);
+
+    if (length == 0 || !index->item_count)
+        return;
+
+    direction = vec2f(direction.x/length, direction.y/length);
+
+    int pieces = max((int)ceilf(max_distance*index->inverse_cell_size), 1);
+
+    // Past this many pieces, one query over the ray's bounds is cheaper.
+    if (pieces > index->item_count)
+        pieces = 1;
+
+    for (int i = 0; i < pieces; ++i) {
+        float begin = max_distance*i/pieces;
+        float end = max_distance*(i + 1)/pieces;
+
+        float x0 = origin.x + direction.x*begin;
+        float y0 = origin.y + direction.y*begin;
+        float x1 = origin.x + direction.x*end;
+        float y1 = origin.y + direction.y*end;
+
+        collect(index, spatial_rect(min(x0, x1), min(y0, y1), max(x0, x1), max(y0, y1)), results);
+    }
+
+    int kept = 0;
+
+    for (int i = 0; i < results->count; ++i) {
+        spatial_item_t item = results->hits[i].item;
+
+        float enter = 0;
+        float exit = max_distance;
+
+        float min_x = index->min_x[item], max_x = index->max_x[item];
+        float min_y = index->min_y[item], max_y = index->max_y[item];
+
+        if (!clip_axis(origin.x, direction.x, min_x, max_x, &enter, &exit) ||
+            !clip_axis(origin.y, direction.y, min_y, max_y, &enter, &exit))
+            continue;
+
+        results->hits[i].distance = enter;
+        results->hits[kept++] = results->hits[i];
+    }
+
+    qsort(results->hits, kept, sizeof(struct spatial_hit), &compare_hits);
+
+    results->count = 0;
+
+    for (int i = 0; i < kept; ++i) {
+        if (results->count && results->hits[results->count - 1].item == results->hits[i].item)
+            continue;
+
+        results->hits[results->count++] = results->hits[i];
+    }
+}
+
+void spatial_results_destroy(struct spatial_results *results)
+{
+    free(results->hits);
+
+    results->hits       = 0;
+    results->count      = 0;
+    results->capacity   = 0;
+}
@@ -39,4 +39,66 @@ bool_t string_eq(struct string a, struct string b)
 bool_t string_eq_ptr(const char *a, const char *b)
 {
     return strcmp(a, b) == 0;
+}
+
+/*
+ * Decodes the code point starting at *position and moves *position past it. Malformed,
+ * overlong and truncated sequences, and encoded surrogates, decode one byte at a time as
+ * STRING_REPLACEMENT_CHARACTER.
+ */
+uint32_t string_decode_utf8(const char *chars, size_t length, size_t *position)
+{
+    const unsigned char *bytes = (const unsigned char *)chars + *position;
+    size_t available = length - *position;
+
+    uint32_t lead = bytes[0];
+
+    if (lead < 0x80) {
+        *position += 1;
+        return lead;
+    }
+
+    size_t count;
+    uint32_t code;
+    uint32_t smallest;
+
+    if ((lead & 0xe0) == 0xc0) {
+        count       = 2;
+        code        = lead & 0x1f;
+        smallest    = 0x80;
+    } else if ((lead & 0xf0) == 0xe0) {
+        count       = 3;
+        code        = lead & 0x0f;
+        smallest    = 0x800;
+    } else if ((lead & 0xf8) == 0xf0) {
+        count       = 4;
+        code        = lead & 0x07;
+        smallest    = 0x10000;
+    } else {
+        *position += 1;
+        return STRING_REPLACEMENT_CHARACTER;
+    }
+
+    if (available < count) {
+        *position += 1;
+        return STRING_REPLACEMENT_CHARACTER;
+    }
+
+    for (size_t i = 1; i < count; ++i) {
+        if ((bytes[i] & 0xc0) != 0x80) {
+            *position += 1;
+            return STRING_REPLACEMENT_CHARACTER;
+        }
+
+        code = (code << 6) | (bytes[i] & 0x3f);
+    }
+
+    if (code < smallest || code > 0x10ffff || (code >= 0xd800 && code <= 0xdfff)) {
+        *position += 1;
+        return STRING_REPLACEMENT_CHARACTER;
+    }
+
+    *position += count;
+
+    return code;
 }
\ No newline at end of file
@@ -0,0 +1,280 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <soul/debug.h>
+#include <soul/math/macros.h>
+#include <soul/thread_pool.h>
+
+static int get_processor_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return info.dwNumberOfProcessors;
+#else
+    return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+static bool_t pop_job(struct thread_pool_service *pool, struct job *job)
+{
+    if (!pool->job_count)
+        return FALSE;
+
+    *job = pool->jobs[pool->job_head];
+
+    pool->job_head = (pool->job_head + 1)%pool->job_capacity;
+    --pool->job_count;
+
+    return TRUE;
+}
+
+/*
+ * Takes the oldest queued job belonging to the group, keeping the rest in order. Waiting threads
+ * only help with their own group, so a wait on the render path never picks up an unrelated long
+ * job, such as a texture decode, that happens to be queued in front.
+ */
+static bool_t pop_group_job(struct thread_pool_service *pool,
+                            struct job_group *group,
+                            struct job *job)
+{
+    for (int i = 0; i < pool->job_count; ++i) {
+        if (pool->jobs[(pool->job_head + i)%pool->job_capacity].group != group)
+            continue;
+
+        *job = pool->jobs[(pool->job_head + i)%pool->job_capacity];
+
+        // Close the gap by moving the jobs in front of it back one slot.
+        for (int j = i; j > 0; --j) {
+            pool->jobs[(pool->job_head + j)%pool->job_capacity] =
+                pool->jobs[(pool->job_head + j - 1)%pool->job_capacity];
+        }
+
+        pool->job_head = (pool->job_head + 1)%pool->job_capacity;
+        --pool->job_count;
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+// Expects the mutex to be held, and returns with it held again.
+static void run_job(struct thread_pool_service *pool, struct job *job)
+{
+    pthread_mutex_unlock(&pool->mutex);
+
+    job->fn(job->data);
+
+    pthread_mutex_lock(&pool->mutex);
+
+    if (job->group)
+        --job->group->pending;
+
+    pthread_cond_broadcast(&pool->job_finished);
+}
+
+static void *worker_main(struct thread_pool_service *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+
+    for (;;) {
+        struct job job;
+
+        if (pop_job(pool, &job)) {
+            run_job(pool, &job);
+            continue;
+        }
+
+        // Queued jobs are drained before stopping so no submitted work is lost.
+        if (pool->stopping)
+            break;
+
+        pthread_cond_wait(&pool->job_available, &pool->mutex);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    return 0;
+}
+
+static void deallocate_service(struct thread_pool_service *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = TRUE;
+    pthread_cond_broadcast(&pool->job_available);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->thread_count; ++i) {
+        pthread_join(pool->threads[i], 0);
+    }
+
+    pthread_cond_destroy(&pool->job_available);
+    pthread_cond_destroy(&pool->job_finished);
+    pthread_mutex_destroy(&pool->mutex);
+
+    free(pool->threads);
+    free(pool->jobs);
+}
+
+void thread_pool_service_create_resource(struct soul_instance *soul_instance)
+{
+    struct thread_pool_service *pool = resource_create(
+        soul_instance,
+        THREAD_POOL_SERVICE,
+        sizeof(struct thread_pool_service),
+        (resource_deallocator_t)&deallocate_service
+    );
+
+    // The calling thread helps out while it waits, so leave it a core.
+    pool->thread_count  = max(get_processor_count() - 1, 1);
+    pool->threads       = malloc(pool->thread_count*sizeof(pthread_t));
+    pool->job_capacity  = THREAD_POOL_MIN_JOB_CAPACITY;
+    pool->jobs          = malloc(pool->job_capacity*sizeof(struct job));
+
+    pthread_mutex_init(&pool->mutex, 0);
+    pthread_cond_init(&pool->job_available, 0);
+    pthread_cond_init(&pool->job_finished, 0);
+
+    for (int i = 0; i < pool->thread_count; ++i) {
+        int result = pthread_create(
+            pool->threads + i,
+            0,
+            (void *(*)(void *))&worker_main,
+            pool
+        );
+
+        if (result) {
+            debug_log(
+                SEVERITY_ERROR,
+                "Failed to create thread_pool_service. Could not start worker %d.\n",
+                i
+            );
+
+            abort();
+        }
+    }
+}
+
+static void grow_jobs(struct thread_pool_service *pool)
+{
+    int capacity = pool->job_capacity*2;
+    struct job *jobs = malloc(capacity*sizeof(struct job));
+
+    for (int i = 0; i < pool->job_count; ++i) {
+        jobs[i] = pool->jobs[(pool->job_head + i)%pool->job_capacity];
+    }
+
+    free(pool->jobs);
+
+    pool->jobs          = jobs;
+    pool->job_capacity  = capacity;
+    pool->job_head      = 0;
+}
+
+void thread_pool_submit(struct thread_pool_service *pool,
+                        struct job_group *group,
+                        job_t fn,
+                        void *data)
+{
+    pthread_mutex_lock(&pool->mutex);
+
+    if (pool->job_count == pool->job_capacity)
+        grow_jobs(pool);
+
+    int tail = (pool->job_head + pool->job_count)%pool->job_capacity;
+
+    pool->jobs[tail] = (struct job){ fn, data, group };
+    ++pool->job_count;
+
+    if (group)
+        ++group->pending;
+
+    pthread_cond_signal(&pool->job_available);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void thread_pool_wait(struct thread_pool_service *pool, struct job_group *group)
+{
+    pthread_mutex_lock(&pool->mutex);
+
+    while (group->pending) {
+        struct job job;
+
+        if (pop_group_job(pool, group, &job))
+            run_job(pool, &job);
+        else
+            pthread_cond_wait(&pool->job_finished, &pool->mutex);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+int thread_pool_get_thread_count(struct thread_pool_service *pool)
+{
+    return pool->thread_count;
+}
+
+struct range_chunk
+{
+    range_job_t fn;
+    void *      data;
+    int         begin;
+    int         end;
+    int         index;
+};
+
+static void run_range_chunk(struct range_chunk *chunk)
+{
+    chunk->fn(chunk->begin, chunk->end, chunk->index, chunk->data);
+}
+
+/*
+ * Splits [0, count) into chunks of chunk_size and returns once all of them have run. Chunk
+ * boundaries depend only on count and chunk_size, so per chunk results stay deterministic. The
+ * calling thread takes the first chunk itself and helps with the rest while it waits.
+ */
+void thread_pool_parallel_for(struct thread_pool_service *pool,
+                              int count,
+                              int chunk_size,
+                              range_job_t fn,
+                              void *data)
+{
+    if (count <= 0)
+        return;
+
+    if (chunk_size <= 0)
+        chunk_size = THREAD_POOL_DEFAULT_CHUNK_SIZE;
+
+    int chunk_count = (count + chunk_size - 1)/chunk_size;
+
+    if (chunk_count == 1) {
+        fn(0, count, 0, data);
+        return;
+    }
+
+    struct range_chunk *chunks = malloc(chunk_count*sizeof(struct range_chunk));
+    struct job_group group = { 0 };
+
+    for (int i = 0; i < chunk_count; ++i) {
+        chunks[i] = (struct range_chunk){
+            fn,
+            data,
+            i*chunk_size,
+            min((i + 1)*chunk_size, count),
+            i
+        };
+
+        if (i)
+            thread_pool_submit(pool, &group, (job_t)&run_range_chunk, chunks + i);
+    }
+
+    run_range_chunk(chunks);
+    thread_pool_wait(pool, &group);
+
+    free(chunks);
+}
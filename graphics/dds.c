@@ -0,0 +1,1183 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include <soul/debug.h>
+#include <soul/math/macros.h>
+#include <soul/graphics/dds.h>
+
+#define DDS_MAGIC               0x20534444 // "DDS "
+#define DDS_HEADER_SIZE         124
+#define DDS_PIXELFORMAT_SIZE    32
+
+#define DDSD_CAPS           0x1
+#define DDSD_HEIGHT         0x2
+#define DDSD_WIDTH          0x4
+#define DDSD_PIXELFORMAT    0x1000
+#define DDSD_MIPMAPCOUNT    0x20000
+#define DDSD_LINEARSIZE     0x80000
+
+#define DDPF_FOURCC         0x4
+
+#define DDSCAPS_COMPLEX     0x8
+#define DDSCAPS_TEXTURE     0x1000
+#define DDSCAPS_MIPMAP      0x400000
+
+#define DXGI_FORMAT_BC1_UNORM       71
+#define DXGI_FORMAT_BC1_UNORM_SRGB  72
+#define DXGI_FORMAT_BC3_UNORM       77
+#define DXGI_FORMAT_BC3_UNORM_SRGB  78
+#define DXGI_FORMAT_BC4_UNORM       80
+#define DXGI_FORMAT_BC7_UNORM       98
+#define DXGI_FORMAT_BC7_UNORM_SRGB  99
+
+// Stored in an unused header field by dds_encode_file(), whose rows run bottom-up.
+#define DDS_BOTTOM_UP_FIELD 7
+#define DDS_BOTTOM_UP_TAG   fourcc('S', 'B', 'T', 'U')
+
+#define fourcc(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | \
+                            ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+struct dds_pixelformat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourcc;
+    uint32_t rgb_bit_count;
+    uint32_t masks[4];
+};
+
+struct dds_header
+{
+    uint32_t                size;
+    uint32_t                flags;
+    uint32_t                height;
+    uint32_t                width;
+    uint32_t                pitch_or_linear_size;
+    uint32_t                depth;
+    uint32_t                mip_map_count;
+    uint32_t                reserved_a[11];
+    struct dds_pixelformat  pixelformat;
+    uint32_t                caps[4];
+    uint32_t                reserved_b;
+};
+
+struct dds_header_dx10
+{
+    uint32_t dxgi_format;
+    uint32_t resource_dimension;
+    uint32_t misc_flag;
+    uint32_t array_size;
+    uint32_t misc_flags;
+};
+
+static int block_size(texture_format_t format)
+{
+    switch (format) {
+        case TEXTURE_FORMAT_BC1:
+        case TEXTURE_FORMAT_BC4:
+            return 8;
+
+        default:
+            return 16;
+    }
+}
+
+size_t dds_level_size(texture_format_t format, int width, int height)
+{
+    size_t blocks_x = max((width + 3)/4, 1);
+    size_t blocks_y = max((height + 3)/4, 1);
+
+    return blocks_x*blocks_y*block_size(format);
+}
+
+bool_t dds_is_path(const char *path)
+{
+    size_t length = strlen(path);
+
+    if (length < 4)
+        return FALSE;
+
+    const char *extension = path + length - 4;
+
+    return strcmp(extension, ".dds") == 0 || strcmp(extension, ".DDS") == 0;
+}
+
+static unsigned char *read_binary_file(const char *path, size_t *bytes)
+{
+    FILE *file = fopen(path, "rb");
+
+    if (!file)
+        return 0;
+
+    fseek(file, 0, SEEK_END);
+    *bytes = ftell(file);
+    rewind(file);
+
+    unsigned char *buffer = malloc(*bytes);
+
+    if (fread(buffer, 1, *bytes, file) != *bytes) {
+        free(buffer);
+        buffer = 0;
+    }
+
+    fclose(file);
+
+    return buffer;
+}
+
+static texture_format_t format_from_dxgi(uint32_t dxgi_format)
+{
+    switch (dxgi_format) {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+            return TEXTURE_FORMAT_BC1;
+
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+            return TEXTURE_FORMAT_BC3;
+
+        case DXGI_FORMAT_BC4_UNORM:
+            return TEXTURE_FORMAT_BC4;
+
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return TEXTURE_FORMAT_BC7;
+
+        default:
+            return TEXTURE_FORMAT_UNCOMPRESSED;
+    }
+}
+
+static texture_format_t format_from_fourcc(uint32_t code)
+{
+    if (code == fourcc('D', 'X', 'T', '1'))
+        return TEXTURE_FORMAT_BC1;
+
+    if (code == fourcc('D', 'X', 'T', '5'))
+        return TEXTURE_FORMAT_BC3;
+
+    if (code == fourcc('A', 'T', 'I', '1') || code == fourcc('B', 'C', '4', 'U'))
+        return TEXTURE_FORMAT_BC4;
+
+    return TEXTURE_FORMAT_UNCOMPRESSED;
+}
+
+result_t dds_load(const char *path, struct dds_image *image)
+{
+    size_t bytes = 0;
+    unsigned char *file = read_binary_file(path, &bytes);
+
+    if (!file) {
+        debug_log(SEVERITY_WARNING, "Failed to load dds '%s'. Could not read file.\n", path);
+        return FAIL;
+    }
+
+    size_t offset = sizeof(uint32_t) + sizeof(struct dds_header);
+
+    struct dds_header header;
+    uint32_t magic;
+
+    if (bytes < offset) {
+        free(file);
+        return FAIL;
+    }
+
+    memcpy(&magic, file, sizeof(uint32_t));
+    memcpy(&header, file + sizeof(uint32_t), sizeof(struct dds_header));
+
+    if (magic != DDS_MAGIC || !(header.pixelformat.flags & DDPF_FOURCC)) {
+        debug_log(SEVERITY_WARNING, "Failed to load dds '%s'. Unsupported header.\n", path);
+
+        free(file);
+        return FAIL;
+    }
+
+    if (header.pixelformat.fourcc == fourcc('D', 'X', '1', '0')) {
+        if (bytes < offset + sizeof(struct dds_header_dx10)) {
+            free(file);
+            return FAIL;
+        }
+
+        struct dds_header_dx10 dx10;
+        memcpy(&dx10, file + offset, sizeof(struct dds_header_dx10));
+
+        offset += sizeof(struct dds_header_dx10);
+        image->format = format_from_dxgi(dx10.dxgi_format);
+    } else {
+        image->format = format_from_fourcc(header.pixelformat.fourcc);
+    }
+
+    if (image->format == TEXTURE_FORMAT_UNCOMPRESSED) {
+        debug_log(SEVERITY_WARNING, "Failed to load dds '%s'. Unsupported format.\n", path);
+
+        free(file);
+        return FAIL;
+    }
+
+    image->width            = header.width;
+    image->height           = header.height;
+    image->channel_count    = (image->format == TEXTURE_FORMAT_BC4) ? 1 : 4;
+    image->bottom_up        = header.reserved_a[DDS_BOTTOM_UP_FIELD] == DDS_BOTTOM_UP_TAG;
+    image->mip_count        = (header.flags & DDSD_MIPMAPCOUNT) ? header.mip_map_count : 1;
+    image->mip_count        = min(max(image->mip_count, 1), DDS_MAX_MIP_COUNT);
+    image->data             = file;
+
+    int width = image->width, height = image->height;
+
+    for (int i = 0; i < image->mip_count; ++i) {
+        image->level_offsets[i] = offset;
+        image->level_sizes[i]   = dds_level_size(image->format, width, height);
+
+        offset += image->level_sizes[i];
+
+        width   = max(width/2, 1);
+        height  = max(height/2, 1);
+    }
+
+    if (offset > bytes) {
+        debug_log(SEVERITY_WARNING, "Failed to load dds '%s'. File is truncated.\n", path);
+
+        free(file);
+        return FAIL;
+    }
+
+    return SUCCESS;
+}
+
+void dds_free(struct dds_image *image)
+{
+    free(image->data);
+    image->data = 0;
+}
+
+static uint16_t pack_565(const unsigned char *colour)
+{
+    return ((colour[0]*31 + 127)/255) << 11 |
+           ((colour[1]*63 + 127)/255) << 5 |
+           ((colour[2]*31 + 127)/255);
+}
+
+static void unpack_565(uint16_t packed, int *colour)
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+
+    colour[0] = (r << 3) | (r >> 2);
+    colour[1] = (g << 2) | (g >> 4);
+    colour[2] = (b << 3) | (b >> 2);
+}
+
+static void write_u16(unsigned char *destination, uint16_t value)
+{
+    destination[0] = value & 0xff;
+    destination[1] = value >> 8;
+}
+
+/*
+ * Range fit: the block end points are the corners of the colour bounding box, and every pixel
+ * takes the nearest of the four palette entries.
+ */
+static void encode_bc1_block(const unsigned char *block, unsigned char *destination)
+{
+    int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 };
+
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            low[c] = min(low[c], block[i*4 + c]);
+            high[c] = max(high[c], block[i*4 + c]);
+        }
+    }
+
+    // Inset the box slightly so the end points are not dragged out by outliers.
+    unsigned char end_a[3], end_b[3];
+
+    for (int c = 0; c < 3; ++c) {
+        int inset = (high[c] - low[c])/16;
+
+        end_a[c] = high[c] - inset;
+        end_b[c] = low[c] + inset;
+    }
+
+    uint16_t colour_a = pack_565(end_a);
+    uint16_t colour_b = pack_565(end_b);
+
+    if (colour_a < colour_b) {
+        uint16_t tmp = colour_a;
+        colour_a = colour_b;
+        colour_b = tmp;
+    }
+
+    write_u16(destination, colour_a);
+    write_u16(destination + 2, colour_b);
+
+    uint32_t indices = 0;
+
+    if (colour_a != colour_b) {
+        int palette[4][3];
+        unpack_565(colour_a, palette[0]);
+        unpack_565(colour_b, palette[1]);
+
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2*palette[0][c] + palette[1][c])/3;
+            palette[3][c] = (palette[0][c] + 2*palette[1][c])/3;
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, best_error = 0x7fffffff;
+
+            for (int p = 0; p < 4; ++p) {
+                int error = 0;
+
+                for (int c = 0; c < 3; ++c) {
+                    int d = block[i*4 + c] - palette[p][c];
+                    error += d*d;
+                }
+
+                if (error < best_error) {
+                    best_error  = error;
+                    best        = p;
+                }
+            }
+
+            indices |= (uint32_t)best << (i*2);
+        }
+    }
+
+    destination[4] = indices & 0xff;
+    destination[5] = (indices >> 8) & 0xff;
+    destination[6] = (indices >> 16) & 0xff;
+    destination[7] = indices >> 24;
+}
+
+static void encode_bc4_block(const unsigned char *block, int channel, unsigned char *destination)
+{
+    int low = 255, high = 0;
+
+    for (int i = 0; i < 16; ++i) {
+        low = min(low, block[i*4 + channel]);
+        high = max(high, block[i*4 + channel]);
+    }
+
+    destination[0] = high;
+    destination[1] = low;
+
+    uint64_t indices = 0;
+
+    if (high != low) {
+        int palette[8] = { high, low };
+
+        for (int p = 1; p < 7; ++p) {
+            palette[p + 1] = ((7 - p)*high + p*low)/7;
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, best_error = 256;
+
+            for (int p = 0; p < 8; ++p) {
+                int error = abs(block[i*4 + channel] - palette[p]);
+
+                if (error < best_error) {
+                    best_error  = error;
+                    best        = p;
+                }
+            }
+
+            indices |= (uint64_t)best << (i*3);
+        }
+    }
+
+    for (int i = 0; i < 6; ++i) {
+        destination[2 + i] = (indices >> (i*8)) & 0xff;
+    }
+}
+
+static void fetch_block(const unsigned char *rgba,
+                        int width,
+                        int height,
+                        int block_x,
+                        int block_y,
+                        unsigned char *block)
+{
+    for (int y = 0; y < 4; ++y) {
+        int source_y = min(block_y*4 + y, height - 1);
+
+        for (int x = 0; x < 4; ++x) {
+            int source_x = min(block_x*4 + x, width - 1);
+
+            memcpy(block + (y*4 + x)*4, rgba + (source_y*width + source_x)*4, 4);
+        }
+    }
+}
+
+static void encode_level(const unsigned char *rgba,
+                         int width,
+                         int height,
+                         texture_format_t format,
+                         unsigned char *destination)
+{
+    int blocks_x = max((width + 3)/4, 1);
+    int blocks_y = max((height + 3)/4, 1);
+
+    unsigned char block[64];
+
+    for (int y = 0; y < blocks_y; ++y) {
+        for (int x = 0; x < blocks_x; ++x) {
+            fetch_block(rgba, width, height, x, y, block);
+
+            switch (format) {
+                case TEXTURE_FORMAT_BC1:
+                    encode_bc1_block(block, destination);
+                    break;
+
+                case TEXTURE_FORMAT_BC3:
+                    encode_bc4_block(block, 3, destination);
+                    encode_bc1_block(block, destination + 8);
+                    break;
+
+                case TEXTURE_FORMAT_BC4:
+                    encode_bc4_block(block, 0, destination);
+                    break;
+            }
+
+            destination += block_size(format);
+        }
+    }
+}
+
+static unsigned char *downsample(const unsigned char *rgba, int width, int height)
+{
+    int half_width = max(width/2, 1);
+    int half_height = max(height/2, 1);
+
+    unsigned char *result = malloc(half_width*half_height*4);
+
+    for (int y = 0; y < half_height; ++y) {
+        int y0 = min(y*2, height - 1), y1 = min(y*2 + 1, height - 1);
+
+        for (int x = 0; x < half_width; ++x) {
+            int x0 = min(x*2, width - 1), x1 = min(x*2 + 1, width - 1);
+
+            for (int c = 0; c < 4; ++c) {
+                int sum = rgba[(y0*width + x0)*4 + c] + rgba[(y0*width + x1)*4 + c] +
+                          rgba[(y1*width + x0)*4 + c] + rgba[(y1*width + x1)*4 + c];
+
+                result[(y*half_width + x)*4 + c] = (sum + 2)/4;
+            }
+        }
+    }
+
+    return result;
+}
+
+static unsigned char *expand_to_rgba(unsigned char *pixels, int width, int height, int channels)
+{
+    unsigned char *rgba = malloc(width*height*4);
+
+    for (int i = 0; i < width*height; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            if (c < channels)
+                rgba[i*4 + c] = pixels[i*channels + c];
+            else
+                rgba[i*4 + c] = (c == 3) ? 255 : pixels[i*channels];
+        }
+    }
+
+    return rgba;
+}
+
+static void write_header(FILE *file, texture_format_t format, int width, int height, int mips)
+{
+    struct dds_header header = {
+        .size                   = DDS_HEADER_SIZE,
+        .flags                  = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT |
+                                  DDSD_LINEARSIZE,
+        .height                 = height,
+        .width                  = width,
+        .pitch_or_linear_size   = dds_level_size(format, width, height),
+        .mip_map_count          = mips,
+        .pixelformat.size       = DDS_PIXELFORMAT_SIZE,
+        .pixelformat.flags      = DDPF_FOURCC,
+        .caps[0]                = DDSCAPS_TEXTURE
+    };
+
+    header.reserved_a[DDS_BOTTOM_UP_FIELD] = DDS_BOTTOM_UP_TAG;
+
+    if (mips > 1) {
+        header.flags    |= DDSD_MIPMAPCOUNT;
+        header.caps[0]  |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    }
+
+    switch (format) {
+        case TEXTURE_FORMAT_BC1:
+            header.pixelformat.fourcc = fourcc('D', 'X', 'T', '1');
+            break;
+
+        case TEXTURE_FORMAT_BC3:
+            header.pixelformat.fourcc = fourcc('D', 'X', 'T', '5');
+            break;
+
+        case TEXTURE_FORMAT_BC4:
+            header.pixelformat.fourcc = fourcc('A', 'T', 'I', '1');
+            break;
+    }
+
+    uint32_t magic = DDS_MAGIC;
+
+    fwrite(&magic, sizeof(uint32_t), 1, file);
+    fwrite(&header, sizeof(struct dds_header), 1, file);
+}
+
+result_t dds_encode_file(const char *source_path,
+                         const char *destination_path,
+                         texture_format_t format,
+                         bool_t generate_mip_maps)
+{
+    if (format != TEXTURE_FORMAT_BC1 && format != TEXTURE_FORMAT_BC3 &&
+        format != TEXTURE_FORMAT_BC4) {
+        debug_log(
+            SEVERITY_WARNING,
+            "Failed to encode '%s'. Only BC1, BC3 and BC4 can be encoded.\n",
+            source_path
+        );
+
+        return FAIL;
+    }
+
+    int width, height, channel_count;
+    unsigned char *pixels = texture_load_image(
+        source_path,
+        &width,
+        &height,
+        &channel_count,
+        TRUE
+    );
+
+    if (!pixels)
+        return FAIL;
+
+    FILE *file = fopen(destination_path, "wb");
+
+    if (!file) {
+        debug_log(
+            SEVERITY_WARNING,
+            "Failed to encode '%s'. Could not open '%s'.\n",
+            source_path,
+            destination_path
+        );
+
+        free(pixels);
+        return FAIL;
+    }
+
+    unsigned char *level = expand_to_rgba(pixels, width, height, channel_count);
+    free(pixels);
+
+    int mip_count = 1;
+
+    if (generate_mip_maps) {
+        while ((width >> mip_count) || (height >> mip_count))
+            ++mip_count;
+
+        mip_count = min(mip_count, DDS_MAX_MIP_COUNT);
+    }
+
+    write_header(file, format, width, height, mip_count);
+
+    unsigned char *blocks = malloc(dds_level_size(format, width, height));
+
+    for (int i = 0; i < mip_count; ++i) {
+        size_t size = dds_level_size(format, width, height);
+
+        encode_level(level, width, height, format, blocks);
+        fwrite(blocks, 1, size, file);
+
+        if (i + 1 < mip_count) {
+            unsigned char *next = downsample(level, width, height);
+            free(level);
+
+            level   = next;
+            width   = max(width/2, 1);
+            height  = max(height/2, 1);
+        }
+    }
+
+    free(blocks);
+    free(level);
+    fclose(file);
+
+    return SUCCESS;
+}
+// Reverses the first row_count rows of a BC1 colour block, which holds a byte of indices a row.
+static void flip_bc1_block(unsigned char *block, int row_count)
+{
+    unsigned char *rows = block + 4;
+
+    for (int i = 0; i < row_count/2; ++i) {
+        unsigned char row = rows[i];
+
+        rows[i]                 = rows[row_count - 1 - i];
+        rows[row_count - 1 - i] = row;
+    }
+}
+
+// Reverses the first row_count rows of a BC4 block, which holds twelve bits of indices a row.
+static void flip_bc4_block(unsigned char *block, int row_count)
+{
+    uint64_t indices = 0;
+
+    for (int i = 0; i < 6; ++i) {
+        indices |= (uint64_t)block[2 + i] << (i*8);
+    }
+
+    uint64_t flipped = indices;
+
+    for (int i = 0; i < row_count; ++i) {
+        uint64_t row = (indices >> (i*12)) & 0xfff;
+        int destination = row_count - 1 - i;
+
+        flipped &= ~((uint64_t)0xfff << (destination*12));
+        flipped |= row << (destination*12);
+    }
+
+    for (int i = 0; i < 6; ++i) {
+        block[2 + i] = (flipped >> (i*8)) & 0xff;
+    }
+}
+
+static void flip_level_blocks(unsigned char *level, texture_format_t format, int width, int height)
+{
+    int blocks_x = max((width + 3)/4, 1);
+    int blocks_y = max((height + 3)/4, 1);
+    size_t row_size = blocks_x*block_size(format);
+
+    unsigned char *row = malloc(row_size);
+
+    for (int y = 0; y < blocks_y/2; ++y) {
+        unsigned char *top = level + y*row_size;
+        unsigned char *bottom = level + (blocks_y - 1 - y)*row_size;
+
+        memcpy(row, top, row_size);
+        memcpy(top, bottom, row_size);
+        memcpy(bottom, row, row_size);
+    }
+
+    free(row);
+
+    // Levels shorter than a block only use its top rows, and only those are reversed.
+    int row_count = min(height, 4);
+
+    for (int i = 0; i < blocks_x*blocks_y; ++i) {
+        unsigned char *block = level + i*block_size(format);
+
+        switch (format) {
+            case TEXTURE_FORMAT_BC1:
+                flip_bc1_block(block, row_count);
+                break;
+
+            case TEXTURE_FORMAT_BC3:
+                flip_bc4_block(block, row_count);
+                flip_bc1_block(block + 8, row_count);
+                break;
+
+            case TEXTURE_FORMAT_BC4:
+                flip_bc4_block(block, row_count);
+                break;
+        }
+    }
+}
+
+static uint16_t read_u16(const unsigned char *source)
+{
+    return source[0] | source[1] << 8;
+}
+
+static void decode_bc1_block(const unsigned char *block, bool_t has_alpha, unsigned char *pixels)
+{
+    uint16_t colour_a = read_u16(block);
+    uint16_t colour_b = read_u16(block + 2);
+
+    int palette[4][4];
+    unpack_565(colour_a, palette[0]);
+    unpack_565(colour_b, palette[1]);
+
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+    // BC3 colour blocks always use four colours, BC1 ones with ordered end points use three.
+    if (colour_a > colour_b || !has_alpha) {
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2*palette[0][c] + palette[1][c])/3;
+            palette[3][c] = (palette[0][c] + 2*palette[1][c])/3;
+        }
+    } else {
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (palette[0][c] + palette[1][c])/2;
+            palette[3][c] = 0;
+        }
+
+        palette[3][3] = 0;
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        int index = (block[4 + i/4] >> ((i%4)*2)) & 3;
+
+        for (int c = 0; c < 4; ++c) {
+            pixels[i*4 + c] = palette[index][c];
+        }
+    }
+}
+
+static void decode_bc4_block(const unsigned char *block,
+                             int channel,
+                             int channel_count,
+                             unsigned char *pixels)
+{
+    int palette[8] = { block[0], block[1] };
+
+    if (palette[0] > palette[1]) {
+        for (int p = 1; p < 7; ++p) {
+            palette[p + 1] = ((7 - p)*palette[0] + p*palette[1])/7;
+        }
+    } else {
+        for (int p = 1; p < 5; ++p) {
+            palette[p + 1] = ((5 - p)*palette[0] + p*palette[1])/5;
+        }
+
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+
+    for (int i = 0; i < 6; ++i) {
+        indices |= (uint64_t)block[2 + i] << (i*8);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        pixels[i*channel_count + channel] = palette[(indices >> (i*3)) & 7];
+    }
+}
+
+struct bc7_mode
+{
+    int subset_count;
+    int partition_bits;
+    int rotation_bits;
+    int index_selection_bits;
+    int colour_bits;
+    int alpha_bits;
+    int endpoint_pbits;
+    int shared_pbits;
+    int index_bits;
+    int secondary_index_bits;
+};
+
+static const struct bc7_mode bc7_modes[8] = {
+    { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+    { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+    { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+    { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+    { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+    { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+    { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+    { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+};
+
+// Bit i is the subset of pixel i.
+static const uint16_t bc7_partitions_2[64] = {
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+    0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+    0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+    0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+    0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+    0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+    0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+    0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+};
+
+static const unsigned char bc7_partitions_3[64][16] = {
+    { 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 },
+    { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+    { 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+    { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 },
+    { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+    { 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 },
+    { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 },
+    { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+    { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+    { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+    { 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 },
+    { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+    { 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+    { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+    { 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 },
+    { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+    { 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 },
+    { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+    { 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 },
+    { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+    { 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 },
+    { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+    { 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 },
+    { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+    { 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 },
+    { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+    { 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 },
+    { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+    { 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 },
+    { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+    { 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+    { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+    { 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 },
+    { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+    { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 },
+    { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+    { 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 },
+    { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+    { 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 },
+    { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 },
+    { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+    { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 },
+    { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+    { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 },
+    { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+    { 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 },
+    { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+    { 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 },
+    { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+    { 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 },
+    { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+    { 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+    { 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 },
+    { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+    { 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+    { 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 },
+    { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+    { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 },
+    { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+};
+
+// The pixels whose index drops its top bit, for subsets after the first.
+static const unsigned char bc7_anchors_2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+     6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+};
+
+static const unsigned char bc7_anchors_3[2][64] = {
+    {
+         3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+         3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+         8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+         3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+    },
+    {
+        15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+        15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+        15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+        15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+    }
+};
+
+static const unsigned char bc7_weights_2[4] = { 0, 21, 43, 64 };
+static const unsigned char bc7_weights_3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const unsigned char bc7_weights_4[16] = {
+    0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+};
+
+static int read_bits(const unsigned char *block, int *position, int count)
+{
+    int value = 0;
+
+    for (int i = 0; i < count; ++i, ++*position) {
+        value |= ((block[*position/8] >> (*position%8)) & 1) << i;
+    }
+
+    return value;
+}
+
+static int bc7_subset(int subset_count, int partition, int pixel)
+{
+    switch (subset_count) {
+        case 2:
+            return (bc7_partitions_2[partition] >> pixel) & 1;
+
+        case 3:
+            return bc7_partitions_3[partition][pixel];
+
+        default:
+            return 0;
+    }
+}
+
+static bool_t bc7_is_anchor(int subset_count, int partition, int pixel)
+{
+    if (pixel == 0)
+        return TRUE;
+
+    if (subset_count == 2)
+        return pixel == bc7_anchors_2[partition];
+
+    if (subset_count == 3)
+        return pixel == bc7_anchors_3[0][partition] || pixel == bc7_anchors_3[1][partition];
+
+    return FALSE;
+}
+
+static int bc7_interpolate(int a, int b, int index, int index_bits)
+{
+    const unsigned char *weights = index_bits == 2 ? bc7_weights_2 :
+                                   index_bits == 3 ? bc7_weights_3 : bc7_weights_4;
+
+    return ((64 - weights[index])*a + weights[index]*b + 32) >> 6;
+}
+
+// Widens an end point to eight bits by repeating its top bits below it.
+static int bc7_expand(int value, int bits)
+{
+    value <<= 8 - bits;
+
+    return value | (value >> bits);
+}
+
+static void decode_bc7_block(const unsigned char *block, unsigned char *pixels)
+{
+    int mode_index = 0;
+
+    while (mode_index < 8 && !(block[0] & (1 << mode_index)))
+        ++mode_index;
+
+    // Reserved modes decode to transparent black.
+    if (mode_index == 8) {
+        memset(pixels, 0, 64);
+        return;
+    }
+
+    const struct bc7_mode *mode = bc7_modes + mode_index;
+    int position = mode_index + 1;
+
+    int partition = read_bits(block, &position, mode->partition_bits);
+    int rotation = read_bits(block, &position, mode->rotation_bits);
+    int index_selection = read_bits(block, &position, mode->index_selection_bits);
+
+    int endpoints[3][2][4];
+
+    for (int c = 0; c < 3; ++c) {
+        for (int s = 0; s < mode->subset_count; ++s) {
+            endpoints[s][0][c] = read_bits(block, &position, mode->colour_bits);
+            endpoints[s][1][c] = read_bits(block, &position, mode->colour_bits);
+        }
+    }
+
+    for (int s = 0; s < mode->subset_count; ++s) {
+        endpoints[s][0][3] = read_bits(block, &position, mode->alpha_bits);
+        endpoints[s][1][3] = read_bits(block, &position, mode->alpha_bits);
+    }
+
+    int pbits[3][2] = { 0 };
+
+    for (int s = 0; s < mode->subset_count; ++s) {
+        if (mode->endpoint_pbits) {
+            pbits[s][0] = read_bits(block, &position, 1);
+            pbits[s][1] = read_bits(block, &position, 1);
+        } else if (mode->shared_pbits) {
+            pbits[s][0] = pbits[s][1] = read_bits(block, &position, 1);
+        }
+    }
+
+    int pbit_count = mode->endpoint_pbits || mode->shared_pbits;
+
+    for (int s = 0; s < mode->subset_count; ++s) {
+        for (int e = 0; e < 2; ++e) {
+            for (int c = 0; c < 3; ++c) {
+                int value = (endpoints[s][e][c] << pbit_count) | (pbits[s][e] & pbit_count);
+                endpoints[s][e][c] = bc7_expand(value, mode->colour_bits + pbit_count);
+            }
+
+            if (mode->alpha_bits) {
+                int value = (endpoints[s][e][3] << pbit_count) | (pbits[s][e] & pbit_count);
+                endpoints[s][e][3] = bc7_expand(value, mode->alpha_bits + pbit_count);
+            } else {
+                endpoints[s][e][3] = 255;
+            }
+        }
+    }
+
+    int indices[16], secondary_indices[16];
+
+    for (int i = 0; i < 16; ++i) {
+        int bits = mode->index_bits - bc7_is_anchor(mode->subset_count, partition, i);
+        indices[i] = read_bits(block, &position, bits);
+    }
+
+    for (int i = 0; i < 16 && mode->secondary_index_bits; ++i) {
+        int bits = mode->secondary_index_bits - (i == 0);
+        secondary_indices[i] = read_bits(block, &position, bits);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        int (*subset)[4] = endpoints[bc7_subset(mode->subset_count, partition, i)];
+        unsigned char *pixel = pixels + i*4;
+
+        int colour_index = indices[i], colour_bits = mode->index_bits;
+        int alpha_index = indices[i], alpha_bits = mode->index_bits;
+
+        if (mode->secondary_index_bits) {
+            if (index_selection) {
+                colour_index    = secondary_indices[i];
+                colour_bits     = mode->secondary_index_bits;
+            } else {
+                alpha_index     = secondary_indices[i];
+                alpha_bits      = mode->secondary_index_bits;
+            }
+        }
+
+        for (int c = 0; c < 3; ++c) {
+            pixel[c] = bc7_interpolate(subset[0][c], subset[1][c], colour_index, colour_bits);
+        }
+
+        pixel[3] = bc7_interpolate(subset[0][3], subset[1][3], alpha_index, alpha_bits);
+
+        if (rotation) {
+            unsigned char swap = pixel[3];
+
+            pixel[3]            = pixel[rotation - 1];
+            pixel[rotation - 1] = swap;
+        }
+    }
+}
+
+static void decode_block(const unsigned char *block,
+                         texture_format_t format,
+                         unsigned char *pixels)
+{
+    switch (format) {
+        case TEXTURE_FORMAT_BC1:
+            decode_bc1_block(block, TRUE, pixels);
+            break;
+
+        case TEXTURE_FORMAT_BC3:
+            decode_bc1_block(block + 8, FALSE, pixels);
+            decode_bc4_block(block, 3, 4, pixels);
+            break;
+
+        case TEXTURE_FORMAT_BC4:
+            decode_bc4_block(block, 0, 1, pixels);
+            break;
+
+        case TEXTURE_FORMAT_BC7:
+            decode_bc7_block(block, pixels);
+            break;
+    }
+}
+
+// Decodes a level into rows of channel_count bytes per pixel, written bottom row first.
+static void decode_level_flipped(const unsigned char *blocks,
+                                 texture_format_t format,
+                                 int channel_count,
+                                 int width,
+                                 int height,
+                                 unsigned char *destination)
+{
+    int blocks_x = max((width + 3)/4, 1);
+    int blocks_y = max((height + 3)/4, 1);
+
+    unsigned char pixels[64];
+
+    for (int by = 0; by < blocks_y; ++by) {
+        for (int bx = 0; bx < blocks_x; ++bx) {
+            decode_block(blocks, format, pixels);
+            blocks += block_size(format);
+
+            for (int y = 0; y < 4 && by*4 + y < height; ++y) {
+                int x_count = min(width - bx*4, 4);
+                unsigned char *row = destination +
+                                     ((height - 1 - (by*4 + y))*width + bx*4)*channel_count;
+
+                memcpy(row, pixels + y*4*channel_count, x_count*channel_count);
+            }
+        }
+    }
+}
+
+static void decode_flipped(struct dds_image *image)
+{
+    size_t offsets[DDS_MAX_MIP_COUNT], sizes[DDS_MAX_MIP_COUNT];
+    size_t size = 0;
+
+    int width = image->width, height = image->height;
+
+    for (int i = 0; i < image->mip_count; ++i) {
+        offsets[i]  = size;
+        sizes[i]    = (size_t)width*height*image->channel_count;
+        size       += sizes[i];
+
+        width   = max(width/2, 1);
+        height  = max(height/2, 1);
+    }
+
+    unsigned char *pixels = malloc(size);
+
+    width = image->width, height = image->height;
+
+    for (int i = 0; i < image->mip_count; ++i) {
+        decode_level_flipped(
+            image->data + image->level_offsets[i],
+            image->format,
+            image->channel_count,
+            width,
+            height,
+            pixels + offsets[i]
+        );
+
+        width   = max(width/2, 1);
+        height  = max(height/2, 1);
+    }
+
+    free(image->data);
+
+    image->data     = pixels;
+    image->format   = TEXTURE_FORMAT_UNCOMPRESSED;
+
+    memcpy(image->level_offsets, offsets, sizeof(offsets));
+    memcpy(image->level_sizes, sizes, sizeof(sizes));
+}
+
+/*
+ * BC1, BC3 and BC4 keep each row's indices apart, so reordering block rows and the rows inside
+ * every block flips them losslessly. BC7 partitions are not symmetric, and a level whose height
+ * is not a whole number of blocks would move its padding rows into view, so those are decoded.
+ */
+void dds_flip(struct dds_image *image)
+{
+    bool_t can_flip_blocks = image->format != TEXTURE_FORMAT_BC7;
+    int width = image->width, height = image->height;
+
+    for (int i = 0; i < image->mip_count; ++i) {
+        if (height > 4 && height%4)
+            can_flip_blocks = FALSE;
+
+        height = max(height/2, 1);
+    }
+
+    if (can_flip_blocks) {
+        height = image->height;
+
+        for (int i = 0; i < image->mip_count; ++i) {
+            flip_level_blocks(image->data + image->level_offsets[i], image->format, width, height);
+
+            width   = max(width/2, 1);
+            height  = max(height/2, 1);
+        }
+    } else {
+        decode_flipped(image);
+    }
+
+    image->bottom_up = !image->bottom_up;
+}
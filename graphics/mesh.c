@@ -1,6 +1,8 @@
 #include <GL/glew.h>
 
+#include <soul/debug.h>
 #include <soul/math/vector.h>
+#include <soul/math/macros.h>
 #include <soul/graphics/mesh.h>
 
 const struct vec3f quad_vertices[4] = {
@@ -26,8 +28,20 @@ const struct vec2f quad_uvs[4] = {
 
 const size_t quad_indices[6] = { 0, 2, 3, 0, 1, 2 };
 
+static void delete_fences(struct mesh *mesh)
+{
+    for (int i = 0; i < MESH_RING_REGION_COUNT; ++i) {
+        if (mesh->region_fences[i]) {
+            glDeleteSync(mesh->region_fences[i]);
+            mesh->region_fences[i] = 0;
+        }
+    }
+}
+
 static void cleanup_mesh(struct mesh *mesh)
 {
+    delete_fences(mesh);
+
     glDeleteBuffers(ATTRIBUTE_COUNT, mesh->vbos);
     glDeleteBuffers(1, &mesh->index_vbo);
     glDeleteVertexArrays(1, &mesh->vao);
@@ -102,56 +116,92 @@ static void create_vertex_objects(struct mesh *mesh)
     glGenBuffers(1, &mesh->index_vbo);
 }
 
+static const int attribute_components[ATTRIBUTE_COUNT] = { 3, 2, 3 };
+
+static size_t attribute_region_size(struct mesh *mesh, int attribute)
+{
+    return mesh->vertex_capacity*attribute_components[attribute]*sizeof(float);
+}
+
 static void buffer_indices(struct mesh *mesh)
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_vbo);
-    size_t index_buffer_size = mesh->triangle_count*3*sizeof(unsigned int);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_size, mesh->indices, GL_STATIC_DRAW);
+    size_t index_buffer_size = mesh->triangle_capacity*3*sizeof(unsigned int);
+
+    if (mesh->triangle_capacity == mesh->triangle_count) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_size, mesh->indices, GL_STATIC_DRAW);
+    } else {
+        size_t indices_size = mesh->triangle_count*3*sizeof(unsigned int);
+
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_size, 0, GL_STATIC_DRAW);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices_size, mesh->indices);
+    }
 }
 
-static void buffer_attribute(struct mesh *mesh, size_t vbo_index, int components, void *data)
+static void buffer_attribute(struct mesh *mesh, int attribute, void *data)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbos[vbo_index]);
-    size_t buffer_size = mesh->vertex_count*components*sizeof(float);
-    glBufferData(GL_ARRAY_BUFFER, buffer_size, data, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbos[attribute]);
+
+    size_t region_size = attribute_region_size(mesh, attribute);
+    size_t data_size = mesh->vertex_count*attribute_components[attribute]*sizeof(float);
+
+    if (mesh->usage == MESH_USAGE_STATIC)
+        glBufferData(GL_ARRAY_BUFFER, region_size, 0, GL_STATIC_DRAW);
+    else
+        glBufferData(GL_ARRAY_BUFFER, region_size*MESH_RING_REGION_COUNT, 0, GL_STREAM_DRAW);
+
+    if (data)
+        glBufferSubData(GL_ARRAY_BUFFER, 0, data_size, data);
 }
 
 static void buffer_attributes(struct mesh *mesh)
 {
-    buffer_attribute(mesh, ATTRIBUTE_POSITION, 3, mesh->vertices);
+    void *data[ATTRIBUTE_COUNT] = { mesh->vertices, mesh->uvs, mesh->normals };
 
-    if (mesh->uvs)
-        buffer_attribute(mesh, ATTRIBUTE_UV, 2, mesh->uvs);
-
-    if (mesh->normals)
-        buffer_attribute(mesh, ATTRIBUTE_NORMAL, 3, mesh->normals);
+    for (int i = 0; i < ATTRIBUTE_COUNT; ++i) {
+        if (mesh->attributes & ATTRIBUTE_BIT(i))
+            buffer_attribute(mesh, i, data[i]);
+    }
 }
 
-static void format_attribute(struct mesh *mesh, size_t vbo_index, int components)
+static void format_attribute(struct mesh *mesh, int attribute)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbos[vbo_index]);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbos[attribute]);
 
     glVertexAttribPointer(
-        vbo_index,
-        components,
+        attribute,
+        attribute_components[attribute],
         GL_FLOAT,
         GL_FALSE,
-        components*sizeof(float),
+        attribute_components[attribute]*sizeof(float),
         0
     );
 
-    glEnableVertexAttribArray(vbo_index);
+    glEnableVertexAttribArray(attribute);
 }
 
 static void format_attributes(struct mesh *mesh)
 {
-    format_attribute(mesh, ATTRIBUTE_POSITION, 3);
+    for (int i = 0; i < ATTRIBUTE_COUNT; ++i) {
+        if (mesh->attributes & ATTRIBUTE_BIT(i))
+            format_attribute(mesh, i);
+    }
+}
+
+static int get_attributes(struct mesh_create_info *create_info)
+{
+    int attributes = ATTRIBUTE_BIT(ATTRIBUTE_POSITION);
 
-    if (mesh->uvs)
-        format_attribute(mesh, ATTRIBUTE_UV, 2);
+    if (create_info->uvs)
+        attributes |= ATTRIBUTE_BIT(ATTRIBUTE_UV);
 
-    if (mesh->normals)
-        format_attribute(mesh, ATTRIBUTE_NORMAL, 3);
+    if (create_info->normals)
+        attributes |= ATTRIBUTE_BIT(ATTRIBUTE_NORMAL);
+
+    if (create_info->usage == MESH_USAGE_DYNAMIC)
+        attributes |= create_info->dynamic_attributes;
+
+    return attributes;
 }
 
 struct mesh *mesh_create(struct mesh_service *service, struct mesh_create_info *create_info)
@@ -166,6 +216,10 @@ struct mesh *mesh_create(struct mesh_service *service, struct mesh_create_info *
     mesh->vertex_count          = create_info->vertex_count;
     mesh->triangle_count        = create_info->triangle_count;
     mesh->read_write_enabled    = create_info->read_write_enabled;
+    mesh->usage                 = create_info->usage;
+    mesh->attributes            = get_attributes(create_info);
+    mesh->vertex_capacity       = max(create_info->vertex_capacity, create_info->vertex_count);
+    mesh->triangle_capacity     = max(create_info->triangle_capacity, create_info->triangle_count);
 
     create_vertex_objects(mesh);
     buffer_indices(mesh);
@@ -191,5 +245,187 @@ void mesh_draw(struct mesh *mesh)
 {
     glBindVertexArray(mesh->vao);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_vbo);
-    glDrawElements(GL_TRIANGLES, mesh->triangle_count*3, GL_UNSIGNED_INT, 0);
+
+    if (mesh->usage == MESH_USAGE_STATIC) {
+        glDrawElements(GL_TRIANGLES, mesh->triangle_count*3, GL_UNSIGNED_INT, 0);
+        return;
+    }
+
+    glDrawElementsBaseVertex(
+        GL_TRIANGLES,
+        mesh->triangle_count*3,
+        GL_UNSIGNED_INT,
+        0,
+        mesh->region*mesh->vertex_capacity
+    );
+
+    if (mesh->region_fences[mesh->region])
+        glDeleteSync(mesh->region_fences[mesh->region]);
+
+    mesh->region_fences[mesh->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+static void orphan_buffers(struct mesh *mesh)
+{
+    for (int i = 0; i < ATTRIBUTE_COUNT; ++i) {
+        if (!(mesh->attributes & ATTRIBUTE_BIT(i)))
+            continue;
+
+        size_t buffer_size = attribute_region_size(mesh, i)*MESH_RING_REGION_COUNT;
+
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vbos[i]);
+        glBufferData(GL_ARRAY_BUFFER, buffer_size, 0, GL_STREAM_DRAW);
+    }
+
+    delete_fences(mesh);
+}
+
+static void advance_region(struct mesh *mesh)
+{
+    mesh->region = (mesh->region + 1)%MESH_RING_REGION_COUNT;
+
+    GLsync fence = mesh->region_fences[mesh->region];
+
+    if (!fence)
+        return;
+
+    /*
+     * If the gpu has not finished with the region yet, hand the driver fresh storage rather than
+     * stalling. Every region is free again after orphaning.
+     */
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        orphan_buffers(mesh);
+    } else {
+        glDeleteSync(fence);
+        mesh->region_fences[mesh->region] = 0;
+    }
+}
+
+static void *map_region(struct mesh *mesh, int attribute, int vertex_count)
+{
+    // Mapping an empty range is an error in OpenGL, so an empty update maps nothing.
+    if (!(mesh->attributes & ATTRIBUTE_BIT(attribute)) || !vertex_count)
+        return 0;
+
+    size_t region_size = attribute_region_size(mesh, attribute);
+    size_t size = vertex_count*attribute_components[attribute]*sizeof(float);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbos[attribute]);
+
+    return glMapBufferRange(
+        GL_ARRAY_BUFFER,
+        mesh->region*region_size,
+        size,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+    );
+}
+
+struct mesh_write_region mesh_begin_update(struct mesh *mesh,
+                                           int vertex_count,
+                                           int triangle_count)
+{
+#ifdef DEBUG
+    if (mesh->usage != MESH_USAGE_DYNAMIC) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Failed to update mesh '%s'. Only dynamic meshes can be updated.\n",
+            mesh->name.chars
+        );
+
+        abort();
+    }
+
+    if (vertex_count > mesh->vertex_capacity || triangle_count > mesh->triangle_capacity) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Failed to update mesh '%s'. Update exceeds the mesh capacity.\n",
+            mesh->name.chars
+        );
+
+        abort();
+    }
+#endif // DEBUG
+
+    advance_region(mesh);
+
+    mesh->vertex_count      = vertex_count;
+    mesh->triangle_count    = triangle_count;
+
+    glBindVertexArray(mesh->vao);
+
+    return (struct mesh_write_region){
+        .vertices       = map_region(mesh, ATTRIBUTE_POSITION, vertex_count),
+        .uvs            = map_region(mesh, ATTRIBUTE_UV, vertex_count),
+        .normals        = map_region(mesh, ATTRIBUTE_NORMAL, vertex_count),
+        .vertex_count   = vertex_count
+    };
+}
+
+void mesh_end_update(struct mesh *mesh)
+{
+    if (!mesh->vertex_count)
+        return;
+
+    for (int i = 0; i < ATTRIBUTE_COUNT; ++i) {
+        if (!(mesh->attributes & ATTRIBUTE_BIT(i)))
+            continue;
+
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vbos[i]);
+
+        // The driver may lose mapped storage, for example on a mode switch.
+        if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) {
+            debug_log(
+                SEVERITY_WARNING,
+                "Vertex data written to mesh '%s' was lost while mapped.\n",
+                mesh->name.chars
+            );
+        }
+    }
+}
+
+void mesh_update_range(struct mesh *mesh,
+                       int attribute,
+                       int first_vertex,
+                       int vertex_count,
+                       void *data)
+{
+#ifdef DEBUG
+    if (mesh->usage != MESH_USAGE_DYNAMIC) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Failed to update mesh '%s'. Only dynamic meshes can be updated.\n",
+            mesh->name.chars
+        );
+
+        abort();
+    }
+
+    if (!(mesh->attributes & ATTRIBUTE_BIT(attribute))) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Failed to update mesh '%s'. The mesh does not have attribute %d.\n",
+            mesh->name.chars,
+            attribute
+        );
+
+        abort();
+    }
+
+    if (first_vertex < 0 || vertex_count < 0 ||
+        first_vertex + vertex_count > mesh->vertex_capacity) {
+        debug_log(
+            SEVERITY_ERROR,
+            "Failed to update mesh '%s'. Update exceeds the mesh capacity.\n",
+            mesh->name.chars
+        );
+
+        abort();
+    }
+#endif // DEBUG
+
+    size_t vertex_size = attribute_components[attribute]*sizeof(float);
+    size_t offset = mesh->region*attribute_region_size(mesh, attribute) + first_vertex*vertex_size;
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbos[attribute]);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, vertex_count*vertex_size, data);
 }
\ No newline at end of file
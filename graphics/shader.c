@@ -196,6 +196,11 @@ void shader_uniform_int(uniform_t uniform, int value)
     glUniform1i(uniform, value);
 }
 
+void shader_uniform_float(uniform_t uniform, float value)
+{
+    glUniform1f(uniform, value);
+}
+
 uniform_t shader_get_uniform(struct shader *shader, const char *name)
 {
     return glGetUniformLocation(shader->shader_program, name);
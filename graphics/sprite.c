@@ -1,61 +1,228 @@
+#include <math.h>
+
 #include <GL/glew.h>
 
 #include <soul/execution_order.h>
+#include <soul/scheduler.h>
+#include <soul/thread_pool.h>
+#include <soul/spatial.h>
 #include <soul/math/matrix.h>
+#include <soul/math/affine.h>
+#include <soul/math/macros.h>
 #include <soul/graphics/sprite.h>
 #include <soul/graphics/shader.h>
 #include <soul/graphics/mesh.h>
 #include <soul/graphics/camera.h>
 
+#define COMPOSE_CHUNK_SIZE 4096
+
+#define SPATIAL_CELL_SIZE 256
+
 struct render_cache
 {
     struct list *                   camera_instances;
-    struct list *                   sprite_instances;
+    struct list *                   sprite_instances; // struct sprite
+    struct sprite **                sprites; // by render index, this frame
+    int                             sprite_count;
     struct mesh *                   quad;
     struct shader *                 shader;
     uniform_t                       matrix_uniform;
+    uniform_t                       uv_rect_uniform;
+    struct transform **             transforms;
+    struct affine3x4 *              models;
+    struct spatial_rect *           bounds;
+    int *                           visible;
+    int                             capacity;
+    struct thread_pool_service *    thread_pool;
+    struct spatial_index *          spatial_index;
+    struct spatial_results          visible_results;
+    struct sprite_render_stats      stats;
 };
 
-static struct mat4x4 calculate_matrix(struct transform *camera_transform,
-                                      struct transform *sprite_transform,
-                                      struct camera *camera)
+static struct mat4x4 calculate_view_projection(struct camera *camera)
+{
+    float x_scale = 1.0/camera->render_target->texture->width/camera->size;
+    float y_scale = 1.0/camera->render_target->texture->height/camera->size;
+
+    struct vec3f position = camera->transform->position;
+
+    return mat4x4(
+        x_scale, 0, 0, -position.x*x_scale,
+        0, y_scale, 0, -position.y*y_scale,
+        0, 0, 0, 0,
+        0, 0, 0, 1
+    );
+}
+
+/*
+ * The quad spans -1 to 1 on both axes, so the world space box around a sprite is its
+ * translation padded by the absolute sums of the model's x and y rows.
+ */
+static void compose_chunk(int begin, int end, int chunk_index, struct render_cache *cache)
+{
+    affine_compose_batch(cache->transforms + begin, cache->models + begin, end - begin);
+
+    for (int i = begin; i < end; ++i) {
+        struct affine3x4 *model = cache->models + i;
+
+        float extent_x = fabsf(model->m00) + fabsf(model->m01);
+        float extent_y = fabsf(model->m04) + fabsf(model->m05);
+
+        cache->bounds[i] = spatial_rect(
+            model->m03 - extent_x,
+            model->m07 - extent_y,
+            model->m03 + extent_x,
+            model->m07 + extent_y
+        );
+    }
+}
+
+// Only the sprite and transform arrays are filled before growing, so only they are kept.
+static void grow(struct render_cache *cache)
 {
-    struct mat4x4 r = MAT4X4_IDENTITY;
+    cache->capacity     = max(cache->capacity*2, 64);
+    cache->sprites      = realloc(cache->sprites, cache->capacity*sizeof(struct sprite *));
+    cache->transforms   = realloc(cache->transforms, cache->capacity*sizeof(struct transform *));
 
-    struct vec3f position = sub3f(sprite_transform->position, camera_transform->position);
-    mat4x4_set_pos(&r, position);
-    mat4x4_set_scale(&r, sprite_transform->scale);
+    free(cache->models);
+    free(cache->bounds);
+    free(cache->visible);
 
-    struct mat4x4 scale_matrix = MAT4X4_IDENTITY;
+    cache->models   = malloc(cache->capacity*sizeof(struct affine3x4));
+    cache->bounds   = malloc(cache->capacity*sizeof(struct spatial_rect));
+    cache->visible  = malloc(cache->capacity*sizeof(int));
+}
 
-    mat4x4_set_scale(
-        &scale_matrix,
-        vec3f(
-            1.0/camera->render_target->texture->width/camera->size,
-            1.0/camera->render_target->texture->height/camera->size,
-            0
-        )
+/*
+ * Every sprite instance is drawn, including second sprites on the same entity, so they are
+ * gathered from the component's storage rather than a query, which only reaches the first.
+ */
+static void gather_sprites(struct render_cache *cache)
+{
+    int count = 0;
+
+    list_for_each (struct sprite, sprite, *cache->sprite_instances) {
+        if (count == cache->capacity)
+            grow(cache);
+
+        cache->sprites[count]       = sprite;
+        cache->transforms[count]    = sprite->transform;
+
+        ++count;
+    }
+
+    cache->sprite_count = count;
+}
+
+/*
+ * Model matrices do not depend on the camera, so they are composed once per frame, and the
+ * spatial index is brought up to date with the bounds they give.
+ */
+static void compose_models(struct render_cache *cache)
+{
+    gather_sprites(cache);
+
+    thread_pool_parallel_for(
+        cache->thread_pool,
+        cache->sprite_count,
+        COMPOSE_CHUNK_SIZE,
+        (range_job_t)&compose_chunk,
+        cache
     );
 
-    r = mul4x4(&scale_matrix, &r);
+    for (int i = 0; i < cache->sprite_count; ++i) {
+        struct sprite *sprite = cache->sprites[i];
+
+        sprite->render_index = i;
+        spatial_index_update(cache->spatial_index, sprite->spatial_item, cache->bounds[i]);
+    }
+}
+
+static int compare_indices(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * Fills the cache's visible array with the render indices of the sprites overlapping the rect
+ * the camera can see, in index order so overlapping sprites keep drawing in the same order.
+ * Returns the visible count.
+ */
+static int cull(struct render_cache *cache, struct camera *camera)
+{
+    float half_width    = camera->render_target->texture->width*camera->size;
+    float half_height   = camera->render_target->texture->height*camera->size;
+
+    struct vec3f position = camera->transform->position;
+
+    struct spatial_results *results = &cache->visible_results;
+
+    spatial_index_query_rect(
+        cache->spatial_index,
+        spatial_rect(
+            position.x - half_width,
+            position.y - half_height,
+            position.x + half_width,
+            position.y + half_height
+        ),
+        results
+    );
+
+    int count = 0;
+
+    /*
+     * Only hits gathered this frame are kept, so each index is taken at most once and the count
+     * never passes the sprite count the visible array was sized for.
+     */
+    for (int i = 0; i < results->count; ++i) {
+        struct sprite *sprite = results->hits[i].data;
+        int index = sprite->render_index;
+
+        if (index < 0 || index >= cache->sprite_count || cache->sprites[index] != sprite)
+            continue;
+
+        cache->visible[count++] = index;
+    }
+
+    qsort(cache->visible, count, sizeof(int), &compare_indices);
 
-    return r;
+    return count;
 }
 
 static void render(struct render_cache *cache)
 {
+    shader_bind(cache->shader);
+
+    compose_models(cache);
+
+    cache->stats = (struct sprite_render_stats){ 0 };
+
     list_for_each (struct camera, camera, *cache->camera_instances) {
         camera_bind(camera);
 
-        list_for_each (struct sprite, sprite, *cache->sprite_instances) {
-            texture_bind(sprite->texture);
-            shader_bind(cache->shader);
+        struct mat4x4 view_projection = calculate_view_projection(camera);
+
+        int visible_count = cull(cache, camera);
+
+        cache->stats.tested     += cache->sprite_count;
+        cache->stats.visible    += visible_count;
+        cache->stats.culled     += cache->sprite_count - visible_count;
+
+        // Sprites sharing an atlas page only bind it once.
+        struct texture *bound_texture = 0;
+
+        for (int v = 0; v < visible_count; ++v) {
+            int i = cache->visible[v];
+            struct sprite *sprite = cache->sprites[i];
+
+            if (sprite->region.texture != bound_texture) {
+                bound_texture = sprite->region.texture;
+                texture_bind(bound_texture);
+            }
+
+            shader_uniform_vec4f(cache->uv_rect_uniform, sprite->region.uv_rect);
 
-            struct mat4x4 matrix = calculate_matrix(
-                camera->transform,
-                sprite->transform,
-                camera
-            );
+            struct mat4x4 matrix = mat4x4_mul_affine(&view_projection, cache->models + i);
 
             shader_uniform_mat4x4(cache->matrix_uniform, &matrix);
 
@@ -64,25 +231,57 @@ static void render(struct render_cache *cache)
     }
 }
 
-static void init(struct entity *entity, struct component_storage storage, void *data)
+static void init(struct entity *entity,
+                 struct component_storage storage,
+                 struct spatial_index *spatial_index)
 {
     struct sprite *const sprite = storage.passive;
 
-    sprite->transform = entity->transform;
+    sprite->transform       = entity->transform;
+    sprite->render_index    = -1;
+
+    // Given real bounds once the sprite is first rendered.
+    struct vec3f position = entity->transform->position;
+
+    sprite->spatial_item = spatial_index_insert(
+        spatial_index,
+        spatial_rect(position.x, position.y, position.x, position.y),
+        sprite
+    );
+}
+
+static void cleanup(struct entity *entity,
+                    struct component_storage storage,
+                    struct spatial_index *spatial_index)
+{
+    struct sprite *const sprite = storage.passive;
+
+    spatial_index_remove(spatial_index, sprite->spatial_item);
+}
+
+static void deallocate_render_cache(struct render_cache *render_cache)
+{
+    free(render_cache->sprites);
+    free(render_cache->transforms);
+    free(render_cache->models);
+    free(render_cache->bounds);
+    free(render_cache->visible);
+
+    spatial_results_destroy(&render_cache->visible_results);
 }
 
 static struct render_cache *create_render_cache(struct ecs_service *ecs_service,
                                                 struct soul_instance *soul_instance,
-                                                struct component_descriptor *descriptor)
+                                                struct spatial_index *spatial_index)
 {
     struct shader_service *shader_service = resource_get(soul_instance, SHADER_SERVICE);
     struct mesh_service *mesh_service = resource_get(soul_instance, MESH_SERVICE);
 
     struct render_cache *render_cache = resource_create(
         soul_instance,
-        "sprite_render_cache",
+        SPRITE_RENDER_CACHE,
         sizeof(struct render_cache),
-        0
+        (resource_deallocator_t)&deallocate_render_cache
     );
 
     struct component_descriptor *camera_descriptor = component_match_descriptor(
@@ -90,11 +289,19 @@ static struct render_cache *create_render_cache(struct ecs_service *ecs_service,
         CAMERA
     );
 
-    render_cache->sprite_instances  = &descriptor->passive_storage;
+    struct component_descriptor *sprite_descriptor = component_match_descriptor(
+        ecs_service,
+        SPRITE
+    );
+
+    render_cache->sprite_instances  = &sprite_descriptor->passive_storage;
     render_cache->quad              = mesh_service->primitives.quad;
     render_cache->shader            = shader_service->defaults.sprite;
     render_cache->matrix_uniform    = shader_get_uniform(render_cache->shader, "matrix");
+    render_cache->uv_rect_uniform   = shader_get_uniform(render_cache->shader, "uv_rect");
     render_cache->camera_instances  = &camera_descriptor->passive_storage;
+    render_cache->thread_pool       = resource_get(soul_instance, THREAD_POOL_SERVICE);
+    render_cache->spatial_index     = spatial_index;
 
     return render_cache;
 }
@@ -103,31 +310,66 @@ void sprite_register_component(struct soul_instance *soul_instance)
 {
     struct ecs_service *ecs_service = resource_get(soul_instance, ECS_SERVICE);
 
+    struct spatial_index_info spatial_info = {
+        .name       = SPRITE_SPATIAL_INDEX,
+        .type       = SPATIAL_INDEX_HASH,
+        .cell_size  = SPATIAL_CELL_SIZE
+    };
+
+    struct spatial_index *spatial_index = spatial_index_create(
+        resource_get(soul_instance, SPATIAL_SERVICE),
+        &spatial_info
+    );
+
     struct component_registry_info registry_info = {
         .name                   = SPRITE,
         .passive_storage_size   = sizeof(struct sprite),
-        .callbacks.init         = (component_callback_t)&init
+        .callbacks.init         = (component_callback_t)&init,
+        .callbacks.cleanup      = (component_callback_t)&cleanup,
+        .callbacks.data         = spatial_index
     };
 
-    struct component_descriptor *descriptor = component_register(ecs_service, &registry_info);
-
-    struct render_cache *render_cache = create_render_cache(ecs_service, soul_instance, descriptor);
+    component_register(ecs_service, &registry_info);
 
-    ordered_callbacks_insert(
-        &soul_instance->callbacks,
-        (ordered_callback_t)render,
-        EXECUTION_ORDER_RENDER,
-        render_cache,
-        FALSE
+    struct render_cache *render_cache = create_render_cache(
+        ecs_service,
+        soul_instance,
+        spatial_index
     );
+
+    struct system_registry_info system_info = {
+        .name           = "sprite_render",
+        .fn             = (system_t)&render,
+        .data           = render_cache,
+        .order          = EXECUTION_ORDER_RENDER,
+        .reads          = (const char *[]){ SPRITE, CAMERA },
+        .read_count     = 2,
+        .main_thread    = TRUE
+    };
+
+    system_register(resource_get(soul_instance, SCHEDULER_SERVICE), &system_info);
 }
 
 void sprite_set_texture(struct sprite *sprite, struct texture *texture, bool_t match_size)
 {
-    sprite->texture = texture;
+    struct texture_region region = texture_region_full(texture);
+    sprite_set_region(sprite, &region, match_size);
+}
+
+void sprite_set_region(struct sprite *sprite, struct texture_region *region, bool_t match_size)
+{
+    sprite->region = *region;
 
     if (match_size) {
-        sprite->transform->scale.x = texture->width;
-        sprite->transform->scale.y = texture->height;
+        sprite->transform->scale.x = region->size.x;
+        sprite->transform->scale.y = region->size.y;
     }
+}
+
+// Totals over every camera for the last rendered frame.
+struct sprite_render_stats sprite_get_render_stats(struct soul_instance *soul_instance)
+{
+    struct render_cache *render_cache = resource_get(soul_instance, SPRITE_RENDER_CACHE);
+
+    return render_cache->stats;
 }
\ No newline at end of file
@@ -3,10 +3,17 @@
 #include <stb_image.h>
 #include <GL/glew.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include <soul/debug.h>
 #include <soul/debug.h>
 #include <soul/string.h>
+#include <soul/math/macros.h>
 #include <soul/graphics/texture.h>
+#include <soul/graphics/texture_atlas.h>
+#include <soul/graphics/dds.h>
 
 static unsigned char *load_image(const char *name,
                                  const char *path,
@@ -15,10 +22,11 @@ static unsigned char *load_image(const char *name,
                                  int *channel_count,
                                  bool_t flip)
 {
+    // Images are decoded on worker threads too, so the flag has to be per thread.
     if (flip)
-        stbi_set_flip_vertically_on_load(1);
+        stbi_set_flip_vertically_on_load_thread(1);
     else
-        stbi_set_flip_vertically_on_load(0);
+        stbi_set_flip_vertically_on_load_thread(0);
 
     unsigned char *pixels = stbi_load(path, width, height, channel_count, 0);
 
@@ -45,6 +53,21 @@ static void cleanup_render_target(struct texture_service *texture_service,
     glDeleteFramebuffers(1, &render_target->fbo);
 }
 
+static void remove_cache_entry(struct texture_service *service, struct texture_cache_entry *entry)
+{
+    service->vram_usage -= entry->bytes;
+
+    if (entry->unused_node)
+        list_remove(&service->unused_cache_entries, entry->unused_node);
+
+    entry->texture->cache_entry = 0;
+
+    struct string path = entry->path;
+
+    string_map_remove(&service->cache, path.chars);
+    string_destroy(path);
+}
+
 static void cleanup_texture(struct texture *texture)
 {
     glDeleteTextures(1, &texture->gl_texture);
@@ -55,8 +78,33 @@ static void cleanup_texture(struct texture *texture)
     string_destroy(texture->name);
 }
 
+static void free_load_job(struct texture_load_job *job)
+{
+    string_destroy(job->path);
+    free(job->data);
+    free(job);
+}
+
 static void service_deallocate(struct texture_service *service)
 {
+    /*
+     * The thread pool is deallocated first and drains its queue, so every job has already landed
+     * in completed_loads by now.
+     */
+    list_for_each (struct texture_load_job *, p_job, service->completed_loads) {
+        free_load_job(*p_job);
+    }
+
+    list_destroy(&service->completed_loads);
+    pthread_mutex_destroy(&service->load_mutex);
+
+    if (service->upload_pbo)
+        glDeleteBuffers(1, &service->upload_pbo);
+
+    list_for_each (struct texture_atlas, atlas, service->atlases) {
+        texture_atlas_cleanup(service, atlas);
+    }
+
     list_for_each (struct render_target, render_target, service->render_targets) {
         cleanup_render_target(service, render_target);
     }
@@ -67,8 +115,18 @@ static void service_deallocate(struct texture_service *service)
 
     list_destroy(&service->textures);
     list_destroy(&service->render_targets);
+    list_destroy(&service->atlases);
+    list_destroy(&service->unused_cache_entries);
+
+    list_for_each (struct texture_cache_entry, entry, service->cache.values) {
+        string_destroy(entry->path);
+    }
+
+    string_map_destroy(&service->cache);
 }
 
+static void upload_completed_loads(struct texture_service *service);
+
 void texture_service_create_resource(struct soul_instance *soul_instance)
 {
     struct texture_service *service = resource_create(
@@ -80,29 +138,54 @@ void texture_service_create_resource(struct soul_instance *soul_instance)
 
     list_init(&service->textures, sizeof(struct texture));
     list_init(&service->render_targets, sizeof(struct render_target));
+    list_init(&service->atlases, sizeof(struct texture_atlas));
+    list_init(&service->unused_cache_entries, sizeof(struct texture_cache_entry *));
+
+    string_map_init(&service->cache, sizeof(struct texture_cache_entry));
+    list_init(&service->completed_loads, sizeof(struct texture_load_job *));
+
+    pthread_mutex_init(&service->load_mutex, 0);
+
+    service->vram_budget = TEXTURE_DEFAULT_VRAM_BUDGET;
+    service->thread_pool = resource_get(soul_instance, THREAD_POOL_SERVICE);
+
+    ordered_callbacks_insert(
+        &soul_instance->callbacks,
+        (ordered_callback_t)&upload_completed_loads,
+        EXECUTION_ORDER_PRE_RENDER,
+        service,
+        FALSE
+    );
 }
 
 static void flip_texture(struct texture *texture)
 {
-    int pixel_size = texture->channel_count*sizeof(unsigned char);
-    unsigned char *buffer = malloc(pixel_size*texture->width*texture->height);
+    size_t row_size = texture->channel_count*texture->width*sizeof(unsigned char);
 
-    for (int i = 0; i < texture->height; ++i) {
-        int i_flipped = (texture->height - 1) - i;
+    if (!texture->pixels)
+        return;
 
-        memcpy(
-            buffer + pixel_size*texture->width*i_flipped,
-            texture->pixels + pixel_size*texture->width*i,
-            pixel_size*texture->width
-        );
+    // Memory owned by the caller must not change underneath it, so flip a copy instead.
+    if (texture->no_memory_manage) {
+        unsigned char *copy = malloc(row_size*texture->height);
+        memcpy(copy, texture->pixels, row_size*texture->height);
+
+        texture->pixels             = copy;
+        texture->no_memory_manage   = FALSE;
     }
 
-    if (!texture->no_memory_manage)
-        free(texture->pixels);
-    else
-        texture->no_memory_manage = FALSE;
+    unsigned char *row = malloc(row_size);
+
+    for (int i = 0; i < texture->height/2; ++i) {
+        unsigned char *top = texture->pixels + row_size*i;
+        unsigned char *bottom = texture->pixels + row_size*(texture->height - 1 - i);
+
+        memcpy(row, top, row_size);
+        memcpy(top, bottom, row_size);
+        memcpy(bottom, row, row_size);
+    }
 
-    texture->pixels = buffer;
+    free(row);
 }
 
 GLenum get_gl_filtermode_enum(texture_filtermode_t filter_mode)
@@ -166,6 +249,112 @@ static void create_gl_resource(struct texture *texture, struct texture_create_in
         glGenerateMipmap(GL_TEXTURE_2D);
 }
 
+static GLenum get_gl_compressed_enum(texture_format_t format)
+{
+    switch (format) {
+        case TEXTURE_FORMAT_BC1:
+            return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+
+        case TEXTURE_FORMAT_BC3:
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+        case TEXTURE_FORMAT_BC4:
+            return GL_COMPRESSED_RED_RGTC1;
+
+        case TEXTURE_FORMAT_BC7:
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+
+    return 0;
+}
+
+static void create_compressed_gl_resource(struct texture *texture, struct dds_image *image)
+{
+    GLenum filter_mode_enum = get_gl_filtermode_enum(texture->filter_mode);
+    GLenum min_filter_enum = filter_mode_enum;
+    GLenum format_enum = get_gl_compressed_enum(image->format);
+
+    if (image->mip_count > 1) {
+        if (texture->filter_mode == TEXTURE_FILTERMODE_LINEAR)
+            min_filter_enum = GL_LINEAR_MIPMAP_LINEAR;
+        else
+            min_filter_enum = GL_NEAREST_MIPMAP_NEAREST;
+    }
+
+    glGenTextures(1, &texture->gl_texture);
+    glBindTexture(GL_TEXTURE_2D, texture->gl_texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter_enum);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter_mode_enum);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image->mip_count - 1);
+
+    int width = image->width, height = image->height;
+
+    // Images that had to be decoded to flip them are plain pixels from here on.
+    if (image->format == TEXTURE_FORMAT_UNCOMPRESSED)
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (int i = 0; i < image->mip_count; ++i) {
+        if (image->format == TEXTURE_FORMAT_UNCOMPRESSED) {
+            GLenum channel_enum = get_gl_channel_enum(image->channel_count);
+
+            glTexImage2D(
+                GL_TEXTURE_2D,
+                i,
+                channel_enum,
+                width,
+                height,
+                0,
+                channel_enum,
+                GL_UNSIGNED_BYTE,
+                image->data + image->level_offsets[i]
+            );
+        } else {
+            glCompressedTexImage2D(
+                GL_TEXTURE_2D,
+                i,
+                format_enum,
+                width,
+                height,
+                0,
+                image->level_sizes[i],
+                image->data + image->level_offsets[i]
+            );
+        }
+
+        width   = max(width/2, 1);
+        height  = max(height/2, 1);
+    }
+}
+
+static struct texture *create_compressed(struct texture *texture,
+                                         struct texture_create_info *create_info)
+{
+    struct dds_image image;
+
+    if (!dds_load(create_info->resource_path, &image))
+        return 0;
+
+    if (create_info->flip != image.bottom_up)
+        dds_flip(&image);
+
+    texture->width          = image.width;
+    texture->height         = image.height;
+    texture->channel_count  = image.channel_count;
+    texture->format         = image.format;
+    texture->mip_count      = image.mip_count;
+
+    // Compressed blocks cannot be edited in place, so pixels are never kept.
+    texture->read_write_enabled = FALSE;
+
+    create_compressed_gl_resource(texture, &image);
+    dds_free(&image);
+
+    return texture;
+}
+
 struct texture *texture_create(struct texture_service *texture_service,
                                struct texture_create_info *create_info)
 {
@@ -179,6 +368,12 @@ struct texture *texture_create(struct texture_service *texture_service,
     texture->channel_count      = create_info->channel_count;
     texture->filter_mode        = create_info->filter_mode;
     texture->pixels             = create_info->pixels;
+    texture->format             = TEXTURE_FORMAT_UNCOMPRESSED;
+    texture->mip_count          = 1;
+    texture->load_failed        = FALSE;
+
+    if (create_info->resource_path && dds_is_path(create_info->resource_path))
+        return create_compressed(texture, create_info);
 
     if (create_info->resource_path) {
         texture->pixels = load_image(
@@ -209,10 +404,468 @@ struct texture *texture_create(struct texture_service *texture_service,
 
 void texture_destroy(struct texture_service *texture_service, struct texture *texture)
 {
+    // The job still finishes on its worker, the upload is just skipped.
+    if (texture->load_job)
+        texture->load_job->texture = 0;
+
+    if (texture->cache_entry)
+        remove_cache_entry(texture_service, texture->cache_entry);
+
     cleanup_texture(texture);
     list_remove(&texture_service->textures, texture);
 }
 
+static size_t calculate_texture_bytes(struct texture *texture, bool_t mip_maps)
+{
+    size_t bytes = texture->width*texture->height*texture->channel_count;
+
+    if (texture->format != TEXTURE_FORMAT_UNCOMPRESSED)
+        bytes = dds_level_size(texture->format, texture->width, texture->height);
+
+    // dds files bring their own levels, even once decoded to be flipped.
+    if (texture->format != TEXTURE_FORMAT_UNCOMPRESSED || texture->mip_count > 1)
+        mip_maps = texture->mip_count > 1;
+
+    // A full mip chain adds a third on top of the base level.
+    if (mip_maps)
+        bytes += bytes/3;
+
+    return bytes;
+}
+
+static void evict_unused(struct texture_service *service)
+{
+    while (service->vram_usage > service->vram_budget) {
+        struct texture_cache_entry **p_oldest = list_get_head(&service->unused_cache_entries);
+
+        if (!p_oldest)
+            return;
+
+        texture_destroy(service, (*p_oldest)->texture);
+    }
+}
+
+static int count_mip_levels(int width, int height)
+{
+    int count = 1;
+
+    while ((width > 1 || height > 1) && count < TEXTURE_MAX_MIP_COUNT) {
+        width   = max(width/2, 1);
+        height  = max(height/2, 1);
+
+        ++count;
+    }
+
+    return count;
+}
+
+static void box_filter_pixel(unsigned char *source,
+                             int source_width,
+                             int source_height,
+                             int channel_count,
+                             int x,
+                             int y,
+                             unsigned char *destination)
+{
+    int x0 = min(x*2, source_width - 1), x1 = min(x*2 + 1, source_width - 1);
+    int y0 = min(y*2, source_height - 1), y1 = min(y*2 + 1, source_height - 1);
+
+    unsigned char *row0 = source + y0*source_width*channel_count;
+    unsigned char *row1 = source + y1*source_width*channel_count;
+
+    for (int c = 0; c < channel_count; ++c) {
+        int sum = row0[x0*channel_count + c] + row0[x1*channel_count + c] +
+                  row1[x0*channel_count + c] + row1[x1*channel_count + c];
+
+        destination[c] = (sum + 2) >> 2;
+    }
+}
+
+#ifdef __SSE2__
+/*
+ * Averages two destination pixels per iteration. Only valid when the source is exactly twice
+ * the size of the destination, the scalar path handles the odd tails.
+ */
+static void box_filter_rgba_sse2(unsigned char *source,
+                                 int source_width,
+                                 unsigned char *destination,
+                                 int width,
+                                 int height)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i bias = _mm_set1_epi16(2);
+
+    for (int y = 0; y < height; ++y) {
+        unsigned char *row0 = source + y*2*source_width*4;
+        unsigned char *row1 = row0 + source_width*4;
+        unsigned char *out = destination + y*width*4;
+
+        int x = 0;
+
+        for (; x + 2 <= width; x += 2) {
+            __m128i a = _mm_loadu_si128((__m128i *)(row0 + x*8));
+            __m128i b = _mm_loadu_si128((__m128i *)(row1 + x*8));
+
+            __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+            lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+            hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+            __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), bias), 2);
+
+            _mm_storel_epi64((__m128i *)(out + x*4), _mm_packus_epi16(sum, zero));
+        }
+
+        for (; x < width; ++x) {
+            box_filter_pixel(source, source_width, height*2, 4, x, y, out + x*4);
+        }
+    }
+}
+#endif // __SSE2__
+
+static void box_filter(unsigned char *source,
+                       int source_width,
+                       int source_height,
+                       int channel_count,
+                       unsigned char *destination,
+                       int width,
+                       int height)
+{
+#ifdef __SSE2__
+    if (channel_count == 4 && source_width == width*2 && source_height == height*2) {
+        box_filter_rgba_sse2(source, source_width, destination, width, height);
+        return;
+    }
+#endif // __SSE2__
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            box_filter_pixel(
+                source,
+                source_width,
+                source_height,
+                channel_count,
+                x,
+                y,
+                destination + (y*width + x)*channel_count
+            );
+        }
+    }
+}
+
+static void generate_mip_levels(struct texture_load_job *job)
+{
+    int width = job->width, height = job->height;
+
+    job->mip_count = job->generate_mip_maps ? count_mip_levels(width, height) : 1;
+    job->size = 0;
+
+    for (int i = 0; i < job->mip_count; ++i) {
+        job->level_offsets[i] = job->size;
+        job->size += width*height*job->channel_count;
+
+        width   = max(width/2, 1);
+        height  = max(height/2, 1);
+    }
+
+    // stbi allocates with malloc, so the chain can simply grow past the decoded base level.
+    job->data = realloc(job->data, job->size);
+
+    width = job->width, height = job->height;
+
+    for (int i = 1; i < job->mip_count; ++i) {
+        int level_width = max(width/2, 1), level_height = max(height/2, 1);
+
+        box_filter(
+            job->data + job->level_offsets[i - 1],
+            width,
+            height,
+            job->channel_count,
+            job->data + job->level_offsets[i],
+            level_width,
+            level_height
+        );
+
+        width   = level_width;
+        height  = level_height;
+    }
+}
+
+static void decode_texture(struct texture_load_job *job)
+{
+    job->data = load_image(
+        job->path.chars,
+        job->path.chars,
+        &job->width,
+        &job->height,
+        &job->channel_count,
+        job->flip
+    );
+
+    if (job->data)
+        generate_mip_levels(job);
+
+    pthread_mutex_lock(&job->service->load_mutex);
+    list_push(&job->service->completed_loads, &job);
+    pthread_mutex_unlock(&job->service->load_mutex);
+}
+
+static void upload_levels(struct texture_service *service, struct texture_load_job *job)
+{
+    struct texture *texture = job->texture;
+
+    if (!service->upload_pbo)
+        glGenBuffers(1, &service->upload_pbo);
+
+    // Orphaned every upload, so the driver never stalls on a copy still reading the old storage.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, service->upload_pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, job->size, 0, GL_STREAM_DRAW);
+
+    void *mapped = glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER,
+        0,
+        job->size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+    );
+
+    memcpy(mapped, job->data, job->size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    texture->width          = job->width;
+    texture->height         = job->height;
+    texture->channel_count  = job->channel_count;
+    texture->mip_count      = job->mip_count;
+
+    GLenum filter_mode_enum = get_gl_filtermode_enum(texture->filter_mode);
+    GLenum min_filter_enum = filter_mode_enum;
+    GLenum channel_enum = get_gl_channel_enum(texture->channel_count);
+
+    if (job->mip_count > 1) {
+        if (texture->filter_mode == TEXTURE_FILTERMODE_LINEAR)
+            min_filter_enum = GL_LINEAR_MIPMAP_LINEAR;
+        else
+            min_filter_enum = GL_NEAREST_MIPMAP_NEAREST;
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, texture->gl_texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter_enum);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, job->mip_count - 1);
+
+    int width = job->width, height = job->height;
+
+    for (int i = 0; i < job->mip_count; ++i) {
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            i,
+            channel_enum,
+            width,
+            height,
+            0,
+            channel_enum,
+            GL_UNSIGNED_BYTE,
+            (void *)job->level_offsets[i]
+        );
+
+        width   = max(width/2, 1);
+        height  = max(height/2, 1);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // The base level sits at the front of the chain, so it can be handed over as is.
+    if (job->read_write_enabled) {
+        texture->pixels             = job->data;
+        texture->read_write_enabled = TRUE;
+        texture->no_memory_manage   = FALSE;
+
+        job->data = 0;
+    } else {
+        texture->pixels = 0;
+    }
+
+    struct texture_cache_entry *entry = texture->cache_entry;
+
+    if (entry) {
+        service->vram_usage -= entry->bytes;
+        entry->bytes = job->size;
+        service->vram_usage += entry->bytes;
+    }
+}
+
+static void upload_completed_loads(struct texture_service *service)
+{
+    bool_t uploaded = FALSE;
+
+    for (;;) {
+        pthread_mutex_lock(&service->load_mutex);
+
+        struct texture_load_job **p_job = list_get_head(&service->completed_loads);
+        struct texture_load_job *job = p_job ? *p_job : 0;
+
+        if (p_job)
+            list_remove(&service->completed_loads, p_job);
+
+        pthread_mutex_unlock(&service->load_mutex);
+
+        if (!job)
+            break;
+
+        if (job->texture) {
+            if (job->data) {
+                upload_levels(service, job);
+                uploaded = TRUE;
+            } else {
+                debug_log(
+                    SEVERITY_WARNING,
+                    "Failed to load texture \"%s\". Keeping the placeholder.\n",
+                    job->path.chars
+                );
+
+                job->texture->load_failed = TRUE;
+            }
+
+            job->texture->load_job = 0;
+        }
+
+        free_load_job(job);
+    }
+
+    if (uploaded)
+        evict_unused(service);
+}
+
+struct texture *texture_load_async(struct texture_service *texture_service,
+                                   struct texture_create_info *create_info)
+{
+    // Compressed files are uploaded straight from disk and have nothing to decode.
+    if (dds_is_path(create_info->resource_path))
+        return texture_create(texture_service, create_info);
+
+    static unsigned char placeholder_pixels[4] = { 255, 255, 255, 255 };
+
+    struct texture_create_info placeholder_create_info = *create_info;
+    placeholder_create_info.resource_path       = 0;
+    placeholder_create_info.pixels              = placeholder_pixels;
+    placeholder_create_info.row_alignment       = 1;
+    placeholder_create_info.width               = 1;
+    placeholder_create_info.height              = 1;
+    placeholder_create_info.channel_count       = 4;
+    placeholder_create_info.generate_mip_maps   = FALSE;
+    placeholder_create_info.read_write_enabled  = FALSE;
+    placeholder_create_info.no_memory_manage    = TRUE;
+    placeholder_create_info.flip                = FALSE;
+
+    struct texture *texture = texture_create(texture_service, &placeholder_create_info);
+    struct texture_load_job *job = calloc(1, sizeof(struct texture_load_job));
+
+    job->service            = texture_service;
+    job->texture            = texture;
+    job->path               = string_create(create_info->resource_path);
+    job->flip               = create_info->flip;
+    job->generate_mip_maps  = create_info->generate_mip_maps;
+    job->read_write_enabled = create_info->read_write_enabled;
+
+    texture->load_job = job;
+
+    thread_pool_submit(texture_service->thread_pool, 0, (job_t)&decode_texture, job);
+
+    return texture;
+}
+
+// False while the load is in flight and after it has failed, see texture_load_failed().
+bool_t texture_is_loaded(struct texture *texture)
+{
+    return !texture->load_job && !texture->load_failed;
+}
+
+// A failed load leaves the white placeholder in place for good.
+bool_t texture_load_failed(struct texture *texture)
+{
+    return texture->load_failed;
+}
+
+static struct texture *acquire(struct texture_service *texture_service,
+                               const char *path,
+                               struct texture_create_info *create_info,
+                               bool_t async)
+{
+    struct texture_cache_entry *entry = string_map_index(&texture_service->cache, path);
+
+    // Loads still in flight are shared too, every caller gets the same placeholder.
+    if (entry) {
+        if (entry->unused_node) {
+            list_remove(&texture_service->unused_cache_entries, entry->unused_node);
+            entry->unused_node = 0;
+        }
+
+        ++entry->ref_count;
+
+        return entry->texture;
+    }
+
+    struct texture_create_info cached_create_info = *create_info;
+    cached_create_info.name             = path;
+    cached_create_info.resource_path    = path;
+
+    struct texture *texture;
+
+    if (async)
+        texture = texture_load_async(texture_service, &cached_create_info);
+    else
+        texture = texture_create(texture_service, &cached_create_info);
+
+    if (!texture)
+        return 0;
+
+    entry = string_map_alloc(&texture_service->cache, path);
+
+    entry->path         = string_create(path);
+    entry->texture      = texture;
+    entry->ref_count    = 1;
+    entry->bytes        = calculate_texture_bytes(texture, create_info->generate_mip_maps);
+
+    texture->cache_entry = entry;
+
+    texture_service->vram_usage += entry->bytes;
+    evict_unused(texture_service);
+
+    return texture;
+}
+
+struct texture *texture_acquire(struct texture_service *texture_service,
+                                const char *path,
+                                struct texture_create_info *create_info)
+{
+    return acquire(texture_service, path, create_info, FALSE);
+}
+
+struct texture *texture_acquire_async(struct texture_service *texture_service,
+                                      const char *path,
+                                      struct texture_create_info *create_info)
+{
+    return acquire(texture_service, path, create_info, TRUE);
+}
+
+void texture_release(struct texture_service *texture_service, struct texture *texture)
+{
+    struct texture_cache_entry *entry = texture->cache_entry;
+
+    if (!entry || --entry->ref_count > 0)
+        return;
+
+    entry->unused_node = list_push(&texture_service->unused_cache_entries, &entry);
+    evict_unused(texture_service);
+}
+
+void texture_set_vram_budget(struct texture_service *texture_service, size_t bytes)
+{
+    texture_service->vram_budget = bytes;
+    evict_unused(texture_service);
+}
+
 void texture_resize(struct texture *texture, int width, int height)
 {
     texture->width = width;
@@ -237,6 +890,35 @@ void texture_bind(struct texture *texture)
     glBindTexture(GL_TEXTURE_2D, texture->gl_texture);
 }
 
+void texture_upload(struct texture *texture, unsigned char *pixels)
+{
+    GLenum channel = get_gl_channel_enum(texture->channel_count);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, texture->gl_texture);
+
+    glTexSubImage2D(
+        GL_TEXTURE_2D,
+        0,
+        0,
+        0,
+        texture->width,
+        texture->height,
+        channel,
+        GL_UNSIGNED_BYTE,
+        pixels
+    );
+}
+
+unsigned char *texture_load_image(const char *path,
+                                  int *width,
+                                  int *height,
+                                  int *channel_count,
+                                  bool_t flip)
+{
+    return load_image(path, path, width, height, channel_count, flip);
+}
+
 static void create_rbo(struct render_target *render_target,
                        struct render_target_create_info *info)
 {
@@ -351,5 +1033,5 @@ void deserialize_texture(struct json_string *path,
     texture_create_info.generate_mip_maps   = FALSE;
     texture_create_info.filter_mode         = TEXTURE_FILTERMODE_LINEAR;
 
-    *p_texture = texture_create(service, &texture_create_info);
+    *p_texture = texture_acquire_async(service, path->string.chars, &texture_create_info);
 }
\ No newline at end of file
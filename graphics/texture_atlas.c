@@ -0,0 +1,359 @@
+#include <limits.h>
+
+#include <soul/debug.h>
+#include <soul/math/macros.h>
+#include <soul/graphics/texture_atlas.h>
+
+static void cleanup_page(struct texture_service *texture_service, struct texture_atlas_page *page)
+{
+    texture_destroy(texture_service, page->texture);
+    free(page->pixels);
+    free(page->free_rects);
+}
+
+/*
+ * Frees everything the atlas holds but leaves it in the service's list, for the service to
+ * free along with the rest of the list when it is deallocated.
+ */
+void texture_atlas_cleanup(struct texture_service *texture_service, struct texture_atlas *atlas)
+{
+    list_for_each (struct texture_atlas_page, page, atlas->pages) {
+        cleanup_page(texture_service, page);
+    }
+
+    list_destroy(&atlas->pages);
+    string_map_destroy(&atlas->regions);
+    string_destroy(atlas->name);
+}
+
+struct texture_atlas *texture_atlas_create(struct texture_service *texture_service,
+                                           struct texture_atlas_create_info *create_info)
+{
+    struct texture_atlas *atlas = list_alloc(&texture_service->atlases);
+
+    atlas->name             = string_create(create_info->name);
+    atlas->page_size        = create_info->page_size;
+    atlas->padding          = create_info->padding;
+    atlas->channel_count    = create_info->channel_count;
+    atlas->filter_mode      = create_info->filter_mode;
+
+    list_init(&atlas->pages, sizeof(struct texture_atlas_page));
+    string_map_init(&atlas->regions, sizeof(struct texture_region));
+
+    return atlas;
+}
+
+void texture_atlas_destroy(struct texture_service *texture_service, struct texture_atlas *atlas)
+{
+    texture_atlas_cleanup(texture_service, atlas);
+    list_remove(&texture_service->atlases, atlas);
+}
+
+static void push_free_rect(struct texture_atlas_page *page, struct texture_atlas_rect rect)
+{
+    if (page->free_rect_count == page->free_rect_capacity) {
+        page->free_rect_capacity = max(page->free_rect_capacity*2, 16);
+
+        page->free_rects = realloc(
+            page->free_rects,
+            page->free_rect_capacity*sizeof(struct texture_atlas_rect)
+        );
+    }
+
+    page->free_rects[page->free_rect_count++] = rect;
+}
+
+static struct texture_atlas_page *create_page(struct texture_service *texture_service,
+                                              struct texture_atlas *atlas)
+{
+    struct texture_atlas_page *page = list_alloc(&atlas->pages);
+
+    size_t bytes = atlas->page_size*atlas->page_size*atlas->channel_count;
+    page->pixels = calloc(1, bytes);
+
+    struct texture_create_info texture_create_info = NEW_TEXTURE_CREATE_INFO;
+    texture_create_info.name                = atlas->name.chars;
+    texture_create_info.width               = atlas->page_size;
+    texture_create_info.height              = atlas->page_size;
+    texture_create_info.channel_count       = atlas->channel_count;
+    texture_create_info.pixels              = page->pixels;
+    texture_create_info.filter_mode         = atlas->filter_mode;
+    texture_create_info.generate_mip_maps   = FALSE;
+    texture_create_info.no_memory_manage    = TRUE;
+    texture_create_info.flip                = FALSE;
+
+    page->texture = texture_create(texture_service, &texture_create_info);
+
+    push_free_rect(page, (struct texture_atlas_rect){ 0, 0, atlas->page_size, atlas->page_size });
+
+    return page;
+}
+
+/*
+ * MaxRects, best short side fit. Picks the free rect that leaves the smallest leftover on its
+ * shorter side, breaking ties on the longer side.
+ */
+static bool_t find_position(struct texture_atlas_page *page,
+                            int width,
+                            int height,
+                            struct texture_atlas_rect *result)
+{
+    int best_short = INT_MAX;
+    int best_long = INT_MAX;
+
+    for (int i = 0; i < page->free_rect_count; ++i) {
+        struct texture_atlas_rect *free_rect = page->free_rects + i;
+
+        if (free_rect->width < width || free_rect->height < height)
+            continue;
+
+        int leftover_x = free_rect->width - width;
+        int leftover_y = free_rect->height - height;
+        int short_side = min(leftover_x, leftover_y);
+        int long_side = max(leftover_x, leftover_y);
+
+        if (short_side < best_short || (short_side == best_short && long_side < best_long)) {
+            *result = (struct texture_atlas_rect){ free_rect->x, free_rect->y, width, height };
+
+            best_short  = short_side;
+            best_long   = long_side;
+        }
+    }
+
+    return best_short != INT_MAX;
+}
+
+static bool_t intersects(struct texture_atlas_rect *a, struct texture_atlas_rect *b)
+{
+    return a->x < b->x + b->width && b->x < a->x + a->width &&
+           a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+static bool_t contains(struct texture_atlas_rect *outer, struct texture_atlas_rect *inner)
+{
+    return inner->x >= outer->x && inner->y >= outer->y &&
+           inner->x + inner->width <= outer->x + outer->width &&
+           inner->y + inner->height <= outer->y + outer->height;
+}
+
+static void split_free_rect(struct texture_atlas_page *page,
+                            struct texture_atlas_rect free_rect,
+                            struct texture_atlas_rect *used)
+{
+    if (used->x > free_rect.x) {
+        push_free_rect(page, (struct texture_atlas_rect){
+            free_rect.x,
+            free_rect.y,
+            used->x - free_rect.x,
+            free_rect.height
+        });
+    }
+
+    if (used->x + used->width < free_rect.x + free_rect.width) {
+        push_free_rect(page, (struct texture_atlas_rect){
+            used->x + used->width,
+            free_rect.y,
+            free_rect.x + free_rect.width - (used->x + used->width),
+            free_rect.height
+        });
+    }
+
+    if (used->y > free_rect.y) {
+        push_free_rect(page, (struct texture_atlas_rect){
+            free_rect.x,
+            free_rect.y,
+            free_rect.width,
+            used->y - free_rect.y
+        });
+    }
+
+    if (used->y + used->height < free_rect.y + free_rect.height) {
+        push_free_rect(page, (struct texture_atlas_rect){
+            free_rect.x,
+            used->y + used->height,
+            free_rect.width,
+            free_rect.y + free_rect.height - (used->y + used->height)
+        });
+    }
+}
+
+static void prune_free_rects(struct texture_atlas_page *page)
+{
+    for (int i = 0; i < page->free_rect_count; ++i) {
+        for (int j = i + 1; j < page->free_rect_count; ++j) {
+            if (contains(page->free_rects + j, page->free_rects + i)) {
+                page->free_rects[i--] = page->free_rects[--page->free_rect_count];
+                break;
+            }
+
+            if (contains(page->free_rects + i, page->free_rects + j))
+                page->free_rects[j--] = page->free_rects[--page->free_rect_count];
+        }
+    }
+}
+
+static void place_rect(struct texture_atlas_page *page, struct texture_atlas_rect *used)
+{
+    // Rects split off below are appended past count, so they are never split again here.
+    int count = page->free_rect_count;
+
+    for (int i = 0; i < count;) {
+        if (!intersects(page->free_rects + i, used)) {
+            ++i;
+            continue;
+        }
+
+        struct texture_atlas_rect free_rect = page->free_rects[i];
+
+        page->free_rects[i]         = page->free_rects[count - 1];
+        page->free_rects[count - 1] = page->free_rects[page->free_rect_count - 1];
+
+        --count;
+        --page->free_rect_count;
+
+        split_free_rect(page, free_rect, used);
+    }
+
+    prune_free_rects(page);
+}
+
+static void copy_pixels(struct texture_atlas *atlas,
+                        struct texture_atlas_page *page,
+                        struct texture_atlas_rect *rect,
+                        unsigned char *pixels,
+                        int channel_count)
+{
+    for (int y = 0; y < rect->height; ++y) {
+        unsigned char *destination = page->pixels +
+            ((rect->y + y)*atlas->page_size + rect->x)*atlas->channel_count;
+        unsigned char *source = pixels + y*rect->width*channel_count;
+
+        if (channel_count == atlas->channel_count) {
+            memcpy(destination, source, rect->width*channel_count);
+            continue;
+        }
+
+        for (int x = 0; x < rect->width; ++x) {
+            for (int c = 0; c < atlas->channel_count; ++c) {
+                if (c < channel_count)
+                    destination[c] = source[c];
+                else
+                    destination[c] = (c == 3) ? 255 : source[0];
+            }
+
+            destination += atlas->channel_count;
+            source += channel_count;
+        }
+    }
+
+    page->dirty = TRUE;
+}
+
+struct texture_region *texture_atlas_add_pixels(struct texture_service *texture_service,
+                                                struct texture_atlas *atlas,
+                                                const char *name,
+                                                unsigned char *pixels,
+                                                int width,
+                                                int height,
+                                                int channel_count)
+{
+    struct texture_region *region = string_map_index(&atlas->regions, name);
+
+    if (region)
+        return region;
+
+    int padded_width = width + atlas->padding;
+    int padded_height = height + atlas->padding;
+
+    if (padded_width > atlas->page_size || padded_height > atlas->page_size) {
+        debug_log(
+            SEVERITY_WARNING,
+            "Failed to add '%s' to atlas '%s'. Image is larger than a page.\n",
+            name,
+            atlas->name.chars
+        );
+
+        return 0;
+    }
+
+    struct texture_atlas_page *page = 0;
+    struct texture_atlas_rect rect;
+
+    list_for_each (struct texture_atlas_page, iter, atlas->pages) {
+        if (find_position(iter, padded_width, padded_height, &rect)) {
+            page = iter;
+            break;
+        }
+    }
+
+    if (!page) {
+        page = create_page(texture_service, atlas);
+        find_position(page, padded_width, padded_height, &rect);
+    }
+
+    place_rect(page, &rect);
+
+    rect.width  = width;
+    rect.height = height;
+
+    copy_pixels(atlas, page, &rect, pixels, channel_count);
+
+    float page_size = atlas->page_size;
+
+    region = string_map_alloc(&atlas->regions, name);
+    region->texture = page->texture;
+    region->size    = vec2i(width, height);
+    region->uv_rect = vec4f(
+        rect.x/page_size,
+        rect.y/page_size,
+        width/page_size,
+        height/page_size
+    );
+
+    return region;
+}
+
+struct texture_region *texture_atlas_add_image(struct texture_service *texture_service,
+                                               struct texture_atlas *atlas,
+                                               const char *path)
+{
+    struct texture_region *region = string_map_index(&atlas->regions, path);
+
+    if (region)
+        return region;
+
+    int width, height, channel_count;
+    unsigned char *pixels = texture_load_image(path, &width, &height, &channel_count, TRUE);
+
+    if (!pixels)
+        return 0;
+
+    region = texture_atlas_add_pixels(
+        texture_service,
+        atlas,
+        path,
+        pixels,
+        width,
+        height,
+        channel_count
+    );
+
+    free(pixels);
+
+    return region;
+}
+
+struct texture_region *texture_atlas_find(struct texture_atlas *atlas, const char *name)
+{
+    return string_map_index(&atlas->regions, name);
+}
+
+void texture_atlas_upload(struct texture_atlas *atlas)
+{
+    list_for_each (struct texture_atlas_page, page, atlas->pages) {
+        if (page->dirty) {
+            texture_upload(page->texture, page->pixels);
+            page->dirty = FALSE;
+        }
+    }
+}
\ No newline at end of file
@@ -1,30 +1,94 @@
 #ifndef ECS_H
 #define ECS_H
 
+#include <stdint.h>
+#include <pthread.h>
+
 #include "math/transform.h"
 
 #include "list.h"
 #include "string.h"
+#include "slot_map.h"
+#include "pool.h"
 #include "core.h"
 #include "property_serialization.h"
 
 #define ECS_SERVICE "ecs_service"
 
+#define ECS_QUERY_MAX_COMPONENTS 8
+
+#define ECS_MAX_COMPONENT_TYPES 64
+
+#define ECS_CONTEXT_POOL_CHUNK_BLOCKS 32
+
+// Entity names shorter than this are stored in their context's name pool.
+#define ECS_CONTEXT_NAME_SIZE 32
+
+#define ECS_NAME_INDEX_MIN_BUCKETS 64
+
+#define ECS_PATH_SEPARATOR '/'
+
+// Leading path segments remembered between the paths of one entity_find_paths() call.
+#define ECS_PATH_CACHE_DEPTH 16
+
+#define ECS_STORAGE_ACTIVE  0
+#define ECS_STORAGE_PASSIVE 1
+
 struct component_reference;
+struct component_storage;
+
+/*
+ * Stays safe to hold after the entity is destroyed, resolving to null from then on.
+ */
+typedef slot_handle_t entity_handle_t;
+
+#define ENTITY_HANDLE_NULL SLOT_HANDLE_NULL
 
 struct entity
 {
-    struct string       name;
-    struct context *    context;
-    struct transform *  transform;
-    struct entity *     parent;
-    struct list         components; // struct component_reference
-    struct list         children; // struct entity *
+    struct string               name;
+    entity_handle_t             handle;
+    struct context *            context;
+    struct transform *          transform;
+    struct entity *             parent;
+    struct entity **            parent_link; // this entity's node in the parent's children
+    struct list                 components; // struct component_reference
+    struct list                 children; // struct entity *
+    bool_t                      destroying;
+    uint64_t                    component_mask; // bit per component type id
+    struct component_storage *  component_table; // one per set mask bit, by type id
+    uint32_t                    name_hash;
+    struct entity *             next_by_name; // chains of the context's name index
+    struct entity *             next_by_child;
 };
 
+/*
+ * Owns the memory of every entity created in it: the entities, their transforms, names, child
+ * and component lists and component storage. Destroying the context hands that memory back a
+ * chunk at a time rather than entity by entity.
+ */
 struct context
 {
-    struct string name;
+    struct string   name;
+    struct list     entities; // struct entity
+    struct list     transforms; // struct transform
+    int             entity_count;
+    struct pool     entity_pool;
+    struct pool     transform_pool;
+    struct pool     reference_pool; // struct component_reference nodes
+    struct pool     child_pool; // struct entity * nodes
+    struct pool     name_pool;
+    struct pool     component_pools[ECS_MAX_COMPONENT_TYPES][2]; // by type id, then ECS_STORAGE_*
+    struct entity **name_buckets; // by name
+    struct entity **child_buckets; // by parent and name
+    uint32_t        bucket_count;
+};
+
+struct context_memory_usage
+{
+    int     entity_count;
+    size_t  reserved_bytes; // held by the context's pools
+    size_t  used_bytes; // handed out to live allocations
 };
 
 struct component_storage
@@ -48,6 +112,7 @@ struct component_property
 struct component_descriptor
 {
     struct string           name;
+    int                     type_id;
     struct list             active_storage; // void
     struct list             passive_storage; // void
     component_callback_t    init;
@@ -63,12 +128,48 @@ struct component_reference
     struct component_storage        storage;
 };
 
+/*
+ * Entities holding every listed component, with their storage laid out row by row in the
+ * order the components were listed. Results are rebuilt lazily by ecs_query_refresh() once a
+ * component has been added or removed anywhere.
+ */
+struct ecs_query
+{
+    struct ecs_service *            ecs;
+    struct component_descriptor *   descriptors[ECS_QUERY_MAX_COMPONENTS];
+    int                             component_count;
+    uint64_t                        mask;
+    int                             ref_count;
+    unsigned int                    version;
+    struct entity **                entities;
+    struct component_storage *      storages;
+    int                             count;
+    int                             capacity;
+};
+
+#define ecs_query_storage(query, row, index) \
+    ((query)->storages[(row)*(query)->component_count + (index)])
+
+#define ecs_query_passive(query, row, index) (ecs_query_storage(query, row, index).passive)
+#define ecs_query_active(query, row, index) (ecs_query_storage(query, row, index).active)
+
+#define ECS_QUERY(ecs, ...) ecs_query_create(                   \
+    (ecs),                                                      \
+    (const char *[]){ __VA_ARGS__ },                            \
+    sizeof((const char *[]){ __VA_ARGS__ })/sizeof(const char *)\
+)
+
 struct ecs_service
 {
-    struct list         entities; // struct entity
-    struct list         transforms; // struct transform
+    struct slot_map     entity_slots; // struct entity *
     struct list         contexts; // struct context
     struct list         components; // struct component_descriptor
+    struct string_map   component_names; // struct component_descriptor *
+    int                 component_type_count;
+    struct list         queries; // struct ecs_query
+    unsigned int        structure_version;
+    struct list         command_buffers; // struct ecs_command_buffer
+    pthread_mutex_t     command_mutex;
     struct context *    default_context;
     struct string_map   property_serializers; // struct serializer
 };
@@ -104,22 +205,72 @@ struct component_registry_info
     int                                         property_count;
 };
 
+/*
+ * Storage of the first instance of a component type on an entity. Lookups index the table by
+ * the number of lower type ids present, so they never walk the component list.
+ */
+static inline bool_t entity_has_component(struct entity *entity, int type_id)
+{
+    return (entity->component_mask >> type_id) & 1;
+}
+
+static inline struct component_storage entity_get_storage(struct entity *entity, int type_id)
+{
+    if (!entity_has_component(entity, type_id))
+        return (struct component_storage){ 0, 0 };
+
+    uint64_t lower = entity->component_mask & ((UINT64_C(1) << type_id) - 1);
+
+    return entity->component_table[__builtin_popcountll(lower)];
+}
+
+#define entity_get_passive(entity, type, type_id) \
+    ((type *)entity_get_storage((entity), (type_id)).passive)
+
+#define entity_get_active(entity, type, type_id) \
+    ((type *)entity_get_storage((entity), (type_id)).active)
+
 void                            ecs_service_create_resource(struct soul_instance *instance);
 struct entity *                 entity_create(struct ecs_service *ecs,
                                               const char *name,
                                               struct context *context,
                                               struct entity *parent);
+void                            entity_create_batch(struct ecs_service *ecs,
+                                                    const char **names,
+                                                    int count,
+                                                    struct context *context,
+                                                    struct entity *parent,
+                                                    struct entity **entities);
 void                            entity_destroy(struct ecs_service *ecs, struct entity *entity);
+void                            entity_destroy_batch(struct ecs_service *ecs,
+                                                     struct entity **entities,
+                                                     int count);
+struct entity *                 entity_resolve(struct ecs_service *ecs, entity_handle_t handle);
+bool_t                          entity_is_valid(struct ecs_service *ecs, entity_handle_t handle);
+bool_t                          entity_destroy_handle(struct ecs_service *ecs,
+                                                      entity_handle_t handle);
 struct entity *                 entity_load(struct ecs_service *ecs,
                                             const char *path,
                                             struct context *context,
                                             struct entity *parent);
 void                            entity_set_name(struct entity *entity, const char *name);
+struct entity *                 entity_find_child(struct entity *entity, const char *child);
 struct entity *                 entity_find_child_recursive(struct entity *entity,
                                                             const char *child);
+struct entity *                 entity_find_path(struct entity *entity, const char *path);
+void                            entity_find_paths(struct entity *entity,
+                                                  const char **paths,
+                                                  int count,
+                                                  struct entity **results);
+struct entity *                 context_find_path(struct context *context, const char *path);
 struct component_storage        component_instance(struct ecs_service *ecs,
                                                    struct entity *entity,
                                                    const char *component);
+struct component_storage        component_instance_descriptor(
+                                    struct ecs_service *ecs,
+                                    struct entity *entity,
+                                    struct component_descriptor *descriptor,
+                                    const void *passive_data);
 void                            component_destroy_instance(struct ecs_service *ecs,
                                                            struct entity *entity,
                                                            struct component_storage storage);
@@ -128,9 +279,18 @@ struct component_storage        component_get_storage(struct ecs_service *ecs,
                                                       const char *name);
 struct context *                context_create(struct ecs_service *ecs, const char *name);
 void                            context_destroy(struct ecs_service *ecs, struct context *context);
+void                            context_destroy_entities(struct ecs_service *ecs,
+                                                         struct context *context);
+void                            context_get_memory_usage(struct context *context,
+                                                         struct context_memory_usage *usage);
 struct component_descriptor *   component_register(struct ecs_service *ecs,
                                                    struct component_registry_info *registry_info);
 struct component_descriptor *   component_match_descriptor(struct ecs_service *ecs,
                                                            const char *component);
+struct ecs_query *              ecs_query_create(struct ecs_service *ecs,
+                                                 const char **components,
+                                                 int component_count);
+void                            ecs_query_destroy(struct ecs_query *query);
+struct ecs_query *              ecs_query_refresh(struct ecs_query *query);
 
 #endif // ECS_H
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef ECS_COMMANDS_H
+#define ECS_COMMANDS_H
+
+#include "ecs.h"
+
+#define ECS_COMMAND_BUFFER_MIN_CAPACITY 64
+
+/*
+ * Entities created through a command buffer get a pending handle straight away, which later
+ * commands in the same buffer may target. Pending handles carry generation zero, so they never
+ * resolve through entity_resolve().
+ */
+#define ecs_command_is_pending(handle) \
+    ((handle) != ENTITY_HANDLE_NULL && slot_handle_generation(handle) == 0)
+
+enum ecs_command_type
+{
+    ECS_COMMAND_CREATE_ENTITY,
+    ECS_COMMAND_DESTROY_ENTITY,
+    ECS_COMMAND_ADD_COMPONENT,
+    ECS_COMMAND_REMOVE_COMPONENT
+};
+
+struct ecs_command
+{
+    enum ecs_command_type           type;
+    entity_handle_t                 entity;
+    entity_handle_t                 parent;
+    struct context *                context;
+    struct component_descriptor *   descriptor;
+    size_t                          payload_offset; // entity name or passive storage
+};
+
+/*
+ * Records structural changes from one thread, to be applied by ecs_commands_playback(). A buffer
+ * must not be recorded into while playback is running.
+ */
+struct ecs_command_buffer
+{
+    struct ecs_service *    ecs;
+    pthread_t               owner;
+    struct ecs_command *    commands;
+    int                     command_count;
+    int                     command_capacity;
+    char *                  payload;
+    size_t                  payload_size;
+    size_t                  payload_capacity;
+    entity_handle_t *       created; // real handle per pending handle, filled on playback
+    int                     create_count;
+    int                     create_capacity;
+};
+
+void                        ecs_commands_init(struct ecs_service *ecs,
+                                              struct soul_instance *instance);
+void                        ecs_commands_destroy(struct ecs_service *ecs);
+struct ecs_command_buffer * ecs_commands_acquire(struct ecs_service *ecs);
+void                        ecs_commands_playback(struct ecs_service *ecs);
+entity_handle_t             ecs_command_create_entity(struct ecs_command_buffer *buffer,
+                                                      const char *name,
+                                                      struct context *context,
+                                                      entity_handle_t parent);
+void                        ecs_command_destroy_entity(struct ecs_command_buffer *buffer,
+                                                       entity_handle_t entity);
+void                        ecs_command_add_component(struct ecs_command_buffer *buffer,
+                                                      entity_handle_t entity,
+                                                      const char *component,
+                                                      const void *passive_data);
+void                        ecs_command_remove_component(struct ecs_command_buffer *buffer,
+                                                         entity_handle_t entity,
+                                                         const char *component);
+
+#endif // ECS_COMMANDS_H
@@ -0,0 +1,32 @@
+#ifndef ECS_PARALLEL_H
+#define ECS_PARALLEL_H
+
+#include "ecs.h"
+#include "thread_pool.h"
+
+#define COMPONENT_DEFAULT_CHUNK_SIZE 1024
+
+// Handles count consecutive passive storage instances, as chunk number chunk_index.
+typedef void(*component_chunk_t)(void **instances, int count, int chunk_index, void *data);
+
+// Folds count consecutive instances into partial, which starts out as the identity.
+typedef void(*component_map_t)(void **instances, int count, void *partial, void *data);
+
+// Folds one chunk's partial result into the accumulator.
+typedef void(*component_reduce_t)(void *accumulator, const void *partial, void *data);
+
+void component_parallel_for(struct thread_pool_service *pool,
+                            struct component_descriptor *descriptor,
+                            int chunk_size,
+                            component_chunk_t fn,
+                            void *data);
+void component_parallel_reduce(struct thread_pool_service *pool,
+                               struct component_descriptor *descriptor,
+                               int chunk_size,
+                               component_map_t map,
+                               component_reduce_t reduce,
+                               void *result,
+                               size_t result_size,
+                               void *data);
+
+#endif // ECS_PARALLEL_H
@@ -1,7 +1,21 @@
 #ifndef FILE_H
 #define FILE_H
 
-char *  file_to_buffer(const char *path, size_t *bytes);
-void    file_free_buffer(char *buffer);
+#include <stddef.h>
+
+#include "typedefs.h"
+
+// A whole file mapped read only into memory.
+struct file_mapping
+{
+    void *  data;
+    size_t  size;
+    void *  handle; // of the mapping, on Windows
+};
+
+char *      file_to_buffer(const char *path, size_t *bytes);
+void        file_free_buffer(char *buffer);
+result_t    file_map(const char *path, struct file_mapping *mapping);
+void        file_unmap(struct file_mapping *mapping);
 
 #endif // FILE_H
\ No newline at end of file
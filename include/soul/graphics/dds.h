@@ -0,0 +1,39 @@
+#ifndef DDS_H
+#define DDS_H
+
+#include "../typedefs.h"
+#include "texture.h"
+
+#define DDS_MAX_MIP_COUNT 16
+
+/*
+ * Block compressed images stored in a dds container. Files written by dds_encode_file() hold
+ * their rows bottom-up, matching textures loaded with flip enabled, and say so in the header.
+ * Everything else is taken to be top-down, as the format intends, and dds_flip() turns either
+ * over. Blocks whose rows cannot be reordered are decoded instead, which leaves the image
+ * uncompressed with channel_count bytes per pixel.
+ */
+struct dds_image
+{
+    texture_format_t    format;
+    int                 width;
+    int                 height;
+    int                 channel_count;
+    int                 mip_count;
+    bool_t              bottom_up;
+    unsigned char *     data;
+    size_t              level_offsets[DDS_MAX_MIP_COUNT];
+    size_t              level_sizes[DDS_MAX_MIP_COUNT];
+};
+
+bool_t      dds_is_path(const char *path);
+result_t    dds_load(const char *path, struct dds_image *image);
+void        dds_free(struct dds_image *image);
+void        dds_flip(struct dds_image *image);
+size_t      dds_level_size(texture_format_t format, int width, int height);
+result_t    dds_encode_file(const char *source_path,
+                            const char *destination_path,
+                            texture_format_t format,
+                            bool_t generate_mip_maps);
+
+#endif // DDS_H
\ No newline at end of file
@@ -14,6 +14,21 @@
 #define ATTRIBUTE_UV        1
 #define ATTRIBUTE_NORMAL    2
 
+#define ATTRIBUTE_BIT(attribute) (1 << (attribute))
+
+typedef int mesh_usage_t;
+#define MESH_USAGE_STATIC   0
+#define MESH_USAGE_DYNAMIC  1
+
+/*
+ * Dynamic meshes keep MESH_RING_REGION_COUNT copies of their vertex data in each vbo. Every
+ * mesh_begin_update() moves to the next region, so the cpu never writes into memory the gpu may
+ * still be reading from a previous frame. mesh_update_range() writes into the current region
+ * only, so its changes are gone once the next mesh_begin_update() moves on; it patches a frame's
+ * data rather than the mesh for good.
+ */
+#define MESH_RING_REGION_COUNT 3
+
 struct mesh
 {
     struct string   name;
@@ -27,6 +42,12 @@ struct mesh
     unsigned int    vbos[ATTRIBUTE_COUNT];
     unsigned int    index_vbo;
     bool_t          read_write_enabled;
+    int             attributes;
+    mesh_usage_t    usage;
+    int             vertex_capacity;
+    int             triangle_capacity;
+    int             region;
+    void *          region_fences[MESH_RING_REGION_COUNT]; // GLsync
 };
 
 struct mesh_create_info
@@ -40,6 +61,10 @@ struct mesh_create_info
     int             triangle_count;
     bool_t          read_write_enabled;
     const char *    resource_path;
+    mesh_usage_t    usage;
+    int             vertex_capacity;
+    int             triangle_capacity;
+    int             dynamic_attributes;
 };
 
 #define NEW_MESH_CREATE_INFO ((struct mesh_create_info){    \
@@ -50,9 +75,22 @@ struct mesh_create_info
     .vertex_count       = 0,                                \
     .triangle_count     = 0,                                \
     .read_write_enabled = FALSE,                            \
-    .resource_path      = 0                                 \
+    .resource_path      = 0,                                \
+    .usage              = MESH_USAGE_STATIC,                \
+    .vertex_capacity    = 0,                                \
+    .triangle_capacity  = 0,                                \
+    .dynamic_attributes = ATTRIBUTE_BIT(ATTRIBUTE_POSITION) \
+                        | ATTRIBUTE_BIT(ATTRIBUTE_UV)       \
 })
 
+struct mesh_write_region
+{
+    struct vec3f *  vertices;
+    struct vec2f *  uvs;
+    struct vec3f *  normals;
+    int             vertex_count;
+};
+
 struct mesh_primitives
 {
     struct mesh *quad;
@@ -70,4 +108,14 @@ struct mesh *   mesh_create(struct mesh_service *service, struct mesh_create_inf
 void            mesh_destroy(struct mesh_service *service, struct mesh *mesh);
 void            mesh_draw(struct mesh *mesh);
 
+struct mesh_write_region    mesh_begin_update(struct mesh *mesh,
+                                              int vertex_count,
+                                              int triangle_count);
+void                        mesh_end_update(struct mesh *mesh);
+void                        mesh_update_range(struct mesh *mesh,
+                                              int attribute,
+                                              int first_vertex,
+                                              int vertex_count,
+                                              void *data);
+
 #endif // MESH_H
\ No newline at end of file
@@ -39,6 +39,7 @@ void            shader_destroy(struct shader_service *shader_service, struct sha
 void            shader_uniform_mat4x4(uniform_t uniform, struct mat4x4 *value);
 void            shader_uniform_vec4f(uniform_t uniform, struct vec4f value);
 void            shader_uniform_int(uniform_t uniform, int value);
+void            shader_uniform_float(uniform_t uniform, float value);
 uniform_t       shader_get_uniform(struct shader *shader, const char *name);
 void            shader_bind(struct shader *shader);
 
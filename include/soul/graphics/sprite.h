@@ -2,17 +2,38 @@
 #define SPRITE_H
 
 #include "../ecs.h"
+#include "../spatial.h"
 #include "../graphics/texture.h"
 
 #define SPRITE "sprite"
+#define SPRITE_RENDER_CACHE "sprite_render_cache"
+
+// Every sprite's world space bounds as of the last rendered frame, with the sprite as data.
+#define SPRITE_SPATIAL_INDEX SPRITE
 
 struct sprite
 {
-    struct transform *  transform;
-    struct texture *    texture;
+    struct transform *      transform;
+    struct texture_region   region;
+    spatial_item_t          spatial_item;
+    int                     render_index; // into the render pass's arrays, -1 until drawn
+};
+
+// Sprites tested against each camera's visible rect, summed over cameras.
+struct sprite_render_stats
+{
+    int tested;
+    int visible;
+    int culled;
 };
 
-void sprite_register_component(struct soul_instance *soul_instance);
-void sprite_set_texture(struct sprite *sprite, struct texture *texture, bool_t match_size);
+void                        sprite_register_component(struct soul_instance *soul_instance);
+void                        sprite_set_texture(struct sprite *sprite,
+                                               struct texture *texture,
+                                               bool_t match_size);
+void                        sprite_set_region(struct sprite *sprite,
+                                              struct texture_region *region,
+                                              bool_t match_size);
+struct sprite_render_stats  sprite_get_render_stats(struct soul_instance *soul_instance);
 
 #endif // SPRITE_H
\ No newline at end of file
@@ -4,33 +4,103 @@
 #include "../typedefs.h"
 #include "../string.h"
 #include "../callbacks.h"
+#include "../string_map.h"
+#include "../thread_pool.h"
 #include "core.h"
 
 typedef int texture_filtermode_t;
 #define TEXTURE_FILTERMODE_NEAREST  0
 #define TEXTURE_FILTERMODE_LINEAR   1
 
+typedef int texture_format_t;
+#define TEXTURE_FORMAT_UNCOMPRESSED 0
+#define TEXTURE_FORMAT_BC1          1
+#define TEXTURE_FORMAT_BC3          2
+#define TEXTURE_FORMAT_BC4          3
+#define TEXTURE_FORMAT_BC7          4
+
 #define TEXTURE_SERVICE "texture_service"
 
+#define TEXTURE_DEFAULT_VRAM_BUDGET (256*1024*1024)
+
+#define TEXTURE_MAX_MIP_COUNT 16
+
 struct texture_service
 {
-    struct list textures; // struct texture
-    struct list render_targets; // struct render_target
+    struct list                     textures; // struct texture
+    struct list                     render_targets; // struct render_target
+    struct list                     atlases; // struct texture_atlas
+    struct string_map               cache; // struct texture_cache_entry
+    struct list                     unused_cache_entries; // struct texture_cache_entry *, oldest first
+    size_t                          vram_usage;
+    size_t                          vram_budget;
+    struct thread_pool_service *    thread_pool;
+    pthread_mutex_t                 load_mutex;
+    struct list                     completed_loads; // struct texture_load_job *
+    unsigned int                    upload_pbo;
+};
+
+/*
+ * Decoded on a worker, then uploaded by the gl thread before the next render. Every level lives
+ * in one allocation so it can be copied into the pixel buffer in a single pass.
+ */
+struct texture_load_job
+{
+    struct texture_service *    service;
+    struct texture *            texture; // zero once the texture is destroyed mid load
+    struct string               path;
+    bool_t                      flip;
+    bool_t                      generate_mip_maps;
+    bool_t                      read_write_enabled;
+    int                         width;
+    int                         height;
+    int                         channel_count;
+    int                         mip_count;
+    unsigned char *             data;
+    size_t                      level_offsets[TEXTURE_MAX_MIP_COUNT];
+    size_t                      size;
+};
+
+struct texture_cache_entry
+{
+    struct string                   path;
+    struct texture *                texture;
+    int                             ref_count;
+    size_t                          bytes;
+    struct texture_cache_entry **   unused_node;
 };
 
 struct texture
 {
-    struct string           name;
-    int                     width;
-    int                     height;
-    int                     channel_count;
-    bool_t                  read_write_enabled;
-    unsigned char *         pixels;
-    bool_t                  no_memory_manage;
-    unsigned int            gl_texture;
-    texture_filtermode_t    filter_mode;
+    struct string                   name;
+    int                             width;
+    int                             height;
+    int                             channel_count;
+    bool_t                          read_write_enabled;
+    unsigned char *                 pixels;
+    bool_t                          no_memory_manage;
+    unsigned int                    gl_texture;
+    texture_filtermode_t            filter_mode;
+    texture_format_t                format;
+    int                             mip_count;
+    struct texture_cache_entry *    cache_entry;
+    struct texture_load_job *       load_job;
+    bool_t                          load_failed; // the file could not be decoded asynchronously
 };
 
+struct texture_region
+{
+    struct texture *texture;
+    struct vec4f    uv_rect; // x, y, width, height
+    struct vec2i    size;
+};
+
+#define texture_region_full(p_texture) ((struct texture_region){  \
+    .texture    = (p_texture),                                  \
+    .uv_rect    = vec4f(0, 0, 1, 1),                            \
+    .size       = vec2i((p_texture)->width, (p_texture)->height)\
+})
+
 struct texture_create_info
 {
     const char *            name;
@@ -93,8 +163,28 @@ struct texture *        texture_create(struct texture_service *texture_service,
                                        struct texture_create_info *create_info);
 void                    texture_destroy(struct texture_service *texture_service,
                                         struct texture *texture);
+struct texture *        texture_acquire(struct texture_service *texture_service,
+                                        const char *path,
+                                        struct texture_create_info *create_info);
+struct texture *        texture_load_async(struct texture_service *texture_service,
+                                           struct texture_create_info *create_info);
+struct texture *        texture_acquire_async(struct texture_service *texture_service,
+                                              const char *path,
+                                              struct texture_create_info *create_info);
+bool_t                  texture_is_loaded(struct texture *texture);
+bool_t                  texture_load_failed(struct texture *texture);
+void                    texture_release(struct texture_service *texture_service,
+                                        struct texture *texture);
+void                    texture_set_vram_budget(struct texture_service *texture_service,
+                                                size_t bytes);
 void                    texture_resize(struct texture *texture, int width, int height);
 void                    texture_bind(struct texture *texture);
+void                    texture_upload(struct texture *texture, unsigned char *pixels);
+unsigned char *         texture_load_image(const char *path,
+                                           int *width,
+                                           int *height,
+                                           int *channel_count,
+                                           bool_t flip);
 struct render_target *  render_target_create(struct texture_service *texture_service,
                                              struct render_target_create_info *info);
 void                    render_target_destroy(struct texture_service *texture_service,
@@ -0,0 +1,76 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include "../string.h"
+#include "../string_map.h"
+#include "../list.h"
+#include "texture.h"
+
+#define TEXTURE_ATLAS_DEFAULT_PAGE_SIZE 2048
+
+struct texture_atlas_rect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+struct texture_atlas_page
+{
+    struct texture *                texture;
+    unsigned char *                 pixels;
+    struct texture_atlas_rect *     free_rects;
+    int                             free_rect_count;
+    int                             free_rect_capacity;
+    bool_t                          dirty;
+};
+
+struct texture_atlas
+{
+    struct string           name;
+    int                     page_size;
+    int                     padding;
+    int                     channel_count;
+    texture_filtermode_t    filter_mode;
+    struct list             pages; // struct texture_atlas_page
+    struct string_map       regions; // struct texture_region
+};
+
+struct texture_atlas_create_info
+{
+    const char *            name;
+    int                     page_size;
+    int                     padding;
+    int                     channel_count;
+    texture_filtermode_t    filter_mode;
+};
+
+#define NEW_TEXTURE_ATLAS_CREATE_INFO ((struct texture_atlas_create_info){  \
+    .name           = "texture_atlas",                                      \
+    .page_size      = TEXTURE_ATLAS_DEFAULT_PAGE_SIZE,                      \
+    .padding        = 1,                                                    \
+    .channel_count  = 4,                                                    \
+    .filter_mode    = TEXTURE_FILTERMODE_LINEAR                             \
+})
+
+struct texture_atlas *  texture_atlas_create(struct texture_service *texture_service,
+                                             struct texture_atlas_create_info *create_info);
+void                    texture_atlas_destroy(struct texture_service *texture_service,
+                                              struct texture_atlas *atlas);
+void                    texture_atlas_cleanup(struct texture_service *texture_service,
+                                              struct texture_atlas *atlas);
+struct texture_region * texture_atlas_add_image(struct texture_service *texture_service,
+                                                struct texture_atlas *atlas,
+                                                const char *path);
+struct texture_region * texture_atlas_add_pixels(struct texture_service *texture_service,
+                                                 struct texture_atlas *atlas,
+                                                 const char *name,
+                                                 unsigned char *pixels,
+                                                 int width,
+                                                 int height,
+                                                 int channel_count);
+struct texture_region * texture_atlas_find(struct texture_atlas *atlas, const char *name);
+void                    texture_atlas_upload(struct texture_atlas *atlas);
+
+#endif // TEXTURE_ATLAS_H
\ No newline at end of file
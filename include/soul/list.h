@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "pool.h"
+
 struct list_node_header
 {
     struct list_node_header *   prev;
@@ -15,11 +17,13 @@ struct list
     size_t                      data_size;
     struct list_node_header *   head;
     struct list_node_header *   tail;
+    struct pool *               pool; // nodes come from here when set, the heap otherwise
 };
 
 #define list_node_data_ptr(type, node)  ((type *)(node + 1))
 #define list_node_data(type, node)      (*(type *)(node + 1))
 #define list_node_from_data(p_data)     (((struct list_node_header *)p_data) - 1)
+#define list_node_size(data_size)       (sizeof(struct list_node_header) + (data_size))
 
 #define list_for_each(iter_type, iter, list)                                    \
     for (iter_type *iter = (list).head ?                                        \
@@ -31,10 +35,15 @@ struct list
                 0)
 
 void                        list_init(struct list *list, size_t data_size);
+void                        list_init_pooled(struct list *list,
+                                             size_t data_size,
+                                             struct pool *pool);
 void                        list_destroy(struct list *list);
 struct list_node_header *   list_alloc_node(struct list *list);
+void *                      list_append_node(struct list *list, struct list_node_header *node);
 void *                      list_alloc(struct list *list);
 void *                      list_push(struct list *list, void *p_data);
+struct list_node_header *   list_unlink(struct list *list, void *p_data);
 void                        list_remove(struct list *list, void *p_data);
 void                        list_remove_value(struct list *list, void *p_data);
 void *                      list_insert(struct list *list, void *p_after, void *p_data);
@@ -0,0 +1,39 @@
+#ifndef AFFINE_H
+#define AFFINE_H
+
+#include "../typedefs.h"
+#include "matrix.h"
+#include "transform.h"
+
+/*
+ * A mat4x4 without its last row, which is always 0, 0, 0, 1 for world transforms. Same row
+ * major layout, translation in m03, m07 and m11.
+ */
+struct affine3x4
+{
+    float m00; float m01; float m02; float m03;
+    float m04; float m05; float m06; float m07;
+    float m08; float m09; float m10; float m11;
+} __attribute__((aligned(16)));
+
+#define AFFINE3X4_IDENTITY ((struct affine3x4){ \
+    1, 0, 0, 0,                                 \
+    0, 1, 0, 0,                                 \
+    0, 0, 1, 0                                  \
+})
+
+void                affine_compose(struct transform *transform, struct affine3x4 *result);
+void                affine_compose_batch(struct transform **transforms,
+                                         struct affine3x4 *results,
+                                         int count);
+struct affine3x4    affine_mul(struct affine3x4 *a, struct affine3x4 *b);
+bool_t              affine_inverse(struct affine3x4 *a, struct affine3x4 *result);
+struct affine3x4    affine_inverse_orthogonal(struct affine3x4 *a);
+void                affine_transform_points(struct affine3x4 *a,
+                                            struct vec3f *points,
+                                            struct vec3f *results,
+                                            int count);
+struct mat4x4       affine_to_mat4x4(struct affine3x4 *a);
+struct mat4x4       mat4x4_mul_affine(struct mat4x4 *m, struct affine3x4 *a);
+
+#endif // AFFINE_H
@@ -1,7 +1,9 @@
 #ifndef MATRIX_H
 #define MATRIX_H
 
+#include "../typedefs.h"
 #include "vector.h"
+#include "transform.h"
 
 struct mat4x4
 {
@@ -9,7 +11,7 @@ struct mat4x4
     float m04; float m05; float m06; float m07; 
     float m08; float m09; float m10; float m11; 
     float m12; float m13; float m14; float m15; 
-};
+} __attribute__((aligned(16)));
 
 #define mat4x4(m00, m01, m02, m03,                      \
                m04, m05, m06, m07,                      \
@@ -29,8 +31,16 @@ struct mat4x4
 )
 
 struct mat4x4   mul4x4(struct mat4x4 *a, struct mat4x4 *b);
+struct vec4f    mat4x4_mul_vec4f(struct mat4x4 *m, struct vec4f v);
+void            mat4x4_transform_points(struct mat4x4 *m,
+                                        struct vec3f *points,
+                                        struct vec3f *results,
+                                        int count);
+struct mat4x4   mat4x4_transpose(struct mat4x4 *m);
+bool_t          mat4x4_inverse(struct mat4x4 *m, struct mat4x4 *result);
 void            mat4x4_set_pos(struct mat4x4 *m, struct vec3f pos);
 void            mat4x4_set_scale(struct mat4x4 *m, struct vec3f scale);
 void            mat4x4_set_rot(struct mat4x4 *m, struct vec3f rot);
+struct mat4x4   mat4x4_compose(struct transform *transform);
 
 #endif // MATRIX_H
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+#include "vector.h"
+
+struct quat
+{
+    float x;
+    float y;
+    float z;
+    float w;
+} __attribute__((aligned(16)));
+
+#define quat(x, y, z, w) ((struct quat){ (x), (y), (z), (w) })
+
+#define QUAT_IDENTITY quat(0, 0, 0, 1)
+
+struct quat     quat_from_axis_angle(struct vec3f axis, float angle);
+struct quat     quat_from_euler(struct vec3f rot);
+struct quat     quat_mul(struct quat a, struct quat b);
+struct quat     quat_normalize(struct quat q);
+struct quat     quat_conjugate(struct quat q);
+struct vec3f    quat_rotate_vec3f(struct quat q, struct vec3f v);
+void            quat_to_rotation_rows(struct quat q, float rows[12]);
+
+#endif // QUATERNION_H
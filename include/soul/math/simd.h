@@ -0,0 +1,224 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/*
+ * Four wide float vectors over SSE, NEON or plain C. Loads and stores expect 16 byte aligned
+ * memory unless suffixed with u. Comparisons give lanes of all ones or all zeros, and
+ * simd4f_movemask() packs their top bits into the low four bits of an int, lane 0 lowest.
+ */
+
+#if defined(__SSE__)
+#define SIMD_SSE
+
+#include <xmmintrin.h>
+
+typedef __m128 simd4f_t;
+
+static inline simd4f_t simd4f_load(const float *p)             { return _mm_load_ps(p); }
+static inline simd4f_t simd4f_loadu(const float *p)            { return _mm_loadu_ps(p); }
+static inline void     simd4f_store(float *p, simd4f_t v)      { _mm_store_ps(p, v); }
+static inline void     simd4f_storeu(float *p, simd4f_t v)     { _mm_storeu_ps(p, v); }
+static inline simd4f_t simd4f_set1(float s)                    { return _mm_set1_ps(s); }
+static inline simd4f_t simd4f_add(simd4f_t a, simd4f_t b)      { return _mm_add_ps(a, b); }
+static inline simd4f_t simd4f_sub(simd4f_t a, simd4f_t b)      { return _mm_sub_ps(a, b); }
+static inline simd4f_t simd4f_mul(simd4f_t a, simd4f_t b)      { return _mm_mul_ps(a, b); }
+static inline simd4f_t simd4f_min(simd4f_t a, simd4f_t b)      { return _mm_min_ps(a, b); }
+static inline simd4f_t simd4f_max(simd4f_t a, simd4f_t b)      { return _mm_max_ps(a, b); }
+static inline simd4f_t simd4f_cmpge(simd4f_t a, simd4f_t b)    { return _mm_cmpge_ps(a, b); }
+static inline simd4f_t simd4f_cmple(simd4f_t a, simd4f_t b)    { return _mm_cmple_ps(a, b); }
+static inline simd4f_t simd4f_and(simd4f_t a, simd4f_t b)      { return _mm_and_ps(a, b); }
+static inline int      simd4f_movemask(simd4f_t v)             { return _mm_movemask_ps(v); }
+
+static inline simd4f_t simd4f_set(float x, float y, float z, float w)
+{
+    return _mm_setr_ps(x, y, z, w);
+}
+
+// a*b + c
+static inline simd4f_t simd4f_madd(simd4f_t a, simd4f_t b, simd4f_t c)
+{
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+
+#define simd4f_splat(v, lane) _mm_shuffle_ps((v), (v), _MM_SHUFFLE(lane, lane, lane, lane))
+
+#define simd4f_transpose(r0, r1, r2, r3) _MM_TRANSPOSE4_PS(r0, r1, r2, r3)
+
+#elif defined(__ARM_NEON)
+#define SIMD_NEON
+
+#include <arm_neon.h>
+
+typedef float32x4_t simd4f_t;
+
+static inline simd4f_t simd4f_load(const float *p)             { return vld1q_f32(p); }
+static inline simd4f_t simd4f_loadu(const float *p)            { return vld1q_f32(p); }
+static inline void     simd4f_store(float *p, simd4f_t v)      { vst1q_f32(p, v); }
+static inline void     simd4f_storeu(float *p, simd4f_t v)     { vst1q_f32(p, v); }
+static inline simd4f_t simd4f_set1(float s)                    { return vdupq_n_f32(s); }
+static inline simd4f_t simd4f_add(simd4f_t a, simd4f_t b)      { return vaddq_f32(a, b); }
+static inline simd4f_t simd4f_sub(simd4f_t a, simd4f_t b)      { return vsubq_f32(a, b); }
+static inline simd4f_t simd4f_mul(simd4f_t a, simd4f_t b)      { return vmulq_f32(a, b); }
+static inline simd4f_t simd4f_min(simd4f_t a, simd4f_t b)      { return vminq_f32(a, b); }
+static inline simd4f_t simd4f_max(simd4f_t a, simd4f_t b)      { return vmaxq_f32(a, b); }
+
+static inline simd4f_t simd4f_cmpge(simd4f_t a, simd4f_t b)
+{
+    return vreinterpretq_f32_u32(vcgeq_f32(a, b));
+}
+
+static inline simd4f_t simd4f_cmple(simd4f_t a, simd4f_t b)
+{
+    return vreinterpretq_f32_u32(vcleq_f32(a, b));
+}
+
+static inline simd4f_t simd4f_and(simd4f_t a, simd4f_t b)
+{
+    return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+
+static inline int simd4f_movemask(simd4f_t v)
+{
+    uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(v), 31);
+
+    return vgetq_lane_u32(bits, 0)      | (vgetq_lane_u32(bits, 1) << 1) |
+           (vgetq_lane_u32(bits, 2) << 2) | (vgetq_lane_u32(bits, 3) << 3);
+}
+
+static inline simd4f_t simd4f_set(float x, float y, float z, float w)
+{
+    float values[4] = { x, y, z, w };
+
+    return vld1q_f32(values);
+}
+
+// a*b + c
+static inline simd4f_t simd4f_madd(simd4f_t a, simd4f_t b, simd4f_t c)
+{
+    return vmlaq_f32(c, a, b);
+}
+
+#define simd4f_splat(v, lane) vdupq_n_f32(vgetq_lane_f32((v), lane))
+
+#define simd4f_transpose(r0, r1, r2, r3) do {                                  \
+    float32x4x2_t t01 = vtrnq_f32((r0), (r1));                                  \
+    float32x4x2_t t23 = vtrnq_f32((r2), (r3));                                  \
+    (r0) = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));   \
+    (r1) = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));   \
+    (r2) = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])); \
+    (r3) = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])); \
+} while (0)
+
+#else
+#define SIMD_SCALAR
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct { float lanes[4]; } simd4f_t;
+
+static inline simd4f_t simd4f_set(float x, float y, float z, float w)
+{
+    return (simd4f_t){ { x, y, z, w } };
+}
+
+static inline simd4f_t simd4f_load(const float *p)
+{
+    return simd4f_set(p[0], p[1], p[2], p[3]);
+}
+
+static inline void simd4f_store(float *p, simd4f_t v)
+{
+    p[0] = v.lanes[0]; p[1] = v.lanes[1]; p[2] = v.lanes[2]; p[3] = v.lanes[3];
+}
+
+#define simd4f_loadu    simd4f_load
+#define simd4f_storeu   simd4f_store
+
+static inline simd4f_t simd4f_set1(float s)
+{
+    return simd4f_set(s, s, s, s);
+}
+
+#define SIMD_SCALAR_OP(name, expr)                                      \
+static inline simd4f_t name(simd4f_t a, simd4f_t b)                     \
+{                                                                       \
+    simd4f_t r;                                                         \
+    for (int i = 0; i < 4; ++i) {                                       \
+        float x = a.lanes[i], y = b.lanes[i];                           \
+        r.lanes[i] = (expr);                                            \
+    }                                                                   \
+    return r;                                                           \
+}
+
+SIMD_SCALAR_OP(simd4f_add, x + y)
+SIMD_SCALAR_OP(simd4f_sub, x - y)
+SIMD_SCALAR_OP(simd4f_mul, x*y)
+SIMD_SCALAR_OP(simd4f_min, (x < y) ? x : y)
+SIMD_SCALAR_OP(simd4f_max, (x > y) ? x : y)
+
+static inline float simd_scalar_mask(int condition)
+{
+    uint32_t bits = condition ? UINT32_MAX : 0;
+    float lane;
+
+    memcpy(&lane, &bits, sizeof(float));
+
+    return lane;
+}
+
+static inline uint32_t simd_scalar_bits(float lane)
+{
+    uint32_t bits;
+    memcpy(&bits, &lane, sizeof(float));
+
+    return bits;
+}
+
+SIMD_SCALAR_OP(simd4f_cmpge, simd_scalar_mask(x >= y))
+SIMD_SCALAR_OP(simd4f_cmple, simd_scalar_mask(x <= y))
+
+#undef SIMD_SCALAR_OP
+
+static inline simd4f_t simd4f_and(simd4f_t a, simd4f_t b)
+{
+    simd4f_t r;
+
+    for (int i = 0; i < 4; ++i) {
+        uint32_t bits = simd_scalar_bits(a.lanes[i]) & simd_scalar_bits(b.lanes[i]);
+        memcpy(r.lanes + i, &bits, sizeof(float));
+    }
+
+    return r;
+}
+
+static inline int simd4f_movemask(simd4f_t v)
+{
+    int mask = 0;
+
+    for (int i = 0; i < 4; ++i) {
+        mask |= (simd_scalar_bits(v.lanes[i]) >> 31) << i;
+    }
+
+    return mask;
+}
+
+// a*b + c
+static inline simd4f_t simd4f_madd(simd4f_t a, simd4f_t b, simd4f_t c)
+{
+    return simd4f_add(simd4f_mul(a, b), c);
+}
+
+#define simd4f_splat(v, lane) simd4f_set1((v).lanes[lane])
+
+#define simd4f_transpose(r0, r1, r2, r3) do {                              \
+    simd4f_t t0 = (r0), t1 = (r1), t2 = (r2), t3 = (r3);                   \
+    (r0) = simd4f_set(t0.lanes[0], t1.lanes[0], t2.lanes[0], t3.lanes[0]); \
+    (r1) = simd4f_set(t0.lanes[1], t1.lanes[1], t2.lanes[1], t3.lanes[1]); \
+    (r2) = simd4f_set(t0.lanes[2], t1.lanes[2], t2.lanes[2], t3.lanes[2]); \
+    (r3) = simd4f_set(t0.lanes[3], t1.lanes[3], t2.lanes[3], t3.lanes[3]); \
+} while (0)
+
+#endif
+
+#endif // SIMD_H
\ No newline at end of file
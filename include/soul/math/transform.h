@@ -2,11 +2,12 @@
 #define TRANSFORM_H
 
 #include "vector.h"
+#include "quaternion.h"
 
 struct transform
 {
     struct vec3f position;
-    struct vec3f rotation;
+    struct quat  rotation;
     struct vec3f scale;
 };
 
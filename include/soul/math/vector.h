@@ -9,7 +9,7 @@ struct vec4f
     float y;
     float z;
     float w;
-} __attribute__((packed));
+} __attribute__((aligned(16)));
 
 #define vec4f(x, y, z, w) ((struct vec4f){ (x), (y), (z), (w) })
 
@@ -23,7 +23,7 @@ struct vec3f
     float x;
     float y;
     float z;
-} __attribute__((packed));
+};
 
 #define vec3f(x, y, z) ((struct vec3f){ (x), (y), (z) })
 
@@ -49,7 +49,7 @@ struct vec2f
 {
     float x;
     float y;
-} __attribute__((packed));
+};
 
 #define vec2f(x, y) ((struct vec2f){ (x), (y) })
 
@@ -60,7 +60,7 @@ struct vec2i
 {
     int x;
     int y;
-} __attribute__((packed));
+};
 
 #define vec2i(x, y) ((struct vec2i){ (x), (y) })
 
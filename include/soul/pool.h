@@ -0,0 +1,41 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+
+#include "typedefs.h"
+
+#define POOL_ALIGNMENT 16
+
+#define POOL_DEFAULT_CHUNK_BLOCKS 256
+#define POOL_MAX_CHUNK_BLOCKS 4096
+
+struct pool_chunk
+{
+    struct pool_chunk * next;
+    size_t              block_count;
+};
+
+/*
+ * Fixed size blocks carved out of larger chunks. Blocks are zeroed on allocation and aligned
+ * to POOL_ALIGNMENT, and freed blocks are reused before a new chunk is made. Chunks double in
+ * size up to POOL_MAX_CHUNK_BLOCKS, so small pools stay small.
+ */
+struct pool
+{
+    size_t              block_size;
+    size_t              chunk_blocks;
+    struct pool_chunk * chunks;
+    void *              free_head;
+    size_t              free_count;
+    size_t              used_count;
+    size_t              reserved_bytes;
+};
+
+void    pool_init(struct pool *pool, size_t block_size, size_t chunk_blocks);
+void    pool_destroy(struct pool *pool);
+void    pool_reserve(struct pool *pool, size_t count);
+void *  pool_alloc(struct pool *pool);
+void    pool_free(struct pool *pool, void *block);
+
+#endif // POOL_H
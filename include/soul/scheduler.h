@@ -0,0 +1,95 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "typedefs.h"
+#include "core.h"
+#include "list.h"
+#include "string.h"
+#include "ecs.h"
+#include "thread_pool.h"
+
+#define SCHEDULER_SERVICE "scheduler_service"
+
+typedef void(*system_t)(void *data);
+
+/*
+ * A unit of per frame work over the components it declares. Systems in the same phase run
+ * concurrently unless one writes a component type the other reads or writes, in which case
+ * the one registered first runs first. Main thread systems, such as those issuing GL calls,
+ * also keep their registration order relative to each other. Structural changes made from
+ * worker threads go through ecs command buffers.
+ */
+struct system
+{
+    struct string           name;
+    struct system_phase *   phase;
+    system_t                fn;
+    void *                  data;
+    bool_t                  main_thread;
+    struct list             reads; // struct string
+    struct list             writes; // struct string
+    uint64_t                read_mask; // by component type id, resolved when the phase is built
+    uint64_t                write_mask;
+};
+
+struct system_node
+{
+    struct system_phase *   phase;
+    struct system *         system;
+    int *                   dependents; // indices into the phase's nodes
+    int                     dependent_count;
+    int                     dependency_count;
+    int                     remaining;
+};
+
+/*
+ * Every system sharing an EXECUTION_ORDER_* value. The phase runs as a single ordered callback,
+ * and its dependency graph is rebuilt whenever a system is added or removed.
+ */
+struct system_phase
+{
+    struct scheduler_service *  scheduler;
+    int                         order;
+    struct list                 systems; // struct system
+    bool_t                      dirty;
+    struct system_node *        nodes;
+    int                         node_count;
+    int *                       dependents; // backing storage for every node's dependents
+    struct system_node **       main_queue;
+    int                         main_queue_head;
+    int                         main_queue_tail;
+    int                         finished;
+    pthread_mutex_t             mutex;
+    pthread_cond_t              main_ready;
+};
+
+struct scheduler_service
+{
+    struct soul_instance *          soul_instance;
+    struct ecs_service *            ecs;
+    struct thread_pool_service *    thread_pool;
+    struct list                     phases; // struct system_phase
+};
+
+struct system_registry_info
+{
+    const char *    name;
+    system_t        fn;
+    void *          data;
+    int             order;
+    const char **   reads;
+    int             read_count;
+    const char **   writes;
+    int             write_count;
+    bool_t          main_thread;
+};
+
+void            scheduler_service_create_resource(struct soul_instance *soul_instance);
+struct system * system_register(struct scheduler_service *scheduler,
+                                struct system_registry_info *info);
+void            system_unregister(struct scheduler_service *scheduler, struct system *system);
+
+#endif // SCHEDULER_H
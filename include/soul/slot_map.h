@@ -0,0 +1,61 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <stdint.h>
+
+#include "typedefs.h"
+
+/*
+ * Slot index in the low 32 bits, generation in the high 32. Generations start at one, so a
+ * zeroed handle never resolves.
+ */
+typedef uint64_t slot_handle_t;
+
+#define SLOT_HANDLE_NULL ((slot_handle_t)0)
+
+#define slot_handle(index, generation) \
+    ((slot_handle_t)(index) | ((slot_handle_t)(generation) << 32))
+
+#define slot_handle_index(handle)       ((uint32_t)(handle))
+#define slot_handle_generation(handle)  ((uint32_t)((handle) >> 32))
+
+#define SLOT_MAP_NO_FREE_SLOT UINT32_MAX
+
+struct slot_map
+{
+    size_t          data_size;
+    unsigned char * data;
+    uint32_t *      generations;
+    uint32_t *      next_free; // free list links, only meaningful for empty slots
+    uint32_t        free_head;
+    uint32_t        capacity;
+    uint32_t        count;
+};
+
+void            slot_map_init(struct slot_map *map, size_t data_size);
+void            slot_map_destroy(struct slot_map *map);
+void            slot_map_reserve(struct slot_map *map, uint32_t count);
+slot_handle_t   slot_map_alloc(struct slot_map *map, void **p_data);
+slot_handle_t   slot_map_insert(struct slot_map *map, void *data);
+bool_t          slot_map_remove(struct slot_map *map, slot_handle_t handle);
+
+/*
+ * Empty slots carry an even generation and live ones an odd generation, so a single compare
+ * checks both that the slot is in use and that the handle is not stale.
+ */
+static inline bool_t slot_map_valid(struct slot_map *map, slot_handle_t handle)
+{
+    uint32_t index = slot_handle_index(handle);
+
+    return index < map->capacity && map->generations[index] == slot_handle_generation(handle);
+}
+
+static inline void *slot_map_get(struct slot_map *map, slot_handle_t handle)
+{
+    if (!slot_map_valid(map, handle))
+        return 0;
+
+    return map->data + slot_handle_index(handle)*map->data_size;
+}
+
+#endif // SLOT_MAP_H
@@ -0,0 +1,138 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include <stdint.h>
+
+#include "math/vector.h"
+
+#include "typedefs.h"
+#include "core.h"
+#include "list.h"
+#include "string.h"
+
+#define SPATIAL_SERVICE "spatial_service"
+
+#define SPATIAL_ITEM_NULL -1
+
+#define SPATIAL_HASH_MIN_BUCKETS 1024
+
+#define SPATIAL_QUADTREE_MAX_DEPTH 10
+
+typedef int32_t spatial_item_t;
+
+enum spatial_index_type
+{
+    SPATIAL_INDEX_HASH,
+    SPATIAL_INDEX_QUADTREE
+};
+
+struct spatial_rect
+{
+    struct vec2f min;
+    struct vec2f max;
+};
+
+#define spatial_rect(min_x, min_y, max_x, max_y) \
+    ((struct spatial_rect){ vec2f((min_x), (min_y)), vec2f((max_x), (max_y)) })
+
+struct spatial_hit
+{
+    void *          data;
+    spatial_item_t  item;
+    float           distance; // along the ray, zero for other queries
+};
+
+/*
+ * Reusable storage for query results. Queries overwrite whatever the results held before, so
+ * one set of results can serve a query every frame without allocating.
+ */
+struct spatial_results
+{
+    struct spatial_hit *    hits;
+    int                     count;
+    int                     capacity;
+};
+
+/*
+ * Items are filed by the centre of their bounds. The hash files them into an unbounded grid of
+ * cell_size cells and pads queries by the largest half extent seen, which suits items of
+ * similar size. The quadtree is loose: each level is a grid twice as fine as the one above,
+ * and an item goes in the finest level whose cells are at least as big as the item, so mixed
+ * sizes stay cheap to query. Items centred outside the quadtree's world go in its root.
+ *
+ * Item bounds are kept as separate min and max arrays so queries covering most of the index
+ * can test every item four at a time instead of walking cells. Queries may run concurrently
+ * with each other, but not with changes to the index.
+ */
+struct spatial_index
+{
+    struct string           name;
+    enum spatial_index_type type;
+    float                   cell_size; // quadtree: size of the deepest level's nodes
+    float                   inverse_cell_size;
+    int                     item_count;
+    int                     item_capacity; // a multiple of four
+    int                     item_high; // one past the highest item ever handed out
+    spatial_item_t          free_head;
+    float *                 min_x; // by item, NaN while the item is free
+    float *                 min_y;
+    float *                 max_x;
+    float *                 max_y;
+    void **                 data;
+    int32_t *               cell_x;
+    int32_t *               cell_y;
+    int32_t *               slot; // index into heads, -1 while the item is free
+    spatial_item_t *        next; // free list link while the item is free
+    spatial_item_t *        prev;
+    spatial_item_t *        heads; // chain of items by hash bucket or quadtree node
+    int                     slot_count;
+    float                   max_extent; // hash only, largest half extent of any item inserted
+    struct spatial_rect     world; // quadtree only
+    int                     depth;
+    float                   world_size;
+    uint8_t *               level; // by item
+    int                     level_offsets[SPATIAL_QUADTREE_MAX_DEPTH + 1];
+    int                     level_counts[SPATIAL_QUADTREE_MAX_DEPTH + 1];
+};
+
+struct spatial_index_info
+{
+    const char *            name;
+    enum spatial_index_type type;
+    float                   cell_size; // quadtree: the smallest node size wanted
+    struct spatial_rect     world; // quadtree only
+};
+
+struct spatial_service
+{
+    struct list indices; // struct spatial_index
+};
+
+void                    spatial_service_create_resource(struct soul_instance *soul_instance);
+struct spatial_index *  spatial_index_create(struct spatial_service *service,
+                                             struct spatial_index_info *info);
+void                    spatial_index_destroy(struct spatial_service *service,
+                                              struct spatial_index *index);
+struct spatial_index *  spatial_get_index(struct spatial_service *service, const char *name);
+spatial_item_t          spatial_index_insert(struct spatial_index *index,
+                                             struct spatial_rect bounds,
+                                             void *data);
+void                    spatial_index_update(struct spatial_index *index,
+                                             spatial_item_t item,
+                                             struct spatial_rect bounds);
+void                    spatial_index_remove(struct spatial_index *index, spatial_item_t item);
+void                    spatial_index_query_rect(struct spatial_index *index,
+                                                 struct spatial_rect rect,
+                                                 struct spatial_results *results);
+void                    spatial_index_query_radius(struct spatial_index *index,
+                                                   struct vec2f centre,
+                                                   float radius,
+                                                   struct spatial_results *results);
+void                    spatial_index_query_ray(struct spatial_index *index,
+                                                struct vec2f origin,
+                                                struct vec2f direction,
+                                                float max_distance,
+                                                struct spatial_results *results);
+void                    spatial_results_destroy(struct spatial_results *results);
+
+#endif // SPATIAL_H
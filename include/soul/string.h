@@ -2,10 +2,13 @@
 #define STRING_H
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "typedefs.h"
 
+#define STRING_REPLACEMENT_CHARACTER 0xfffd
+
 struct string
 {
     char *  chars;
@@ -17,5 +20,6 @@ void            string_destroy(struct string string);
 void            string_set_chars(struct string *string, const char *chars);
 bool_t          string_eq(struct string a, struct string b);
 bool_t          string_eq_ptr(const char *a, const char *b);
+uint32_t        string_decode_utf8(const char *chars, size_t length, size_t *position);
 
 #endif // STRING_H
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+
+#include "typedefs.h"
+#include "core.h"
+
+#define THREAD_POOL_SERVICE "thread_pool_service"
+
+#define THREAD_POOL_MIN_JOB_CAPACITY 64
+
+// Used by thread_pool_parallel_for() when the chunk size given is not positive.
+#define THREAD_POOL_DEFAULT_CHUNK_SIZE 1024
+
+typedef void(*job_t)(void *data);
+
+// Handles items [begin, end) of a parallel_for, as chunk number chunk_index.
+typedef void(*range_job_t)(int begin, int end, int chunk_index, void *data);
+
+/*
+ * Counts the jobs submitted against it that have not finished yet. Zero initialize before use.
+ */
+struct job_group
+{
+    int pending;
+};
+
+struct job
+{
+    job_t               fn;
+    void *              data;
+    struct job_group *  group;
+};
+
+struct thread_pool_service
+{
+    pthread_t *         threads;
+    int                 thread_count;
+    struct job *        jobs; // ring buffer
+    int                 job_capacity;
+    int                 job_head;
+    int                 job_count;
+    pthread_mutex_t     mutex;
+    pthread_cond_t      job_available;
+    pthread_cond_t      job_finished;
+    bool_t              stopping;
+};
+
+void    thread_pool_service_create_resource(struct soul_instance *soul_instance);
+void    thread_pool_submit(struct thread_pool_service *pool,
+                           struct job_group *group,
+                           job_t fn,
+                           void *data);
+void    thread_pool_wait(struct thread_pool_service *pool, struct job_group *group);
+int     thread_pool_get_thread_count(struct thread_pool_service *pool);
+void    thread_pool_parallel_for(struct thread_pool_service *pool,
+                                 int count,
+                                 int chunk_size,
+                                 range_job_t fn,
+                                 void *data);
+
+#endif // THREAD_POOL_H
\ No newline at end of file
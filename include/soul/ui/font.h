@@ -4,39 +4,90 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include <stdint.h>
+
 #include "../typedefs.h"
 #include "../string.h"
 #include "../list.h"
+#include "../pool.h"
 #include "../core.h"
+#include "../file.h"
 #include "../math/vector.h"
 #include "../graphics/texture.h"
 
 #define FONT_SERVICE        "font_service"
 #define FONT_GLYPH_COUNT    128
 
+#define FONT_EXTENDED_MIN_CAPACITY 64
+
+// Drawn for code points missing from a font and all of its fallbacks.
+#define FONT_MISSING_GLYPH '?'
+
+// Height distance field glyphs are rasterised at, in pixels.
+#define FONT_SDF_REFERENCE_SIZE 64
+
+// Reference pixels the distance field reaches past a glyph's outline.
+#define FONT_SDF_SPREAD 8
+
+// Sizes below this are still drawn from bitmaps, which FreeType hints to the pixel grid.
+#define FONT_SDF_MIN_SIZE 20
+
+struct font_sdf;
+
 struct glyph
 {
     struct texture *texture;
+    struct vec4f    uv_rect; // x, y, width, height
     struct vec2i    size;
     struct vec2i    bearing;
     int             advance;
     int             draw_width;
 };
 
+// An empty slot has a null glyph.
+struct glyph_slot
+{
+    uint32_t        code;
+    struct glyph *  glyph;
+};
+
+/*
+ * ASCII glyphs are loaded with the set and looked up directly. Everything past them is loaded
+ * the first time it is asked for, trying the set's font and then its fallbacks, and is found
+ * through an open addressed table, so memory grows with the characters used rather than the
+ * range of code points.
+ */
 struct glyph_set
 {
-    struct glyph    glyphs[FONT_GLYPH_COUNT];
-    int             height;
-    int             line_height;
-    int             ascent;
-    int             descent;
+    struct glyph        glyphs[FONT_GLYPH_COUNT];
+    struct font *       font;
+    struct glyph_slot * extended; // by code point
+    uint32_t            extended_capacity;
+    uint32_t            extended_count;
+    struct pool         extended_glyphs; // struct glyph, which stay put as the table grows
+    int8_t *            kerning; // by left then right character, null if the font has no kerning
+    int                 height;
+    int                 line_height;
+    int                 ascent;
+    int                 descent;
+    bool_t              sdf;
+    int                 sdf_padding; // pixels a glyph's quad is grown by on each side
+    float               sdf_smoothing; // half the width of the edge, in distance field units
 };
 
+/*
+ * The font file stays mapped for the font's lifetime, and FreeType only opens a face from it
+ * once a glyph set has to be rasterised rather than read from the glyph cache.
+ */
 struct font
 {
-    struct string   name;
-    struct list     glyph_sets; // struct glyph_set
-    FT_Face         face;
+    struct string       name;
+    struct list         glyph_sets; // struct glyph_set
+    struct list         fallbacks; // struct font *, in the order they are tried
+    struct font_sdf *   sdf; // null unless enabled
+    struct file_mapping file;
+    uint64_t            hash; // of the file's contents, keying its cache files
+    FT_Face             face; // null until needed, use font_get_face()
 };
 
 struct font_service
@@ -44,14 +95,31 @@ struct font_service
     FT_Library              ft;
     struct texture_service *texture_service;
     struct string_map       fonts; // struct font
+    struct string           cache_directory; // empty when glyph sets are not cached
 };
 
+// Pixels to add to the advance of left when right follows it.
+static inline int font_get_kerning(struct glyph_set *set, uint32_t left, uint32_t right)
+{
+    if (!set->kerning || left >= FONT_GLYPH_COUNT || right >= FONT_GLYPH_COUNT)
+        return 0;
+
+    return set->kerning[left*FONT_GLYPH_COUNT + right];
+}
+
 void                font_service_create_resource(struct soul_instance *soul_instance);
 struct font *       font_load(struct font_service *service, const char *name);
 void                font_unload(struct font_service *service, struct font *font);
 struct glyph_set *  font_load_glyph_set(struct font_service *service,
                                         struct font *font,
                                         int height);
+struct glyph *      font_get_glyph(struct font_service *service,
+                                   struct glyph_set *set,
+                                   uint32_t code);
+void                font_add_fallback(struct font *font, struct font *fallback);
+void                font_enable_sdf(struct font_service *service, struct font *font);
+FT_Face             font_get_face(struct font_service *service, struct font *font);
+void                font_set_cache_directory(struct font_service *service, const char *path);
 
 void                deserialize_font(struct json_string *json,
                                      struct font **font,
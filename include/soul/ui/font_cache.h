@@ -0,0 +1,97 @@
+#ifndef FONT_CACHE_H
+#define FONT_CACHE_H
+
+#include <stdint.h>
+
+#include "../typedefs.h"
+#include "../file.h"
+#include "font.h"
+
+#define FONT_CACHE_DEFAULT_DIRECTORY "cache/fonts"
+
+#define FONT_CACHE_MAGIC 0x53474c46 // "FLGS" read as bytes
+
+// Bumped whenever the layout or the way glyphs are rasterised changes.
+#define FONT_CACHE_VERSION 1
+
+/*
+ * A cache file is this header, then a struct font_cache_glyph for each ASCII character, then the
+ * kerning table if there is one, then every glyph's pixels. Bitmap glyph sets store their
+ * metrics in pixels, while a font's distance fields store its vertical metrics in font units.
+ */
+struct font_cache_header
+{
+    uint32_t    magic;
+    uint32_t    version;
+    uint64_t    font_hash; // of the font file's contents
+    int32_t     height;
+    int32_t     sdf_spread; // zero for bitmap glyphs
+    int32_t     glyph_count;
+    int32_t     line_height;
+    int32_t     ascent;
+    int32_t     descent;
+    int32_t     units_per_em;
+    int32_t     has_kerning;
+    uint64_t    pixel_offset; // from the start of the file
+    uint64_t    size; // of the whole file, to catch ones cut short
+};
+
+struct font_cache_glyph
+{
+    int32_t     loaded; // false if FreeType failed on the glyph
+    int32_t     width; // of the outline's bitmap
+    int32_t     height;
+    int32_t     bearing_x;
+    int32_t     bearing_y;
+    float       advance;
+    int32_t     pixel_width; // of the stored image, zero when there is none
+    int32_t     pixel_height;
+    uint64_t    pixel_offset; // from the header's pixel offset
+};
+
+// A cache file mapped into memory, pointing into the mapping.
+struct font_cache
+{
+    struct file_mapping         file;
+    struct font_cache_header *  header;
+    struct font_cache_glyph *   glyphs; // by character
+    int16_t *                   kerning; // by left then right character, or null
+    unsigned char *             pixels;
+};
+
+// Gathers a cache file's contents as glyphs are rasterised.
+struct font_cache_writer
+{
+    struct string               path;
+    struct font_cache_header    header;
+    struct font_cache_glyph     glyphs[FONT_GLYPH_COUNT];
+    int16_t *                   kerning;
+    unsigned char *             pixels;
+    size_t                      pixel_size;
+    size_t                      pixel_capacity;
+};
+
+uint64_t                    font_cache_hash(const void *data, size_t size);
+bool_t                      font_cache_open(struct font_service *service,
+                                            struct font *font,
+                                            int height,
+                                            int sdf_spread,
+                                            struct font_cache *cache);
+void                        font_cache_close(struct font_cache *cache);
+struct font_cache_writer *  font_cache_writer_create(struct font_service *service,
+                                                     struct font *font,
+                                                     int height,
+                                                     int sdf_spread);
+void                        font_cache_writer_add_glyph(struct font_cache_writer *writer,
+                                                        int code,
+                                                        struct font_cache_glyph *glyph,
+                                                        const unsigned char *pixels,
+                                                        int pitch);
+void                        font_cache_writer_set_kerning(struct font_cache_writer *writer,
+                                                          int left,
+                                                          int right,
+                                                          int kerning);
+void                        font_cache_writer_save(struct font_cache_writer *writer);
+void                        font_cache_writer_destroy(struct font_cache_writer *writer);
+
+#endif // FONT_CACHE_H
@@ -0,0 +1,49 @@
+#ifndef FONT_SDF_H
+#define FONT_SDF_H
+
+#include <stdint.h>
+
+#include "../typedefs.h"
+#include "../string_map.h"
+#include "../math/vector.h"
+#include "../graphics/texture_atlas.h"
+#include "font.h"
+
+// A glyph at the reference size, padded by the spread on every side.
+struct sdf_glyph
+{
+    struct texture_region * region; // null for glyphs with nothing to draw
+    struct vec2i            size; // of the outline's bitmap, without padding
+    struct vec2i            bearing;
+    float                   advance;
+};
+
+/*
+ * A font's glyphs rasterised once at FONT_SDF_REFERENCE_SIZE as distance fields into a single
+ * channel atlas, which the UI shader thresholds at any size. Glyph sets drawn from it only
+ * scale metrics, so adding a size costs no rasterising and no textures. The ASCII glyphs are
+ * rasterised up front, or read from the glyph cache.
+ */
+struct font_sdf
+{
+    struct texture_atlas *  atlas;
+    struct string_map       glyphs; // struct sdf_glyph, by code point in decimal
+    int16_t *               kerning; // in font units by left then right character, or null
+    int                     units_per_em;
+    int                     line_height; // in font units
+    int                     ascent;
+    int                     descent;
+};
+
+struct font_sdf *   font_sdf_create(struct font_service *service, struct font *font);
+void                font_sdf_destroy(struct font_service *service, struct font_sdf *sdf);
+void                font_sdf_load_glyph_set(struct font_service *service,
+                                            struct font *font,
+                                            struct glyph_set *set);
+bool_t              font_sdf_load_glyph(struct font_service *service,
+                                        struct glyph_set *set,
+                                        struct font *source,
+                                        struct glyph *destination,
+                                        uint32_t code);
+
+#endif // FONT_SDF_H
@@ -15,6 +15,7 @@ struct ui_canvas
 {
     struct window *         window;
     struct ui_container *   root_container;
+    struct ui_container *   hovered;
     struct callback *       on_left_click_handle;
     struct callback *       on_window_resize_handle;
 };
@@ -13,6 +13,7 @@ struct ui_container;
 #include "ui_rect.h"
 #include "ui_margins.h"
 #include "ui_axis.h"
+#include "ui_hit_test.h"
 #include "user_input.h"
 
 #define UI_CONTAINER "ui_container"
@@ -49,30 +50,39 @@ struct ui_container
     bool_t                  contains_text;
     struct font *           text_font;
 
-    struct vec4f            hover_colour;
-    float                   hover_timer;
+    struct vec4f            hover_colour; // zero for none
+    float                   hover_timer; // seconds into the transition towards hover_colour
     float                   hover_transition_time;
+    bool_t                  hovered;
+    bool_t                  hover_active; // in the hover state's active set
 
     bool_t                  ignore_mouse_test;
 
+    uint32_t                layout_generation; // bumped on the root whenever the tree is laid out
+    struct ui_hit_test *    hit_test; // roots only, built on the first mouse test
+
     struct list             on_left_click; // struct callback, struct ui_container *
     struct list             on_resize; // struct callback, struct ui_container *
     struct list             on_move; // struct callback, struct ui_container *
 };
 
-void    ui_container_register_component(struct soul_instance *soul_instance);
-void    ui_container_set_rect(struct ui_container *container, struct ui_rect rect);
-void    ui_container_set_text(struct ui_container *container, const char *text);
-void    ui_container_set_text_font(struct font_service *font_service,
-                                   struct ui_container *container,
-                                   struct font *font,
-                                   int height);
-void    ui_container_draw(struct ui_container *container,
-                          struct ui_render_cache *render_cache,
-                          struct window *window);
-void    ui_container_calculate_children(struct ui_container *container);
-void    ui_container_set_layout(struct ui_container *container, ui_layout_t layout);
-void    ui_container_set_alignment(struct ui_container *container, ui_alignment_t alignment);
-bool_t  ui_container_test_mouse(struct ui_container *container, struct mouse_state *mouse);
+void                    ui_container_register_component(struct soul_instance *soul_instance);
+void                    ui_container_set_rect(struct ui_container *container, struct ui_rect rect);
+void                    ui_container_set_text(struct ui_container *container, const char *text);
+void                    ui_container_set_text_font(struct font_service *font_service,
+                                                   struct ui_container *container,
+                                                   struct font *font,
+                                                   int height);
+void                    ui_container_draw(struct ui_container *container,
+                                          struct ui_render_cache *render_cache);
+void                    ui_container_calculate_children(struct ui_container *container);
+void                    ui_container_set_layout(struct ui_container *container,
+                                                ui_layout_t layout);
+void                    ui_container_set_alignment(struct ui_container *container,
+                                                   ui_alignment_t alignment);
+void                    ui_container_mark_layout_changed(struct ui_container *container);
+struct ui_container *   ui_container_pick(struct ui_container *container, struct vec2i point);
+bool_t                  ui_container_test_mouse(struct ui_container *container,
+                                                struct mouse_state *mouse);
 
 #endif // UI_CONTAINER_H
\ No newline at end of file
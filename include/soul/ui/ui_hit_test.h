@@ -0,0 +1,53 @@
+#ifndef UI_HIT_TEST_H
+#define UI_HIT_TEST_H
+
+#include <stdint.h>
+
+#include "../typedefs.h"
+#include "../math/vector.h"
+
+struct ui_container;
+
+#define UI_HIT_TEST_CELL_SIZE 64
+
+// Cells per axis, past which cells are made bigger instead.
+#define UI_HIT_TEST_MAX_CELLS 128
+
+struct ui_hit_entry
+{
+    struct ui_container *   container;
+    int                     left; // bounds clipped by every ancestor's, inclusive
+    int                     top;
+    int                     right;
+    int                     bottom;
+    int                     depth; // below the root the test was built from
+};
+
+/*
+ * A container tree flattened in preorder, skipping containers that ignore the mouse along with
+ * their children. Each entry's bounds are cut down to its ancestors', as a point outside a
+ * parent never reaches its children. The root's bounds are split into a grid of cells listing
+ * the entries overlapping them, in preorder, so a query only looks at the entries in one cell.
+ */
+struct ui_hit_test
+{
+    uint32_t                generation; // root's layout generation when last built
+    bool_t                  built;
+    struct ui_hit_entry *   entries;
+    int                     entry_count;
+    int                     entry_capacity;
+    int *                   cell_starts; // into cell_entries, by cell, plus one past the end
+    int *                   cell_entries; // indices into entries
+    int                     cell_entry_capacity;
+    int                     cell_capacity;
+    struct vec2i            origin;
+    int                     cell_size;
+    int                     columns;
+    int                     rows;
+};
+
+void                    ui_hit_test_build(struct ui_hit_test *hit_test, struct ui_container *root);
+struct ui_container *   ui_hit_test_query(struct ui_hit_test *hit_test, struct vec2i point);
+void                    ui_hit_test_destroy(struct ui_hit_test *hit_test);
+
+#endif // UI_HIT_TEST_H
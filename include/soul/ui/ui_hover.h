@@ -0,0 +1,29 @@
+#ifndef UI_HOVER_H
+#define UI_HOVER_H
+
+#include "../core.h"
+#include "../list.h"
+#include "ui_container.h"
+
+#define UI_HOVER_STATE "ui_hover_state"
+
+#define UI_HOVER_MIN_ACTIVE_CAPACITY 16
+
+/*
+ * Once a frame, each canvas picks the container under its window's mouse. Only containers whose
+ * hover state just changed, or that are still part way through their transition, are kept in
+ * the active set and have their current colour moved along, so idle trees cost nothing.
+ */
+struct ui_hover_state
+{
+    struct list *           canvas_instances; // struct ui_canvas
+    struct ui_container **  active;
+    int                     active_count;
+    int                     active_capacity;
+    double                  last_time; // of the previous update, in seconds
+};
+
+void ui_hover_register_system(struct soul_instance *soul_instance, struct list *canvas_instances);
+void ui_hover_forget(struct ui_hover_state *state, struct ui_container *container);
+
+#endif // UI_HOVER_H
@@ -7,6 +7,11 @@
 #include "../graphics/mesh.h"
 #include "ui_rect.h"
 
+/*
+ * The UI shader samples the part of the bound texture given by uv_rect. When sdf is set, the
+ * texture's red channel is a distance field whose outline sits at 0.5, and coverage is taken
+ * as smoothstep(0.5 - sdf_smoothing, 0.5 + sdf_smoothing, distance).
+ */
 struct ui_render_cache
 {
     struct list *   canvas_instances; // struct ui_canvas
@@ -16,8 +21,15 @@ struct ui_render_cache
     uniform_t       colour_uniform;
     uniform_t       use_texture_uniform;
     uniform_t       is_text_uniform;
+    uniform_t       uv_rect_uniform;
+    uniform_t       sdf_uniform;
+    uniform_t       sdf_smoothing_uniform;
+    struct mat4x4   view_matrix; // of the canvas being drawn
 };
 
-struct mat4x4 ui_render_calculate_matrix(struct ui_rect *rect, int depth, struct window *window);
+struct mat4x4 ui_render_calculate_view(struct window *window);
+struct mat4x4 ui_render_calculate_matrix(struct ui_rect *rect,
+                                         int depth,
+                                         struct mat4x4 *view_matrix);
 
 #endif // UI_RENDER_CACHE_H
\ No newline at end of file
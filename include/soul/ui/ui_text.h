@@ -6,33 +6,60 @@
 #include "font.h"
 #include "ui_render.h"
 
+// Layouts for this many maximum widths are kept per text.
+#define UI_TEXT_LAYOUT_CACHE_SIZE 2
+
 struct ui_character
 {
     bool_t          whitespace;
     bool_t          is_tab;
     bool_t          new_line;
+    uint32_t        code;
     struct glyph *  glyph;
     struct vec2i    position;
     struct ui_rect  absolute_rect;
 };
 
+struct ui_text_row
+{
+    int width;
+    int end; // one past the row's last character
+};
+
+/*
+ * Line breaks and kerned positions of a text laid out within a maximum width, kept until the
+ * string or glyph set changes so measuring and positioning share one pass.
+ */
+struct ui_text_layout
+{
+    bool_t                  valid;
+    int                     max_width;
+    uint32_t                last_used;
+    struct ui_text_row *    rows;
+    int                     row_count;
+    int                     row_capacity;
+    int                     width; // of the widest row
+    int *                   offsets; // by character, from the start of its row
+    int                     offset_capacity;
+};
+
 struct ui_text
 {
     struct string           string;
+    struct font_service *   font_service;
     struct font *           font;
     struct glyph_set *      glyph_set;
     struct ui_character *   characters;
     int                     character_count;
+    struct ui_text_layout   layouts[UI_TEXT_LAYOUT_CACHE_SIZE];
+    uint32_t                layout_clock;
 };
 
 struct ui_container;
 
 void    ui_text_init(struct ui_text *text);
 void    ui_text_destroy(struct ui_text *text);
-void    ui_text_draw(struct ui_text *text,
-                     int depth,
-                     struct ui_render_cache *render_cache,
-                     struct window *window);
+void    ui_text_draw(struct ui_text *text, int depth, struct ui_render_cache *render_cache);
 void    ui_text_set_string(struct ui_text *text, const char *string);
 void    ui_text_set_font(struct font_service *service,
                          struct ui_text *text,
@@ -0,0 +1,188 @@
+#include <soul/math/affine.h>
+#include <soul/math/quaternion.h>
+#include <soul/math/simd.h>
+
+void affine_compose(struct transform *transform, struct affine3x4 *result)
+{
+    float r[12] __attribute__((aligned(16)));
+    quat_to_rotation_rows(transform->rotation, r);
+
+    struct vec3f p = transform->position;
+    simd4f_t scale = simd4f_set(transform->scale.x, transform->scale.y, transform->scale.z, 1);
+
+    float *rows = &result->m00;
+
+    simd4f_store(rows, simd4f_madd(simd4f_load(r), scale, simd4f_set(0, 0, 0, p.x)));
+    simd4f_store(rows + 4, simd4f_madd(simd4f_load(r + 4), scale, simd4f_set(0, 0, 0, p.y)));
+    simd4f_store(rows + 8, simd4f_madd(simd4f_load(r + 8), scale, simd4f_set(0, 0, 0, p.z)));
+}
+
+void affine_compose_batch(struct transform **transforms, struct affine3x4 *results, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        affine_compose(transforms[i], results + i);
+    }
+}
+
+struct affine3x4 affine_mul(struct affine3x4 *a, struct affine3x4 *b)
+{
+    struct affine3x4 r;
+
+    float *a_rows = &a->m00;
+    float *b_rows = &b->m00;
+    float *r_rows = &r.m00;
+
+    simd4f_t b0 = simd4f_load(b_rows);
+    simd4f_t b1 = simd4f_load(b_rows + 4);
+    simd4f_t b2 = simd4f_load(b_rows + 8);
+
+    for (int i = 0; i < 3; ++i) {
+        float *row = a_rows + i*4;
+
+        // The implicit last row of b only contributes a's own translation.
+        simd4f_t result = simd4f_set(0, 0, 0, row[3]);
+        result = simd4f_madd(simd4f_set1(row[0]), b0, result);
+        result = simd4f_madd(simd4f_set1(row[1]), b1, result);
+        result = simd4f_madd(simd4f_set1(row[2]), b2, result);
+
+        simd4f_store(r_rows + i*4, result);
+    }
+
+    return r;
+}
+
+static void set_inverse_translation(struct affine3x4 *inverse, struct affine3x4 *a)
+{
+    float x = a->m03, y = a->m07, z = a->m11;
+
+    inverse->m03 = -(inverse->m00*x + inverse->m01*y + inverse->m02*z);
+    inverse->m07 = -(inverse->m04*x + inverse->m05*y + inverse->m06*z);
+    inverse->m11 = -(inverse->m08*x + inverse->m09*y + inverse->m10*z);
+}
+
+/*
+ * Inverts the 3x3 part through its adjugate, then moves the translation back through it.
+ * Returns FALSE and leaves result untouched when the matrix is singular.
+ */
+bool_t affine_inverse(struct affine3x4 *a, struct affine3x4 *result)
+{
+    float c00 = a->m05*a->m10 - a->m06*a->m09;
+    float c01 = a->m06*a->m08 - a->m04*a->m10;
+    float c02 = a->m04*a->m09 - a->m05*a->m08;
+
+    float determinant = a->m00*c00 + a->m01*c01 + a->m02*c02;
+
+    if (determinant == 0)
+        return FALSE;
+
+    float d = 1/determinant;
+
+    struct affine3x4 r = {
+        c00*d,
+        (a->m02*a->m09 - a->m01*a->m10)*d,
+        (a->m01*a->m06 - a->m02*a->m05)*d,
+        0,
+
+        c01*d,
+        (a->m00*a->m10 - a->m02*a->m08)*d,
+        (a->m02*a->m04 - a->m00*a->m06)*d,
+        0,
+
+        c02*d,
+        (a->m01*a->m08 - a->m00*a->m09)*d,
+        (a->m00*a->m05 - a->m01*a->m04)*d,
+        0
+    };
+
+    set_inverse_translation(&r, a);
+
+    *result = r;
+
+    return TRUE;
+}
+
+/*
+ * For rotation and scale without shear, which is everything affine_compose() builds. The
+ * columns are then orthogonal, so the inverse is each column divided by its squared length,
+ * laid out as a row. Scale must not be zero.
+ */
+struct affine3x4 affine_inverse_orthogonal(struct affine3x4 *a)
+{
+    float x = 1/(a->m00*a->m00 + a->m04*a->m04 + a->m08*a->m08);
+    float y = 1/(a->m01*a->m01 + a->m05*a->m05 + a->m09*a->m09);
+    float z = 1/(a->m02*a->m02 + a->m06*a->m06 + a->m10*a->m10);
+
+    struct affine3x4 r = {
+        a->m00*x, a->m04*x, a->m08*x, 0,
+        a->m01*y, a->m05*y, a->m09*y, 0,
+        a->m02*z, a->m06*z, a->m10*z, 0
+    };
+
+    set_inverse_translation(&r, a);
+
+    return r;
+}
+
+// points and results may be the same array.
+void affine_transform_points(struct affine3x4 *a,
+                             struct vec3f *points,
+                             struct vec3f *results,
+                             int count)
+{
+    simd4f_t c0 = simd4f_set(a->m00, a->m04, a->m08, 0);
+    simd4f_t c1 = simd4f_set(a->m01, a->m05, a->m09, 0);
+    simd4f_t c2 = simd4f_set(a->m02, a->m06, a->m10, 0);
+    simd4f_t c3 = simd4f_set(a->m03, a->m07, a->m11, 0);
+
+    float result[4] __attribute__((aligned(16)));
+
+    for (int i = 0; i < count; ++i) {
+        struct vec3f point = points[i];
+
+        simd4f_t r = simd4f_madd(simd4f_set1(point.x), c0, c3);
+        r = simd4f_madd(simd4f_set1(point.y), c1, r);
+        r = simd4f_madd(simd4f_set1(point.z), c2, r);
+
+        simd4f_store(result, r);
+
+        results[i] = vec3f(result[0], result[1], result[2]);
+    }
+}
+
+struct mat4x4 affine_to_mat4x4(struct affine3x4 *a)
+{
+    struct mat4x4 r;
+
+    simd4f_store(&r.m00, simd4f_load(&a->m00));
+    simd4f_store(&r.m04, simd4f_load(&a->m04));
+    simd4f_store(&r.m08, simd4f_load(&a->m08));
+    simd4f_store(&r.m12, simd4f_set(0, 0, 0, 1));
+
+    return r;
+}
+
+// m*a, with a's implicit last row folded in.
+struct mat4x4 mat4x4_mul_affine(struct mat4x4 *m, struct affine3x4 *a)
+{
+    struct mat4x4 r;
+
+    float *m_rows = &m->m00;
+    float *r_rows = &r.m00;
+
+    simd4f_t a0 = simd4f_load(&a->m00);
+    simd4f_t a1 = simd4f_load(&a->m04);
+    simd4f_t a2 = simd4f_load(&a->m08);
+
+    for (int i = 0; i < 4; ++i) {
+        float *row = m_rows + i*4;
+
+        simd4f_t result = simd4f_set(0, 0, 0, row[3]);
+        result = simd4f_madd(simd4f_set1(row[0]), a0, result);
+        result = simd4f_madd(simd4f_set1(row[1]), a1, result);
+        result = simd4f_madd(simd4f_set1(row[2]), a2, result);
+
+        simd4f_store(r_rows + i*4, result);
+    }
+
+    return r;
+}
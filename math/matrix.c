@@ -1,34 +1,171 @@
 #include <math.h>
 
 #include <soul/math/matrix.h>
+#include <soul/math/affine.h>
+#include <soul/math/simd.h>
 
+/*
+ * Rows are 16 byte aligned, so each result row is the rows of b weighted by the matching row
+ * of a, four lanes at a time.
+ */
 struct mat4x4 mul4x4(struct mat4x4 *a, struct mat4x4 *b)
 {
     struct mat4x4 r;
 
-    r.m00 = a->m00*b->m00 + a->m01*b->m04 + a->m02*b->m08 + a->m03*b->m12;
-    r.m01 = a->m00*b->m01 + a->m01*b->m05 + a->m02*b->m09 + a->m03*b->m13;
-    r.m02 = a->m00*b->m02 + a->m01*b->m06 + a->m02*b->m10 + a->m03*b->m14;
-    r.m03 = a->m00*b->m03 + a->m01*b->m07 + a->m02*b->m11 + a->m03*b->m15;
+    float *a_rows = &a->m00;
+    float *b_rows = &b->m00;
+    float *r_rows = &r.m00;
 
-    r.m04 = a->m04*b->m00 + a->m05*b->m04 + a->m06*b->m08 + a->m07*b->m12;
-    r.m05 = a->m04*b->m01 + a->m05*b->m05 + a->m06*b->m09 + a->m07*b->m13;
-    r.m06 = a->m04*b->m02 + a->m05*b->m06 + a->m06*b->m10 + a->m07*b->m14;
-    r.m07 = a->m04*b->m03 + a->m05*b->m07 + a->m06*b->m11 + a->m07*b->m15;
+    simd4f_t b0 = simd4f_load(b_rows);
+    simd4f_t b1 = simd4f_load(b_rows + 4);
+    simd4f_t b2 = simd4f_load(b_rows + 8);
+    simd4f_t b3 = simd4f_load(b_rows + 12);
 
-    r.m08 = a->m08*b->m00 + a->m09*b->m04 + a->m10*b->m08 + a->m11*b->m12;
-    r.m09 = a->m08*b->m01 + a->m09*b->m05 + a->m10*b->m09 + a->m11*b->m13;
-    r.m10 = a->m08*b->m02 + a->m09*b->m06 + a->m10*b->m10 + a->m11*b->m14;
-    r.m11 = a->m08*b->m03 + a->m09*b->m07 + a->m10*b->m11 + a->m11*b->m15;
+    for (int i = 0; i < 4; ++i) {
+        simd4f_t row = simd4f_load(a_rows + i*4);
 
-    r.m12 = a->m12*b->m00 + a->m13*b->m04 + a->m14*b->m08 + a->m15*b->m12;
-    r.m13 = a->m12*b->m01 + a->m13*b->m05 + a->m14*b->m09 + a->m15*b->m13;
-    r.m14 = a->m12*b->m02 + a->m13*b->m06 + a->m14*b->m10 + a->m15*b->m14;
-    r.m15 = a->m12*b->m03 + a->m13*b->m07 + a->m14*b->m11 + a->m15*b->m15;
+        simd4f_t result = simd4f_mul(simd4f_splat(row, 0), b0);
+        result = simd4f_madd(simd4f_splat(row, 1), b1, result);
+        result = simd4f_madd(simd4f_splat(row, 2), b2, result);
+        result = simd4f_madd(simd4f_splat(row, 3), b3, result);
+
+        simd4f_store(r_rows + i*4, result);
+    }
+
+    return r;
+}
+
+struct vec4f mat4x4_mul_vec4f(struct mat4x4 *m, struct vec4f v)
+{
+    struct vec4f r;
+
+    float *rows = &m->m00;
+    simd4f_t vector = simd4f_load(&v.x);
+
+    simd4f_t r0 = simd4f_mul(simd4f_load(rows), vector);
+    simd4f_t r1 = simd4f_mul(simd4f_load(rows + 4), vector);
+    simd4f_t r2 = simd4f_mul(simd4f_load(rows + 8), vector);
+    simd4f_t r3 = simd4f_mul(simd4f_load(rows + 12), vector);
+
+    // Transposing the products turns the four horizontal sums into three vertical adds.
+    simd4f_transpose(r0, r1, r2, r3);
+
+    simd4f_store(&r.x, simd4f_add(simd4f_add(r0, r1), simd4f_add(r2, r3)));
+
+    return r;
+}
+
+/*
+ * Treats every point as w = 1 and drops the resulting w, so it is only meant for affine
+ * matrices. points and results may be the same array.
+ */
+void mat4x4_transform_points(struct mat4x4 *m,
+                             struct vec3f *points,
+                             struct vec3f *results,
+                             int count)
+{
+    simd4f_t c0 = simd4f_set(m->m00, m->m04, m->m08, m->m12);
+    simd4f_t c1 = simd4f_set(m->m01, m->m05, m->m09, m->m13);
+    simd4f_t c2 = simd4f_set(m->m02, m->m06, m->m10, m->m14);
+    simd4f_t c3 = simd4f_set(m->m03, m->m07, m->m11, m->m15);
+
+    float result[4] __attribute__((aligned(16)));
+
+    for (int i = 0; i < count; ++i) {
+        struct vec3f point = points[i];
+
+        simd4f_t r = simd4f_madd(simd4f_set1(point.x), c0, c3);
+        r = simd4f_madd(simd4f_set1(point.y), c1, r);
+        r = simd4f_madd(simd4f_set1(point.z), c2, r);
+
+        simd4f_store(result, r);
+
+        results[i] = vec3f(result[0], result[1], result[2]);
+    }
+}
+
+struct mat4x4 mat4x4_transpose(struct mat4x4 *m)
+{
+    struct mat4x4 r;
+
+    float *rows = &m->m00;
+
+    simd4f_t r0 = simd4f_load(rows);
+    simd4f_t r1 = simd4f_load(rows + 4);
+    simd4f_t r2 = simd4f_load(rows + 8);
+    simd4f_t r3 = simd4f_load(rows + 12);
+
+    simd4f_transpose(r0, r1, r2, r3);
+
+    simd4f_store(&r.m00, r0);
+    simd4f_store(&r.m04, r1);
+    simd4f_store(&r.m08, r2);
+    simd4f_store(&r.m12, r3);
 
     return r;
 }
 
+/*
+ * Cofactor expansion sharing the twelve 2x2 determinants of the top and bottom row pairs.
+ * Returns FALSE and leaves result untouched when the matrix is singular.
+ */
+bool_t mat4x4_inverse(struct mat4x4 *m, struct mat4x4 *result)
+{
+    float *a = &m->m00;
+
+    float s0 = a[0]*a[5] - a[4]*a[1];
+    float s1 = a[0]*a[6] - a[4]*a[2];
+    float s2 = a[0]*a[7] - a[4]*a[3];
+    float s3 = a[1]*a[6] - a[5]*a[2];
+    float s4 = a[1]*a[7] - a[5]*a[3];
+    float s5 = a[2]*a[7] - a[6]*a[3];
+
+    float c5 = a[10]*a[15] - a[14]*a[11];
+    float c4 = a[9]*a[15] - a[13]*a[11];
+    float c3 = a[9]*a[14] - a[13]*a[10];
+    float c2 = a[8]*a[15] - a[12]*a[11];
+    float c1 = a[8]*a[14] - a[12]*a[10];
+    float c0 = a[8]*a[13] - a[12]*a[9];
+
+    float determinant = s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+
+    if (determinant == 0)
+        return FALSE;
+
+    struct mat4x4 r = mat4x4(
+        a[5]*c5 - a[6]*c4 + a[7]*c3,
+        -a[1]*c5 + a[2]*c4 - a[3]*c3,
+        a[13]*s5 - a[14]*s4 + a[15]*s3,
+        -a[9]*s5 + a[10]*s4 - a[11]*s3,
+
+        -a[4]*c5 + a[6]*c2 - a[7]*c1,
+        a[0]*c5 - a[2]*c2 + a[3]*c1,
+        -a[12]*s5 + a[14]*s2 - a[15]*s1,
+        a[8]*s5 - a[10]*s2 + a[11]*s1,
+
+        a[4]*c4 - a[5]*c2 + a[7]*c0,
+        -a[0]*c4 + a[1]*c2 - a[3]*c0,
+        a[12]*s4 - a[13]*s2 + a[15]*s0,
+        -a[8]*s4 + a[9]*s2 - a[11]*s0,
+
+        -a[4]*c3 + a[5]*c1 - a[6]*c0,
+        a[0]*c3 - a[1]*c1 + a[2]*c0,
+        -a[12]*s3 + a[13]*s1 - a[14]*s0,
+        a[8]*s3 - a[9]*s1 + a[10]*s0
+    );
+
+    simd4f_t scale = simd4f_set1(1/determinant);
+    float *rows = &r.m00;
+
+    for (int i = 0; i < 16; i += 4) {
+        simd4f_store(rows + i, simd4f_mul(simd4f_load(rows + i), scale));
+    }
+
+    *result = r;
+
+    return TRUE;
+}
+
 void mat4x4_set_pos(struct mat4x4 *m, struct vec3f pos)
 {
     m->m03 = pos.x;
@@ -43,34 +180,52 @@ void mat4x4_set_scale(struct mat4x4 *m, struct vec3f scale)
     m->m10 = scale.z;
 }
 
-void mat4x4_set_rot(struct mat4x4 *m, struct vec3f rot)
+// Rz*Rx*Ry written out, so each angle costs one sin and one cos.
+static void euler_rotation(struct vec3f rot, float r[12])
 {
-    struct mat4x4 tmp;
-
-    tmp = mat4x4(
-        cos(rot.y), 0, sin(rot.y), 0,
-        0, 1, 0, 0,
-        -sin(rot.y), 0, cos(rot.y), 0,
-        0, 0, 0, 1
-    );
+    float sx = sin(rot.x), cx = cos(rot.x);
+    float sy = sin(rot.y), cy = cos(rot.y);
+    float sz = sin(rot.z), cz = cos(rot.z);
+
+    r[0]    = cz*cy + sz*sx*sy;
+    r[1]    = -sz*cx;
+    r[2]    = cz*sy - sz*sx*cy;
+    r[3]    = 0;
+
+    r[4]    = sz*cy - cz*sx*sy;
+    r[5]    = cz*cx;
+    r[6]    = sz*sy + cz*sx*cy;
+    r[7]    = 0;
+
+    r[8]    = -cx*sy;
+    r[9]    = -sx;
+    r[10]   = cx*cy;
+    r[11]   = 0;
+}
 
-    *m = mul4x4(&tmp, m);
+void mat4x4_set_rot(struct mat4x4 *m, struct vec3f rot)
+{
+    float r[12];
+    euler_rotation(rot, r);
 
-    tmp = mat4x4(
-        1, 0, 0, 0,
-        0, cos(rot.x), sin(rot.x), 0,
-        0, -sin(rot.x), cos(rot.x), 0,
+    struct mat4x4 rotation = mat4x4(
+        r[0], r[1], r[2], 0,
+        r[4], r[5], r[6], 0,
+        r[8], r[9], r[10], 0,
         0, 0, 0, 1
     );
 
-    *m = mul4x4(&tmp, m);
+    *m = mul4x4(&rotation, m);
+}
 
-    tmp = mat4x4(
-        cos(rot.z), -sin(rot.z), 0, 0,
-        sin(rot.z), cos(rot.z), 0, 0,
-        0, 0, 1, 0,
-        0, 0, 0, 1
-    );
+/*
+ * Translation * rotation * scale in a single pass, the same matrix mat4x4_set_pos(),
+ * mat4x4_set_rot() and mat4x4_set_scale() would build.
+ */
+struct mat4x4 mat4x4_compose(struct transform *transform)
+{
+    struct affine3x4 affine;
+    affine_compose(transform, &affine);
 
-    *m = mul4x4(&tmp, m);
-}
\ No newline at end of file
+    return affine_to_mat4x4(&affine);
+}
@@ -0,0 +1,91 @@
+#include <math.h>
+
+#include <soul/math/quaternion.h>
+
+struct quat quat_from_axis_angle(struct vec3f axis, float angle)
+{
+    float s = sin(angle*0.5);
+
+    return quat(axis.x*s, axis.y*s, axis.z*s, cos(angle*0.5));
+}
+
+/*
+ * Same rotation as mat4x4_set_rot(), which applies y, then x (clockwise), then z.
+ */
+struct quat quat_from_euler(struct vec3f rot)
+{
+    struct quat y = quat_from_axis_angle(vec3f(0, 1, 0), rot.y);
+    struct quat x = quat_from_axis_angle(vec3f(1, 0, 0), -rot.x);
+    struct quat z = quat_from_axis_angle(vec3f(0, 0, 1), rot.z);
+
+    struct quat zx = quat_mul(z, x);
+
+    return quat_mul(zx, y);
+}
+
+struct quat quat_mul(struct quat a, struct quat b)
+{
+    return quat(
+        a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
+        a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x,
+        a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w,
+        a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z
+    );
+}
+
+struct quat quat_normalize(struct quat q)
+{
+    float length = sqrt(q.x*q.x + q.y*q.y + q.z*q.z + q.w*q.w);
+
+    if (length == 0)
+        return QUAT_IDENTITY;
+
+    return quat(q.x/length, q.y/length, q.z/length, q.w/length);
+}
+
+struct quat quat_conjugate(struct quat q)
+{
+    return quat(-q.x, -q.y, -q.z, q.w);
+}
+
+struct vec3f quat_rotate_vec3f(struct quat q, struct vec3f v)
+{
+    // v + w*t + q.xyz x t, where t = 2*(q.xyz x v)
+    struct vec3f t = vec3f(
+        2*(q.y*v.z - q.z*v.y),
+        2*(q.z*v.x - q.x*v.z),
+        2*(q.x*v.y - q.y*v.x)
+    );
+
+    return vec3f(
+        v.x + q.w*t.x + q.y*t.z - q.z*t.y,
+        v.y + q.w*t.y + q.z*t.x - q.x*t.z,
+        v.z + q.w*t.z + q.x*t.y - q.y*t.x
+    );
+}
+
+/*
+ * Expects a unit quaternion. Rows are padded to four floats so they can be loaded straight
+ * into simd registers.
+ */
+void quat_to_rotation_rows(struct quat q, float rows[12])
+{
+    float xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+    float xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+    float wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+
+    rows[0]     = 1 - 2*(yy + zz);
+    rows[1]     = 2*(xy - wz);
+    rows[2]     = 2*(xz + wy);
+    rows[3]     = 0;
+
+    rows[4]     = 2*(xy + wz);
+    rows[5]     = 1 - 2*(xx + zz);
+    rows[6]     = 2*(yz - wx);
+    rows[7]     = 0;
+
+    rows[8]     = 2*(xz - wy);
+    rows[9]     = 2*(yz + wx);
+    rows[10]    = 1 - 2*(xx + yy);
+    rows[11]    = 0;
+}
@@ -1,35 +1,81 @@
 #include <stdio.h>
 
 #include <soul/debug.h>
+#include <soul/math/macros.h>
 #include <soul/ui/font.h>
+#include <soul/ui/font_sdf.h>
+#include <soul/ui/font_cache.h>
 
 static void unload_freetype(struct font_service *service)
 {
     FT_Done_FreeType(service->ft);
 }
 
+static bool_t is_extended(struct glyph_set *set, struct glyph *glyph)
+{
+    return glyph < set->glyphs || glyph >= set->glyphs + FONT_GLYPH_COUNT;
+}
+
+static void destroy_glyph_textures(struct font_service *service, struct glyph_set *set)
+{
+    for (int i = 0; i < FONT_GLYPH_COUNT; ++i) {
+        if (set->glyphs[i].texture)
+            texture_destroy(service->texture_service, set->glyphs[i].texture);
+    }
+
+    // Code points no font had point at the missing glyph, which is not the table's to free.
+    for (uint32_t i = 0; i < set->extended_capacity; ++i) {
+        struct glyph *glyph = set->extended[i].glyph;
+
+        if (glyph && is_extended(set, glyph) && glyph->texture)
+            texture_destroy(service->texture_service, glyph->texture);
+    }
+}
+
+static void cleanup_glyph_set(struct font_service *service, struct glyph_set *set)
+{
+    // Distance field glyphs point into the font's atlas.
+    if (service->texture_service && !set->sdf)
+        destroy_glyph_textures(service, set);
+
+    free(set->extended);
+    free(set->kerning);
+    pool_destroy(&set->extended_glyphs);
+}
+
 static void cleanup_font(struct font_service *service, struct font *font)
 {
     list_for_each (struct glyph_set, set, font->glyph_sets) {
-        for (int i = 0; i < FONT_GLYPH_COUNT; ++i) {
-            if (set->glyphs[i].texture)
-                texture_destroy(service->texture_service, set->glyphs[i].texture);
-        }
+        cleanup_glyph_set(service, set);
     }
 
     list_destroy(&font->glyph_sets);
+    list_destroy(&font->fallbacks);
+
+    if (font->sdf)
+        font_sdf_destroy(service, font->sdf);
+
+    if (font->face)
+        FT_Done_Face(font->face);
 
     string_destroy(font->name);
-    FT_Done_Face(font->face);
+    file_unmap(&font->file);
 }
 
 static void deallocate_service(struct font_service *service)
 {
+    /*
+     * The texture service is deallocated before this one and has already freed every texture
+     * and atlas, glyphs' included, so fonts only let go of their own memory.
+     */
+    service->texture_service = 0;
+
     list_for_each (struct font, font, service->fonts.values) {
         cleanup_font(service, font);
     }
 
     string_map_destroy(&service->fonts);
+    string_destroy(service->cache_directory);
 
     unload_freetype(service);
 }
@@ -61,18 +107,17 @@ void font_service_create_resource(struct soul_instance *soul_instance)
 
     string_map_init(&service->fonts, sizeof(struct font));
     service->texture_service = resource_get(soul_instance, TEXTURE_SERVICE);
+    service->cache_directory = string_create(FONT_CACHE_DEFAULT_DIRECTORY);
 }
 
 static struct font *load_new_font(struct font_service *service, const char *name)
 {
-    FT_Face face;
+    struct file_mapping file;
 
     char path[128];
     snprintf(path, 128, "/Windows/Fonts/%s", name);
 
-    FT_Error result = FT_New_Face(service->ft, path, 0, &face);
-
-    if (result) {
+    if (!file_map(path, &file)) {
         debug_log(
             SEVERITY_WARNING,
             "Failed to load font '%s'.\n",
@@ -85,8 +130,10 @@ static struct font *load_new_font(struct font_service *service, const char *name
     struct font *font = string_map_alloc(&service->fonts, name);
 
     font->name = string_create(name);
-    font->face = face;
+    font->file = file;
+    font->hash = font_cache_hash(file.data, file.size);
     list_init(&font->glyph_sets, sizeof(struct glyph_set));
+    list_init(&font->fallbacks, sizeof(struct font *));
 
     return font;
 }
@@ -107,14 +154,56 @@ void font_unload(struct font_service *service, struct font *font)
     string_map_remove(&service->fonts, font->name.chars);
 }
 
+/*
+ * Returns null if FreeType cannot read the font, in which case everything asked of the face is
+ * left empty.
+ */
+FT_Face font_get_face(struct font_service *service, struct font *font)
+{
+    if (font->face)
+        return font->face;
+
+    FT_Error result = FT_New_Memory_Face(
+        service->ft,
+        font->file.data,
+        font->file.size,
+        0,
+        &font->face
+    );
+
+    if (result) {
+        debug_log(
+            SEVERITY_WARNING,
+            "Failed to open font '%s'.\n",
+            font->name.chars
+        );
+
+        font->face = 0;
+    }
+
+    return font->face;
+}
+
+/*
+ * Glyph sets loaded from then on are read from and written to cache files in the directory,
+ * which is made if missing. A null path turns caching off.
+ */
+void font_set_cache_directory(struct font_service *service, const char *path)
+{
+    string_destroy(service->cache_directory);
+    service->cache_directory = string_create(path ? path : "");
+}
+
 static struct texture *load_glyph_texture(struct font_service *service,
-                                          FT_Bitmap *bitmap)
+                                          unsigned char *pixels,
+                                          int width,
+                                          int height)
 {
     struct texture_create_info texture_create_info = NEW_TEXTURE_CREATE_INFO;
     texture_create_info.channel_count       = 1;
-    texture_create_info.pixels              = bitmap->buffer;
-    texture_create_info.width               = bitmap->width;
-    texture_create_info.height              = bitmap->rows;
+    texture_create_info.pixels              = pixels;
+    texture_create_info.width               = width;
+    texture_create_info.height              = height;
     texture_create_info.generate_mip_maps   = FALSE;
     texture_create_info.no_memory_manage    = TRUE;
     texture_create_info.filter_mode         = TEXTURE_FILTERMODE_NEAREST;
@@ -122,34 +211,191 @@ static struct texture *load_glyph_texture(struct font_service *service,
     return texture_create(service->texture_service, &texture_create_info);
 }
 
-static void load_glyph(struct font_service *service,
-                       struct font *font,
-                       struct glyph_set *set,
-                       int c)
+// Expects the face to be set to the glyph set's size.
+static bool_t load_glyph(struct font_service *service,
+                         struct font *font,
+                         struct glyph *destination,
+                         uint32_t c,
+                         struct font_cache_writer *writer)
 {
     FT_Error r = FT_Load_Char(font->face, c, FT_LOAD_RENDER);
 
     if (r) {
         debug_log(
             SEVERITY_WARNING,
-            "Failed to load glyph '%d' from '%s'.\n",
+            "Failed to load glyph '%u' from '%s'.\n",
             c,
             font->name.chars
         );
 
-        return;
+        return FALSE;
     }
 
     FT_GlyphSlot glyph = font->face->glyph;
 
-    if (!glyph->bitmap.buffer)
+    FT_Bitmap *bitmap = &glyph->bitmap;
+
+    // Blank glyphs, such as spaces past ASCII, still advance the cursor.
+    if (bitmap->buffer) {
+        destination->texture = load_glyph_texture(
+            service,
+            bitmap->buffer,
+            bitmap->width,
+            bitmap->rows
+        );
+    }
+
+    destination->uv_rect    = vec4f(0, 0, 1, 1);
+    destination->size       = vec2i(bitmap->width, bitmap->rows);
+    destination->bearing    = vec2i(glyph->bitmap_left, glyph->bitmap_top);
+    destination->advance    = glyph->advance.x/64.0;
+    destination->draw_width = destination->bearing.x + destination->size.x;
+
+    struct font_cache_glyph cached = {
+        .loaded         = TRUE,
+        .width          = destination->size.x,
+        .height         = destination->size.y,
+        .bearing_x      = destination->bearing.x,
+        .bearing_y      = destination->bearing.y,
+        .advance        = destination->advance,
+        .pixel_width    = destination->size.x,
+        .pixel_height   = destination->size.y
+    };
+
+    font_cache_writer_add_glyph(writer, c, &cached, bitmap->buffer, bitmap->pitch);
+
+    return TRUE;
+}
+
+static void load_cached_glyph(struct font_service *service,
+                              struct font_cache *cache,
+                              struct glyph *destination,
+                              int c)
+{
+    struct font_cache_glyph *cached = cache->glyphs + c;
+
+    if (!cached->loaded)
+        return;
+
+    if (cached->pixel_width) {
+        destination->texture = load_glyph_texture(
+            service,
+            cache->pixels + cached->pixel_offset,
+            cached->pixel_width,
+            cached->pixel_height
+        );
+    }
+
+    destination->uv_rect    = vec4f(0, 0, 1, 1);
+    destination->size       = vec2i(cached->width, cached->height);
+    destination->bearing    = vec2i(cached->bearing_x, cached->bearing_y);
+    destination->advance    = cached->advance;
+    destination->draw_width = destination->bearing.x + destination->size.x;
+}
+
+/*
+ * Looked up once per glyph set rather than while laying out text, as FreeType walks the font's
+ * kerning table on every query.
+ */
+static void load_kerning(struct font *font,
+                         struct glyph_set *set,
+                         struct font_cache_writer *writer)
+{
+    if (!FT_HAS_KERNING(font->face))
+        return;
+
+    FT_UInt indices[FONT_GLYPH_COUNT];
+
+    for (int c = 0; c < FONT_GLYPH_COUNT; ++c) {
+        indices[c] = FT_Get_Char_Index(font->face, c);
+    }
+
+    set->kerning = calloc(FONT_GLYPH_COUNT*FONT_GLYPH_COUNT, sizeof(int8_t));
+
+    for (int left = 0; left < FONT_GLYPH_COUNT; ++left) {
+        if (!indices[left])
+            continue;
+
+        for (int right = 0; right < FONT_GLYPH_COUNT; ++right) {
+            if (!indices[right])
+                continue;
+
+            FT_Vector delta;
+
+            FT_Error result = FT_Get_Kerning(
+                font->face,
+                indices[left],
+                indices[right],
+                FT_KERNING_DEFAULT,
+                &delta
+            );
+
+            if (result)
+                continue;
+
+            int kerning = max(min(delta.x/64, INT8_MAX), INT8_MIN);
+
+            set->kerning[left*FONT_GLYPH_COUNT + right] = kerning;
+
+            if (kerning)
+                font_cache_writer_set_kerning(writer, left, right, kerning);
+        }
+    }
+}
+
+static void load_cached_glyph_set(struct font_service *service,
+                                  struct glyph_set *set,
+                                  struct font_cache *cache)
+{
+    set->line_height    = cache->header->line_height;
+    set->ascent         = cache->header->ascent;
+    set->descent        = cache->header->descent;
+
+    for (int c = 0; c < FONT_GLYPH_COUNT; ++c) {
+        load_cached_glyph(service, cache, set->glyphs + c, c);
+    }
+
+    if (!cache->kerning)
         return;
 
-    set->glyphs[c].texture      = load_glyph_texture(service, &glyph->bitmap);
-    set->glyphs[c].size         = vec2i(glyph->bitmap.width, glyph->bitmap.rows);
-    set->glyphs[c].bearing      = vec2i(glyph->bitmap_left, glyph->bitmap_top);
-    set->glyphs[c].advance      = glyph->advance.x/64.0;
-    set->glyphs[c].draw_width   = set->glyphs[c].bearing.x + set->glyphs[c].size.x;
+    set->kerning = calloc(FONT_GLYPH_COUNT*FONT_GLYPH_COUNT, sizeof(int8_t));
+
+    for (int i = 0; i < FONT_GLYPH_COUNT*FONT_GLYPH_COUNT; ++i) {
+        set->kerning[i] = cache->kerning[i];
+    }
+}
+
+static void rasterise_glyph_set(struct font_service *service,
+                                struct font *font,
+                                struct glyph_set *set)
+{
+    FT_Face face = font_get_face(service, font);
+
+    if (!face)
+        return;
+
+    struct font_cache_writer *writer = font_cache_writer_create(service, font, set->height, 0);
+
+    FT_Set_Pixel_Sizes(face, 0, set->height);
+
+    set->line_height    = face->size->metrics.height/64.0;
+    set->ascent         = face->size->metrics.ascender/64.0;
+    set->descent        = face->size->metrics.descender/64.0;
+
+    for (int c = 0; c < FONT_GLYPH_COUNT; ++c) {
+        load_glyph(service, font, set->glyphs + c, c, writer);
+    }
+
+    load_kerning(font, set, writer);
+
+    if (writer) {
+        writer->header.line_height  = set->line_height;
+        writer->header.ascent       = set->ascent;
+        writer->header.descent      = set->descent;
+    }
+
+    font_cache_writer_save(writer);
+    font_cache_writer_destroy(writer);
 }
 
 struct glyph_set *font_load_glyph_set(struct font_service *service,
@@ -158,20 +404,150 @@ struct glyph_set *font_load_glyph_set(struct font_service *service,
 {
     struct glyph_set *set = list_alloc(&font->glyph_sets);
 
-    FT_Set_Pixel_Sizes(font->face, 0, height);
+    set->font   = font;
+    set->height = height;
 
-    set->line_height    = font->face->size->metrics.height/64.0;
-    set->ascent         = font->face->size->metrics.ascender/64.0;
-    set->descent        = font->face->size->metrics.descender/64.0;
-    set->height         = height;
+    pool_init(&set->extended_glyphs, sizeof(struct glyph), 0);
 
-    for (int c = 0; c < FONT_GLYPH_COUNT; ++c) {
-        load_glyph(service, font, set, c);
+    if (font->sdf && height >= FONT_SDF_MIN_SIZE) {
+        font_sdf_load_glyph_set(service, font, set);
+        return set;
+    }
+
+    struct font_cache cache;
+
+    if (font_cache_open(service, font, height, 0, &cache)) {
+        load_cached_glyph_set(service, set, &cache);
+        font_cache_close(&cache);
+    } else {
+        rasterise_glyph_set(service, font, set);
     }
 
     return set;
 }
 
+static uint32_t hash_code(uint32_t code)
+{
+    return code*2654435761u;
+}
+
+static struct glyph_slot *find_slot(struct glyph_set *set, uint32_t code)
+{
+    uint32_t mask = set->extended_capacity - 1;
+    uint32_t i = hash_code(code) & mask;
+
+    while (set->extended[i].glyph && set->extended[i].code != code) {
+        i = (i + 1) & mask;
+    }
+
+    return set->extended + i;
+}
+
+static void grow_extended(struct glyph_set *set)
+{
+    struct glyph_slot *old = set->extended;
+    uint32_t old_capacity = set->extended_capacity;
+
+    set->extended_capacity  = max(old_capacity*2, FONT_EXTENDED_MIN_CAPACITY);
+    set->extended           = calloc(set->extended_capacity, sizeof(struct glyph_slot));
+
+    for (uint32_t i = 0; i < old_capacity; ++i) {
+        if (old[i].glyph)
+            *find_slot(set, old[i].code) = old[i];
+    }
+
+    free(old);
+}
+
+static bool_t has_character(struct font_service *service, struct font *font, uint32_t code)
+{
+    FT_Face face = font_get_face(service, font);
+
+    return face && FT_Get_Char_Index(face, code);
+}
+
+// Rasterises the code point from the first font in the chain that has it.
+static struct glyph *load_extended(struct font_service *service,
+                                   struct glyph_set *set,
+                                   uint32_t code)
+{
+    struct font *font = set->font;
+
+    if (!has_character(service, font, code)) {
+        font = 0;
+
+        list_for_each (struct font *, p_fallback, set->font->fallbacks) {
+            if (has_character(service, *p_fallback, code)) {
+                font = *p_fallback;
+                break;
+            }
+        }
+
+        if (!font)
+            return set->glyphs + FONT_MISSING_GLYPH;
+    }
+
+    struct glyph *glyph = pool_alloc(&set->extended_glyphs);
+    bool_t loaded;
+
+    if (set->sdf) {
+        loaded = font_sdf_load_glyph(service, set, font, glyph, code);
+    } else {
+        FT_Set_Pixel_Sizes(font->face, 0, set->height);
+        loaded = load_glyph(service, font, glyph, code, 0);
+    }
+
+    if (!loaded) {
+        pool_free(&set->extended_glyphs, glyph);
+        return set->glyphs + FONT_MISSING_GLYPH;
+    }
+
+    return glyph;
+}
+
+/*
+ * Code points missing from every font in the chain are remembered as the missing glyph, so
+ * they are only searched for once.
+ */
+struct glyph *font_get_glyph(struct font_service *service, struct glyph_set *set, uint32_t code)
+{
+    if (code < FONT_GLYPH_COUNT)
+        return set->glyphs + code;
+
+    if ((set->extended_count + 1)*2 > set->extended_capacity)
+        grow_extended(set);
+
+    struct glyph_slot *slot = find_slot(set, code);
+
+    if (!slot->glyph) {
+        slot->code  = code;
+        slot->glyph = load_extended(service, set, code);
+
+        ++set->extended_count;
+    }
+
+    return slot->glyph;
+}
+
+/*
+ * Characters the font lacks are taken from its fallbacks, tried in the order they were added.
+ * Fallbacks must stay loaded for as long as the font is.
+ */
+void font_add_fallback(struct font *font, struct font *fallback)
+{
+    list_push(&font->fallbacks, &fallback);
+}
+
+/*
+ * Sets of at least FONT_SDF_MIN_SIZE loaded from then on are drawn from distance fields shared
+ * by every size, rather than bitmaps rasterised for each. Fonts without outlines keep bitmaps.
+ */
+void font_enable_sdf(struct font_service *service, struct font *font)
+{
+    if (!font->sdf)
+        font->sdf = font_sdf_create(service, font);
+}
+
 void deserialize_font(struct json_string *json,
                       struct font **font,
                       struct font_service *font_service)
@@ -0,0 +1,316 @@
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <soul/debug.h>
+#include <soul/math/macros.h>
+#include <soul/ui/font_cache.h>
+
+#define CACHE_PATH_LENGTH 256
+
+// FNV-1a.
+uint64_t font_cache_hash(const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i])*1099511628211ull;
+    }
+
+    return hash;
+}
+
+static bool_t build_path(struct font_service *service,
+                         struct font *font,
+                         int height,
+                         int sdf_spread,
+                         char *path)
+{
+    if (!service->cache_directory.length)
+        return FALSE;
+
+    snprintf(
+        path,
+        CACHE_PATH_LENGTH,
+        "%s/%016llx-%d%s.glyphs",
+        service->cache_directory.chars,
+        (unsigned long long)font->hash,
+        height,
+        sdf_spread ? "-sdf" : ""
+    );
+
+    return TRUE;
+}
+
+static bool_t is_valid(struct font_cache *cache,
+                       struct font *font,
+                       int height,
+                       int sdf_spread)
+{
+    struct font_cache_header *header = cache->header;
+
+    if (cache->file.size < sizeof(struct font_cache_header))
+        return FALSE;
+
+    if (header->magic != FONT_CACHE_MAGIC || header->version != FONT_CACHE_VERSION ||
+        header->font_hash != font->hash || header->height != height ||
+        header->sdf_spread != sdf_spread || header->glyph_count != FONT_GLYPH_COUNT ||
+        header->size != cache->file.size || header->pixel_offset > header->size)
+        return FALSE;
+
+    size_t pixel_size = header->size - header->pixel_offset;
+
+    for (int i = 0; i < FONT_GLYPH_COUNT; ++i) {
+        struct font_cache_glyph *glyph = cache->glyphs + i;
+        size_t bytes = (size_t)glyph->pixel_width*glyph->pixel_height;
+
+        if (glyph->pixel_offset > pixel_size || bytes > pixel_size - glyph->pixel_offset)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Maps the cache file for the font at the size, if one was written for the same font file
+ * contents by the same version. Anything else is treated as missing.
+ */
+bool_t font_cache_open(struct font_service *service,
+                       struct font *font,
+                       int height,
+                       int sdf_spread,
+                       struct font_cache *cache)
+{
+    char path[CACHE_PATH_LENGTH];
+
+    if (!build_path(service, font, height, sdf_spread, path))
+        return FALSE;
+
+    if (!file_map(path, &cache->file))
+        return FALSE;
+
+    unsigned char *data = cache->file.data;
+
+    size_t glyphs_offset = sizeof(struct font_cache_header);
+    size_t kerning_offset = glyphs_offset + FONT_GLYPH_COUNT*sizeof(struct font_cache_glyph);
+    size_t kerning_size = FONT_GLYPH_COUNT*FONT_GLYPH_COUNT*sizeof(int16_t);
+
+    cache->header = (struct font_cache_header *)data;
+
+    if (cache->file.size < kerning_offset) {
+        file_unmap(&cache->file);
+        return FALSE;
+    }
+
+    cache->glyphs   = (struct font_cache_glyph *)(data + glyphs_offset);
+    cache->kerning  = cache->header->has_kerning ? (int16_t *)(data + kerning_offset) : 0;
+
+    if (!is_valid(cache, font, height, sdf_spread) ||
+        (cache->kerning && cache->header->pixel_offset < kerning_offset + kerning_size)) {
+        file_unmap(&cache->file);
+        return FALSE;
+    }
+
+    cache->pixels = data + cache->header->pixel_offset;
+
+    return TRUE;
+}
+
+void font_cache_close(struct font_cache *cache)
+{
+    file_unmap(&cache->file);
+}
+
+static void make_directory(const char *path)
+{
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0755);
+#endif
+}
+
+// Makes every directory along the path, ignoring ones that already exist.
+static void make_directories(const char *path)
+{
+    char partial[CACHE_PATH_LENGTH];
+    size_t length = strlen(path);
+
+    if (length >= CACHE_PATH_LENGTH)
+        return;
+
+    for (size_t i = 1; i <= length; ++i) {
+        if (path[i] != '/' && path[i] != '\\' && path[i] != '\0')
+            continue;
+
+        memcpy(partial, path, i);
+        partial[i] = '\0';
+
+        make_directory(partial);
+    }
+}
+
+/*
+ * Returns null when caching is off. Every other writer function ignores a null writer, so
+ * loaders can record glyphs without checking.
+ */
+struct font_cache_writer *font_cache_writer_create(struct font_service *service,
+                                                   struct font *font,
+                                                   int height,
+                                                   int sdf_spread)
+{
+    char path[CACHE_PATH_LENGTH];
+
+    if (!build_path(service, font, height, sdf_spread, path))
+        return 0;
+
+    struct font_cache_writer *writer = calloc(1, sizeof(struct font_cache_writer));
+
+    writer->path                = string_create(path);
+    writer->header.magic        = FONT_CACHE_MAGIC;
+    writer->header.version      = FONT_CACHE_VERSION;
+    writer->header.font_hash    = font->hash;
+    writer->header.height       = height;
+    writer->header.sdf_spread   = sdf_spread;
+    writer->header.glyph_count  = FONT_GLYPH_COUNT;
+
+    return writer;
+}
+
+void font_cache_writer_add_glyph(struct font_cache_writer *writer,
+                                 int code,
+                                 struct font_cache_glyph *glyph,
+                                 const unsigned char *pixels,
+                                 int pitch)
+{
+    if (!writer)
+        return;
+
+    struct font_cache_glyph *destination = writer->glyphs + code;
+
+    *destination = *glyph;
+    destination->pixel_offset = writer->pixel_size;
+
+    if (!pixels) {
+        destination->pixel_width    = 0;
+        destination->pixel_height   = 0;
+
+        return;
+    }
+
+    size_t bytes = (size_t)glyph->pixel_width*glyph->pixel_height;
+
+    if (writer->pixel_size + bytes > writer->pixel_capacity) {
+        writer->pixel_capacity  = max(writer->pixel_capacity*2, writer->pixel_size + bytes);
+        writer->pixels          = realloc(writer->pixels, writer->pixel_capacity);
+    }
+
+    // Stored without row padding.
+    for (int y = 0; y < glyph->pixel_height; ++y) {
+        memcpy(
+            writer->pixels + writer->pixel_size + y*glyph->pixel_width,
+            pixels + y*pitch,
+            glyph->pixel_width
+        );
+    }
+
+    writer->pixel_size += bytes;
+}
+
+void font_cache_writer_set_kerning(struct font_cache_writer *writer,
+                                   int left,
+                                   int right,
+                                   int kerning)
+{
+    if (!writer)
+        return;
+
+    if (!writer->kerning) {
+        writer->kerning = calloc(FONT_GLYPH_COUNT*FONT_GLYPH_COUNT, sizeof(int16_t));
+        writer->header.has_kerning = TRUE;
+    }
+
+    writer->kerning[left*FONT_GLYPH_COUNT + right] = kerning;
+}
+
+/*
+ * Written beside the destination and then moved over it, so a run that stops part way never
+ * leaves a file that looks complete.
+ */
+void font_cache_writer_save(struct font_cache_writer *writer)
+{
+    if (!writer)
+        return;
+
+    size_t kerning_size = writer->kerning ?
+        FONT_GLYPH_COUNT*FONT_GLYPH_COUNT*sizeof(int16_t) : 0;
+
+    writer->header.pixel_offset = sizeof(struct font_cache_header) +
+                                  FONT_GLYPH_COUNT*sizeof(struct font_cache_glyph) +
+                                  kerning_size;
+    writer->header.size         = writer->header.pixel_offset + writer->pixel_size;
+
+    char directory[CACHE_PATH_LENGTH];
+    snprintf(directory, CACHE_PATH_LENGTH, "%s", writer->path.chars);
+    *strrchr(directory, '/') = '\0';
+
+    make_directories(directory);
+
+    char temporary[CACHE_PATH_LENGTH + 4];
+    snprintf(temporary, CACHE_PATH_LENGTH + 4, "%s.tmp", writer->path.chars);
+
+    FILE *file = fopen(temporary, "wb");
+
+    if (!file) {
+        debug_log(
+            SEVERITY_WARNING,
+            "Failed to write font cache '%s'.\n",
+            writer->path.chars
+        );
+
+        return;
+    }
+
+    fwrite(&writer->header, sizeof(struct font_cache_header), 1, file);
+    fwrite(writer->glyphs, sizeof(struct font_cache_glyph), FONT_GLYPH_COUNT, file);
+
+    if (writer->kerning)
+        fwrite(writer->kerning, 1, kerning_size, file);
+
+    if (writer->pixel_size)
+        fwrite(writer->pixels, 1, writer->pixel_size, file);
+
+    bool_t failed = ferror(file);
+
+    fclose(file);
+
+    // Windows will not rename over an existing file.
+    remove(writer->path.chars);
+
+    if (failed || rename(temporary, writer->path.chars)) {
+        remove(temporary);
+
+        debug_log(
+            SEVERITY_WARNING,
+            "Failed to write font cache '%s'.\n",
+            writer->path.chars
+        );
+    }
+}
+
+void font_cache_writer_destroy(struct font_cache_writer *writer)
+{
+    if (!writer)
+        return;
+
+    string_destroy(writer->path);
+    free(writer->kerning);
+    free(writer->pixels);
+    free(writer);
+}
@@ -0,0 +1,523 @@
+#include <math.h>
+#include <stdio.h>
+
+#include <soul/debug.h>
+#include <soul/math/macros.h>
+#include <soul/ui/font_sdf.h>
+#include <soul/ui/font_cache.h>
+
+#define SDF_ATLAS_PAGE_SIZE 1024
+#define GLYPH_NAME_LENGTH   16
+#define DISTANCE_INFINITY   1e20f
+
+// Coverage from which a pixel counts as inside the outline.
+#define INSIDE_THRESHOLD 128
+
+static void load_kerning(struct font *font,
+                         struct font_sdf *sdf,
+                         struct font_cache_writer *writer)
+{
+    if (!FT_HAS_KERNING(font->face))
+        return;
+
+    FT_UInt indices[FONT_GLYPH_COUNT];
+
+    for (int c = 0; c < FONT_GLYPH_COUNT; ++c) {
+        indices[c] = FT_Get_Char_Index(font->face, c);
+    }
+
+    sdf->kerning = calloc(FONT_GLYPH_COUNT*FONT_GLYPH_COUNT, sizeof(int16_t));
+
+    for (int left = 0; left < FONT_GLYPH_COUNT; ++left) {
+        if (!indices[left])
+            continue;
+
+        for (int right = 0; right < FONT_GLYPH_COUNT; ++right) {
+            if (!indices[right])
+                continue;
+
+            FT_Vector delta;
+
+            FT_Error result = FT_Get_Kerning(
+                font->face,
+                indices[left],
+                indices[right],
+                FT_KERNING_UNSCALED,
+                &delta
+            );
+
+            if (result)
+                continue;
+
+            int kerning = max(min(delta.x, INT16_MAX), INT16_MIN);
+
+            sdf->kerning[left*FONT_GLYPH_COUNT + right] = kerning;
+
+            if (kerning)
+                font_cache_writer_set_kerning(writer, left, right, kerning);
+        }
+    }
+}
+
+// The atlas is left to the texture service when that is already gone.
+void font_sdf_destroy(struct font_service *service, struct font_sdf *sdf)
+{
+    if (service->texture_service)
+        texture_atlas_destroy(service->texture_service, sdf->atlas);
+
+    string_map_destroy(&sdf->glyphs);
+
+    free(sdf->kerning);
+    free(sdf);
+}
+
+/*
+ * Felzenszwalb and Huttenlocher's squared distance transform of one row or column, in place.
+ * Each sample is a parabola rooted at its value, and the lower envelope of them all is found
+ * in a single pass, with bounds holding where each parabola on the envelope takes over.
+ */
+static void transform_line(float *line,
+                           int count,
+                           int stride,
+                           float *distances,
+                           int *parabolas,
+                           float *bounds)
+{
+    int k = 0;
+
+    parabolas[0]    = 0;
+    bounds[0]       = -DISTANCE_INFINITY;
+    bounds[1]       = DISTANCE_INFINITY;
+
+    for (int q = 1; q < count; ++q) {
+        float height = line[q*stride] + q*q;
+        float s;
+
+        for (;;) {
+            int p = parabolas[k];
+
+            s = (height - (line[p*stride] + p*p))/(2*(q - p));
+
+            if (s > bounds[k])
+                break;
+
+            --k;
+        }
+
+        ++k;
+
+        parabolas[k]    = q;
+        bounds[k]       = s;
+        bounds[k + 1]   = DISTANCE_INFINITY;
+    }
+
+    k = 0;
+
+    for (int q = 0; q < count; ++q) {
+        while (bounds[k + 1] < q) {
+            ++k;
+        }
+
+        int p = parabolas[k];
+
+        distances[q] = (q - p)*(q - p) + line[p*stride];
+    }
+
+    for (int q = 0; q < count; ++q) {
+        line[q*stride] = distances[q];
+    }
+}
+
+static void transform(float *grid, int width, int height, float *scratch, int *parabolas)
+{
+    int largest = max(width, height);
+
+    float *distances = scratch;
+    float *bounds = scratch + largest;
+
+    for (int x = 0; x < width; ++x) {
+        transform_line(grid + x, height, width, distances, parabolas, bounds);
+    }
+
+    for (int y = 0; y < height; ++y) {
+        transform_line(grid + y*width, width, 1, distances, parabolas, bounds);
+    }
+}
+
+/*
+ * Pads the bitmap by the spread and stores, for every pixel, its distance to the outline in
+ * reference pixels, mapped so the outline sits at half intensity and the spread reaches the
+ * ends of the range.
+ */
+static unsigned char *create_distance_field(FT_Bitmap *bitmap, int *p_width, int *p_height)
+{
+    int width = bitmap->width + 2*FONT_SDF_SPREAD;
+    int height = bitmap->rows + 2*FONT_SDF_SPREAD;
+    int largest = max(width, height);
+    int count = width*height;
+
+    // Squared distances to the nearest covered pixel, then to the nearest uncovered one.
+    float *outside = malloc(count*sizeof(float));
+    float *inside = malloc(count*sizeof(float));
+    float *scratch = malloc((2*largest + 1)*sizeof(float));
+    int *parabolas = malloc(largest*sizeof(int));
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            int bitmap_x = x - FONT_SDF_SPREAD;
+            int bitmap_y = y - FONT_SDF_SPREAD;
+
+            bool_t covered = bitmap_x >= 0 && bitmap_x < (int)bitmap->width &&
+                             bitmap_y >= 0 && bitmap_y < (int)bitmap->rows &&
+                             bitmap->buffer[bitmap_y*bitmap->pitch + bitmap_x] >= INSIDE_THRESHOLD;
+
+            outside[y*width + x]    = covered ? 0 : DISTANCE_INFINITY;
+            inside[y*width + x]     = covered ? DISTANCE_INFINITY : 0;
+        }
+    }
+
+    transform(outside, width, height, scratch, parabolas);
+    transform(inside, width, height, scratch, parabolas);
+
+    unsigned char *pixels = malloc(count);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float distance = sqrtf(outside[y*width + x]) - sqrtf(inside[y*width + x]);
+
+            // The outline runs between pixel centres, half a pixel from either.
+            distance += distance > 0 ? -0.5f : 0.5f;
+
+            float value = 0.5f - distance/(2*FONT_SDF_SPREAD);
+            value = max(min(value, 1.0f), 0.0f);
+
+            // Stored bottom up, matching the flipped textures bitmap glyphs are given.
+            pixels[(height - 1 - y)*width + x] = value*255 + 0.5f;
+        }
+    }
+
+    free(outside);
+    free(inside);
+    free(scratch);
+    free(parabolas);
+
+    *p_width    = width;
+    *p_height   = height;
+
+    return pixels;
+}
+
+/*
+ * Glyphs are keyed by code point alone, so one taken from a fallback is shared by every set
+ * of the font it was asked for through.
+ */
+static struct sdf_glyph *rasterise(struct font_service *service,
+                                   struct font_sdf *sdf,
+                                   struct font *source,
+                                   uint32_t code,
+                                   struct font_cache_writer *writer)
+{
+    char name[GLYPH_NAME_LENGTH];
+    snprintf(name, GLYPH_NAME_LENGTH, "%u", code);
+
+    struct sdf_glyph *glyph = string_map_index(&sdf->glyphs, name);
+
+    if (glyph)
+        return glyph;
+
+    FT_Set_Pixel_Sizes(source->face, 0, FONT_SDF_REFERENCE_SIZE);
+
+    FT_Error r = FT_Load_Char(source->face, code, FT_LOAD_RENDER | FT_LOAD_NO_HINTING);
+
+    if (r) {
+        debug_log(
+            SEVERITY_WARNING,
+            "Failed to load glyph '%u' from '%s'.\n",
+            code,
+            source->name.chars
+        );
+
+        return 0;
+    }
+
+    FT_GlyphSlot slot = source->face->glyph;
+
+    glyph = string_map_alloc(&sdf->glyphs, name);
+
+    glyph->region   = 0;
+    glyph->size     = vec2i(slot->bitmap.width, slot->bitmap.rows);
+    glyph->bearing  = vec2i(slot->bitmap_left, slot->bitmap_top);
+    glyph->advance  = slot->linearHoriAdvance/65536.0f;
+
+    int width = 0, height = 0;
+    unsigned char *pixels = 0;
+
+    if (slot->bitmap.buffer) {
+        pixels = create_distance_field(&slot->bitmap, &width, &height);
+
+        glyph->region = texture_atlas_add_pixels(
+            service->texture_service,
+            sdf->atlas,
+            name,
+            pixels,
+            width,
+            height,
+            1
+        );
+    }
+
+    struct font_cache_glyph cached = {
+        .loaded         = TRUE,
+        .width          = glyph->size.x,
+        .height         = glyph->size.y,
+        .bearing_x      = glyph->bearing.x,
+        .bearing_y      = glyph->bearing.y,
+        .advance        = glyph->advance,
+        .pixel_width    = width,
+        .pixel_height   = height
+    };
+
+    font_cache_writer_add_glyph(writer, code, &cached, pixels, width);
+
+    free(pixels);
+
+    return glyph;
+}
+
+static void load_cache(struct font_service *service,
+                       struct font_sdf *sdf,
+                       struct font_cache *cache)
+{
+    sdf->units_per_em   = cache->header->units_per_em;
+    sdf->line_height    = cache->header->line_height;
+    sdf->ascent         = cache->header->ascent;
+    sdf->descent        = cache->header->descent;
+
+    if (cache->kerning) {
+        size_t kerning_size = FONT_GLYPH_COUNT*FONT_GLYPH_COUNT*sizeof(int16_t);
+
+        sdf->kerning = malloc(kerning_size);
+        memcpy(sdf->kerning, cache->kerning, kerning_size);
+    }
+
+    for (int c = 0; c < FONT_GLYPH_COUNT; ++c) {
+        struct font_cache_glyph *cached = cache->glyphs + c;
+
+        if (!cached->loaded)
+            continue;
+
+        char name[GLYPH_NAME_LENGTH];
+        snprintf(name, GLYPH_NAME_LENGTH, "%d", c);
+
+        struct sdf_glyph *glyph = string_map_alloc(&sdf->glyphs, name);
+
+        glyph->region   = 0;
+        glyph->size     = vec2i(cached->width, cached->height);
+        glyph->bearing  = vec2i(cached->bearing_x, cached->bearing_y);
+        glyph->advance  = cached->advance;
+
+        if (!cached->pixel_width)
+            continue;
+
+        glyph->region = texture_atlas_add_pixels(
+            service->texture_service,
+            sdf->atlas,
+            name,
+            cache->pixels + cached->pixel_offset,
+            cached->pixel_width,
+            cached->pixel_height,
+            1
+        );
+    }
+}
+
+static void rasterise_ascii(struct font_service *service,
+                            struct font *font,
+                            struct font_sdf *sdf)
+{
+    FT_Face face = font->face;
+
+    struct font_cache_writer *writer = font_cache_writer_create(
+        service,
+        font,
+        FONT_SDF_REFERENCE_SIZE,
+        FONT_SDF_SPREAD
+    );
+
+    sdf->units_per_em   = face->units_per_EM;
+    sdf->line_height    = face->height;
+    sdf->ascent         = face->ascender;
+    sdf->descent        = face->descender;
+
+    load_kerning(font, sdf, writer);
+
+    for (int c = 0; c < FONT_GLYPH_COUNT; ++c) {
+        rasterise(service, sdf, font, c, writer);
+    }
+
+    if (writer) {
+        writer->header.units_per_em = sdf->units_per_em;
+        writer->header.line_height  = sdf->line_height;
+        writer->header.ascent       = sdf->ascent;
+        writer->header.descent      = sdf->descent;
+    }
+
+    font_cache_writer_save(writer);
+    font_cache_writer_destroy(writer);
+}
+
+/*
+ * Returns null if the font cannot be read or has no outlines to take distance fields of. A
+ * valid cache file means the font file never has to be opened by FreeType.
+ */
+struct font_sdf *font_sdf_create(struct font_service *service, struct font *font)
+{
+    struct font_cache cache;
+
+    bool_t cached = font_cache_open(
+        service,
+        font,
+        FONT_SDF_REFERENCE_SIZE,
+        FONT_SDF_SPREAD,
+        &cache
+    );
+
+    if (!cached) {
+        FT_Face face = font_get_face(service, font);
+
+        if (!face)
+            return 0;
+
+        if (!FT_IS_SCALABLE(face)) {
+            debug_log(
+                SEVERITY_WARNING,
+                "Failed to enable distance fields for font '%s'. Font is not scalable.\n",
+                font->name.chars
+            );
+
+            return 0;
+        }
+    }
+
+    struct font_sdf *sdf = calloc(1, sizeof(struct font_sdf));
+
+    struct texture_atlas_create_info atlas_create_info = NEW_TEXTURE_ATLAS_CREATE_INFO;
+    atlas_create_info.name          = font->name.chars;
+    atlas_create_info.page_size     = SDF_ATLAS_PAGE_SIZE;
+    atlas_create_info.channel_count = 1;
+
+    sdf->atlas = texture_atlas_create(service->texture_service, &atlas_create_info);
+
+    string_map_init(&sdf->glyphs, sizeof(struct sdf_glyph));
+
+    if (cached) {
+        load_cache(service, sdf, &cache);
+        font_cache_close(&cache);
+    } else {
+        rasterise_ascii(service, font, sdf);
+    }
+
+    texture_atlas_upload(sdf->atlas);
+
+    return sdf;
+}
+
+/*
+ * Metrics are scaled and rounded to the set's size, and the glyph's quad is its scaled bitmap
+ * grown by the set's padding, mapped back onto the matching part of the distance field.
+ */
+static void scale_glyph(struct glyph_set *set, struct sdf_glyph *source, struct glyph *destination)
+{
+    float scale = set->height/(float)FONT_SDF_REFERENCE_SIZE;
+
+    destination->size       = vec2i(roundf(source->size.x*scale), roundf(source->size.y*scale));
+    destination->bearing    = vec2i(
+        roundf(source->bearing.x*scale),
+        roundf(source->bearing.y*scale)
+    );
+    destination->advance    = roundf(source->advance*scale);
+    destination->draw_width = destination->bearing.x + destination->size.x;
+
+    struct texture_region *region = source->region;
+
+    if (!region)
+        return;
+
+    float texel_width = region->uv_rect.z/region->size.x;
+    float texel_height = region->uv_rect.w/region->size.y;
+
+    // In reference pixels, from the field's top left.
+    float left = FONT_SDF_SPREAD - set->sdf_padding/scale;
+    float top = left;
+    float width = (destination->size.x + 2*set->sdf_padding)/scale;
+    float height = (destination->size.y + 2*set->sdf_padding)/scale;
+    float bottom = region->size.y - top - height;
+
+    destination->texture = region->texture;
+    destination->uv_rect = vec4f(
+        region->uv_rect.x + left*texel_width,
+        region->uv_rect.y + bottom*texel_height,
+        width*texel_width,
+        height*texel_height
+    );
+}
+
+/*
+ * Fills in a glyph set from the font's distance fields without touching FreeType. Vertical
+ * metrics and kerning are scaled from the font's design units.
+ */
+void font_sdf_load_glyph_set(struct font_service *service,
+                             struct font *font,
+                             struct glyph_set *set)
+{
+    struct font_sdf *sdf = font->sdf;
+
+    float scale = set->height/(float)FONT_SDF_REFERENCE_SIZE;
+    float unit_scale = set->height/(float)sdf->units_per_em;
+
+    set->sdf            = TRUE;
+    set->sdf_padding    = FONT_SDF_SPREAD*scale;
+    set->sdf_smoothing  = 0.25f/(FONT_SDF_SPREAD*scale);
+    set->line_height    = roundf(sdf->line_height*unit_scale);
+    set->ascent         = roundf(sdf->ascent*unit_scale);
+    set->descent        = roundf(sdf->descent*unit_scale);
+
+    for (int c = 0; c < FONT_GLYPH_COUNT; ++c) {
+        char name[GLYPH_NAME_LENGTH];
+        snprintf(name, GLYPH_NAME_LENGTH, "%d", c);
+
+        struct sdf_glyph *glyph = string_map_index(&sdf->glyphs, name);
+
+        if (glyph)
+            scale_glyph(set, glyph, set->glyphs + c);
+    }
+
+    if (!sdf->kerning)
+        return;
+
+    set->kerning = calloc(FONT_GLYPH_COUNT*FONT_GLYPH_COUNT, sizeof(int8_t));
+
+    for (int i = 0; i < FONT_GLYPH_COUNT*FONT_GLYPH_COUNT; ++i) {
+        int kerning = roundf(sdf->kerning[i]*unit_scale);
+
+        set->kerning[i] = max(min(kerning, INT8_MAX), INT8_MIN);
+    }
+}
+
+bool_t font_sdf_load_glyph(struct font_service *service,
+                           struct glyph_set *set,
+                           struct font *source,
+                           struct glyph *destination,
+                           uint32_t code)
+{
+    struct font_sdf *sdf = set->font->sdf;
+    struct sdf_glyph *glyph = rasterise(service, sdf, source, code, 0);
+
+    if (!glyph)
+        return FALSE;
+
+    scale_glyph(set, glyph, destination);
+    texture_atlas_upload(sdf->atlas);
+
+    return TRUE;
+}
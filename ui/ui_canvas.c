@@ -1,5 +1,7 @@
 #include <soul/ui/ui_canvas.h>
 #include <soul/ui/ui_text.h>
+#include <soul/ui/ui_hover.h>
+#include <soul/scheduler.h>
 
 static struct ui_render_cache *create_render_cache(struct soul_instance *soul_instance,
                                                    struct component_descriptor *descriptor)
@@ -21,19 +23,24 @@ static struct ui_render_cache *create_render_cache(struct soul_instance *soul_in
     render_cache->is_text_uniform       = shader_get_uniform(render_cache->shader, "is_text");
     render_cache->use_texture_uniform   = shader_get_uniform(render_cache->shader, "use_texture");
     render_cache->matrix_uniform        = shader_get_uniform(render_cache->shader, "matrix");
+    render_cache->uv_rect_uniform       = shader_get_uniform(render_cache->shader, "uv_rect");
+    render_cache->sdf_uniform           = shader_get_uniform(render_cache->shader, "sdf");
+    render_cache->sdf_smoothing_uniform = shader_get_uniform(
+        render_cache->shader,
+        "sdf_smoothing"
+    );
 
     return render_cache;
 }
 
 static void render_container(struct ui_container *container,
-                             struct window *window,
                              struct ui_render_cache *render_cache)
 {
     if (container->visible)
-        ui_container_draw(container, render_cache, window);
+        ui_container_draw(container, render_cache);
 
     list_for_each (struct ui_container *, p_child, container->children) {
-        render_container(*p_child, window, render_cache);
+        render_container(*p_child, render_cache);
     }
 }
 
@@ -44,8 +51,10 @@ static void render(struct ui_render_cache *render_cache)
     list_for_each (struct ui_canvas, canvas, *render_cache->canvas_instances) {
         window_bind(canvas->window);
 
+        render_cache->view_matrix = ui_render_calculate_view(canvas->window);
+
         if (canvas->root_container)
-            render_container(canvas->root_container, canvas->window, render_cache);
+            render_container(canvas->root_container, render_cache);
     }
 }
 
@@ -62,18 +71,25 @@ void ui_canvas_register_component(struct soul_instance *soul_instance)
 
     struct ui_render_cache *render_cache = create_render_cache(soul_instance, descriptor);
 
-    ordered_callbacks_insert(
-        &soul_instance->callbacks,
-        (ordered_callback_t)&render,
-        EXECUTION_ORDER_RENDER,
-        render_cache,
-        FALSE
-    );
+    struct system_registry_info system_info = {
+        .name           = "ui_canvas_render",
+        .fn             = (system_t)&render,
+        .data           = render_cache,
+        .order          = EXECUTION_ORDER_RENDER,
+        .reads          = (const char *[]){ UI_CANVAS, UI_CONTAINER },
+        .read_count     = 2,
+        .main_thread    = TRUE
+    };
+
+    system_register(resource_get(soul_instance, SCHEDULER_SERVICE), &system_info);
+
+    ui_hover_register_system(soul_instance, &descriptor->passive_storage);
 }
 
 static void on_left_click(struct window *window, struct ui_canvas *canvas)
 {
-    ui_container_test_mouse(canvas->root_container, &window->input.mouse);
+    if (canvas->root_container)
+        ui_container_test_mouse(canvas->root_container, &window->input.mouse);
 }
 
 static void on_window_resize(struct window *window, struct ui_canvas *canvas)
@@ -8,11 +8,16 @@
 #include <soul/ui/ui_axis.h>
 #include <soul/ui/ui_text.h>
 #include <soul/ui/ui_canvas.h>
+#include <soul/ui/ui_hover.h>
 
 struct callback_data
 {
-    struct ecs_service *    ecs;
-    struct font_service *   font_service;
+    struct ecs_service *        ecs;
+    struct font_service *       font_service;
+    struct texture_service *    texture_service;
+    struct ui_hover_state *     hover_state;
+    int                         container_type;
+    int                         canvas_type;
 };
 
 static void init(struct entity *entity,
@@ -21,8 +26,9 @@ static void init(struct entity *entity,
 {
     struct ui_container *const container = storage.passive;
 
-    container->entity       = entity;
-    container->draw_axis    = ui_axis_get_layout_axis(container->layout);
+    container->entity           = entity;
+    container->draw_axis        = ui_axis_get_layout_axis(container->layout);
+    container->current_colour   = container->colour;
 
     list_init(&container->children, sizeof(struct ui_container *));
     list_init(&container->on_left_click, sizeof(struct callback));
@@ -50,15 +56,17 @@ static void init(struct entity *entity,
         container->absolute_rect.size.y = container->rect.size.y;
 
     if (entity->parent) {
-        struct ui_container *parent_container = component_get_storage(
-            data->ecs,
+        struct ui_container *parent_container = entity_get_passive(
             entity->parent,
-            UI_CONTAINER
-        ).passive;
+            struct ui_container,
+            data->container_type
+        );
 
         if (parent_container) {
             list_push(&parent_container->children, (struct ui_container **)&container);
             container->parent = parent_container;
+
+            ui_container_mark_layout_changed(parent_container);
         }
     }
 }
@@ -72,11 +80,11 @@ static void entered_tree(struct entity *entity,
     if (!entity->parent)
         return;
 
-    struct ui_canvas *parent_canvas = component_get_storage(
-        data->ecs,
+    struct ui_canvas *parent_canvas = entity_get_passive(
         entity->parent,
-        UI_CANVAS
-    ).passive;
+        struct ui_canvas,
+        data->canvas_type
+    );
 
     if (parent_canvas) {
         parent_canvas->root_container = container;
@@ -90,10 +98,28 @@ static void entered_tree(struct entity *entity,
     }
 }
 
-static void cleanup(struct entity *entity, struct component_storage storage, void *data)
+static void cleanup(struct entity *entity,
+                    struct component_storage storage,
+                    struct callback_data *data)
 {
     struct ui_container *const container = storage.passive;
 
+    if (container->texture)
+        texture_release(data->texture_service, container->texture);
+
+    ui_hover_forget(data->hover_state, container);
+
+    // A parent being destroyed alongside is about to drop its whole child list anyway.
+    if (container->parent && !container->parent->entity->destroying) {
+        list_remove_value(&container->parent->children, (struct ui_container **)&container);
+        ui_container_mark_layout_changed(container->parent);
+    }
+
+    if (container->hit_test) {
+        ui_hit_test_destroy(container->hit_test);
+        free(container->hit_test);
+    }
+
     list_destroy(&container->children);
     list_destroy(&container->on_left_click);
     list_destroy(&container->on_resize);
@@ -104,14 +130,12 @@ static void cleanup(struct entity *entity, struct component_storage storage, voi
     string_destroy(container->ui_text.string);
 }
 
-void ui_container_draw(struct ui_container *container,
-                       struct ui_render_cache *render_cache,
-                       struct window *window)
+void ui_container_draw(struct ui_container *container, struct ui_render_cache *render_cache)
 {
     struct mat4x4 matrix = ui_render_calculate_matrix(
         &container->absolute_rect,
         container->depth,
-        window
+        &render_cache->view_matrix
     );
 
     bool_t use_texture = FALSE;
@@ -123,13 +147,21 @@ void ui_container_draw(struct ui_container *container,
 
     shader_uniform_int(render_cache->use_texture_uniform, use_texture);
     shader_uniform_int(render_cache->is_text_uniform, FALSE);
-    shader_uniform_vec4f(render_cache->colour_uniform, container->colour);
+    shader_uniform_int(render_cache->sdf_uniform, FALSE);
+    shader_uniform_vec4f(render_cache->uv_rect_uniform, vec4f(0, 0, 1, 1));
+    // Hover only takes over the colour while hovered or transitioning.
+    struct vec4f colour = container->colour;
+
+    if (container->hovered || container->hover_active)
+        colour = container->current_colour;
+
+    shader_uniform_vec4f(render_cache->colour_uniform, colour);
     shader_uniform_mat4x4(render_cache->matrix_uniform, &matrix);
 
     mesh_draw(render_cache->quad);
 
     if (container->contains_text)
-        ui_text_draw(&container->ui_text, container->depth, render_cache, window);
+        ui_text_draw(&container->ui_text, container->depth, render_cache);
 }
 
 void ui_container_register_component(struct soul_instance *soul_instance)
@@ -143,8 +175,10 @@ void ui_container_register_component(struct soul_instance *soul_instance)
         0
     );
 
-    callback_data->ecs          = resource_get(soul_instance, ECS_SERVICE);
-    callback_data->font_service = resource_get(soul_instance, FONT_SERVICE);
+    callback_data->ecs              = resource_get(soul_instance, ECS_SERVICE);
+    callback_data->font_service     = resource_get(soul_instance, FONT_SERVICE);
+    callback_data->texture_service  = resource_get(soul_instance, TEXTURE_SERVICE);
+    callback_data->hover_state      = resource_get(soul_instance, UI_HOVER_STATE);
 
     struct component_property_registry_info properties[] = {
         PROPERTY(ui_container, colour, "vec4f"),
@@ -157,7 +191,9 @@ void ui_container_register_component(struct soul_instance *soul_instance)
         PROPERTY(ui_container, text_size, "int"),
         PROPERTY(ui_container, text_font, "font"),
         PROPERTY(ui_container, margins, "margins"),
-        PROPERTY(ui_container, separation_margin, "int")
+        PROPERTY(ui_container, separation_margin, "int"),
+        PROPERTY(ui_container, hover_colour, "vec4f"),
+        PROPERTY(ui_container, hover_transition_time, "float")
     };
 
     struct component_registry_info registry_info = {
@@ -171,7 +207,10 @@ void ui_container_register_component(struct soul_instance *soul_instance)
         .property_count         = sizeof(properties)/sizeof(struct component_property_registry_info)
     };
 
-    component_register(ecs_service, &registry_info);
+    struct component_descriptor *descriptor = component_register(ecs_service, &registry_info);
+
+    callback_data->container_type   = descriptor->type_id;
+    callback_data->canvas_type      = component_match_descriptor(ecs_service, UI_CANVAS)->type_id;
 }
 
 static struct ui_container *get_most_shallow_modified(struct ui_container *container)
@@ -428,6 +467,8 @@ void ui_container_calculate_children(struct ui_container *container)
     calculate_sizes(container);
     calculate_positions(container, container->depth);
     calculate_text(container);
+
+    ui_container_mark_layout_changed(container);
 }
 
 void ui_container_set_layout(struct ui_container *container, ui_layout_t layout)
@@ -441,6 +482,21 @@ void ui_container_set_alignment(struct ui_container *container, ui_alignment_t a
 {
     container->alignment = alignment;
     calculate_positions(container, container->depth);
+
+    ui_container_mark_layout_changed(container);
+}
+
+/*
+ * Call after changing anything mouse tests depend on, such as ignore_mouse_test, outside of the
+ * functions here.
+ */
+void ui_container_mark_layout_changed(struct ui_container *container)
+{
+    while (container->parent) {
+        container = container->parent;
+    }
+
+    ++container->layout_generation;
 }
 
 bool_t check_bounds(struct ui_container *container, struct vec2i point)
@@ -462,18 +518,50 @@ bool_t check_bounds(struct ui_container *container, struct vec2i point)
     return TRUE;
 }
 
-bool_t ui_container_test_mouse(struct ui_container *container, struct mouse_state *mouse)
+static struct ui_container *pick_recursive(struct ui_container *container, struct vec2i point)
 {
-    if (container->ignore_mouse_test || !check_bounds(container, mouse->position))
-        return FALSE;
+    if (container->ignore_mouse_test || !check_bounds(container, point))
+        return 0;
 
     list_for_each (struct ui_container *, p_child, container->children) {
-        if (ui_container_test_mouse(*p_child, mouse))
-            return TRUE;
+        struct ui_container *hit = pick_recursive(*p_child, point);
+
+        if (hit)
+            return hit;
     }
 
+    return container;
+}
+
+/*
+ * The deepest container under the point, following the first child containing it at each
+ * level. Roots answer from a flattened hit test, rebuilt only after the tree is laid out again.
+ */
+struct ui_container *ui_container_pick(struct ui_container *container, struct vec2i point)
+{
+    if (container->parent)
+        return pick_recursive(container, point);
+
+    if (!container->hit_test)
+        container->hit_test = calloc(1, sizeof(struct ui_hit_test));
+
+    struct ui_hit_test *hit_test = container->hit_test;
+
+    if (!hit_test->built || hit_test->generation != container->layout_generation)
+        ui_hit_test_build(hit_test, container);
+
+    return ui_hit_test_query(hit_test, point);
+}
+
+bool_t ui_container_test_mouse(struct ui_container *container, struct mouse_state *mouse)
+{
+    struct ui_container *hit = ui_container_pick(container, mouse->position);
+
+    if (!hit)
+        return FALSE;
+
     if (mouse->buttons[MOUSE_LEFT])
-        callbacks_dispatch(&container->on_left_click, container);
+        callbacks_dispatch(&hit->on_left_click, hit);
 
     return TRUE;
 }
\ No newline at end of file
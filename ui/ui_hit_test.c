@@ -0,0 +1,197 @@
+#include <string.h>
+
+#include <soul/ui/ui_hit_test.h>
+#include <soul/ui/ui_container.h>
+#include <soul/math/macros.h>
+
+static void push_entry(struct ui_hit_test *hit_test, struct ui_hit_entry entry)
+{
+    if (hit_test->entry_count == hit_test->entry_capacity) {
+        hit_test->entry_capacity = max(hit_test->entry_capacity*2, 64);
+        hit_test->entries = realloc(
+            hit_test->entries,
+            hit_test->entry_capacity*sizeof(struct ui_hit_entry)
+        );
+    }
+
+    hit_test->entries[hit_test->entry_count++] = entry;
+}
+
+static void flatten(struct ui_hit_test *hit_test,
+                    struct ui_container *container,
+                    struct ui_hit_entry *clip,
+                    int depth)
+{
+    if (container->ignore_mouse_test)
+        return;
+
+    struct ui_rect rect = container->absolute_rect;
+
+    struct ui_hit_entry entry = {
+        .container  = container,
+        .left       = max(rect.position.x, clip->left),
+        .top        = max(rect.position.y, clip->top),
+        .right      = min(rect.position.x + rect.size.x, clip->right),
+        .bottom     = min(rect.position.y + rect.size.y, clip->bottom),
+        .depth      = depth
+    };
+
+    // Nothing inside can be hit either.
+    if (entry.left > entry.right || entry.top > entry.bottom)
+        return;
+
+    push_entry(hit_test, entry);
+
+    list_for_each (struct ui_container *, p_child, container->children) {
+        flatten(hit_test, *p_child, &entry, depth + 1);
+    }
+}
+
+// The range of cells an entry overlaps, inclusive.
+static void cell_range(struct ui_hit_test *hit_test,
+                       struct ui_hit_entry *entry,
+                       struct vec2i *first,
+                       struct vec2i *last)
+{
+    first->x    = (entry->left - hit_test->origin.x)/hit_test->cell_size;
+    first->y    = (entry->top - hit_test->origin.y)/hit_test->cell_size;
+    last->x     = (entry->right - hit_test->origin.x)/hit_test->cell_size;
+    last->y     = (entry->bottom - hit_test->origin.y)/hit_test->cell_size;
+}
+
+static void build_grid(struct ui_hit_test *hit_test)
+{
+    struct ui_hit_entry *bounds = hit_test->entries;
+
+    int width = bounds->right - bounds->left + 1;
+    int height = bounds->bottom - bounds->top + 1;
+
+    int largest = max(width, height);
+
+    hit_test->origin    = vec2i(bounds->left, bounds->top);
+    hit_test->cell_size = max(
+        UI_HIT_TEST_CELL_SIZE,
+        (largest + UI_HIT_TEST_MAX_CELLS - 1)/UI_HIT_TEST_MAX_CELLS
+    );
+    hit_test->columns   = (width + hit_test->cell_size - 1)/hit_test->cell_size;
+    hit_test->rows      = (height + hit_test->cell_size - 1)/hit_test->cell_size;
+
+    int cell_count = hit_test->columns*hit_test->rows;
+
+    if (cell_count + 1 > hit_test->cell_capacity) {
+        hit_test->cell_capacity = cell_count + 1;
+        hit_test->cell_starts   = realloc(hit_test->cell_starts, (cell_count + 1)*sizeof(int));
+    }
+
+    memset(hit_test->cell_starts, 0, (cell_count + 1)*sizeof(int));
+
+    // Counted into the slot after each cell's, so the prefix sum below gives each cell's start.
+    for (int i = 0; i < hit_test->entry_count; ++i) {
+        struct vec2i first, last;
+        cell_range(hit_test, hit_test->entries + i, &first, &last);
+
+        for (int y = first.y; y <= last.y; ++y) {
+            for (int x = first.x; x <= last.x; ++x) {
+                ++hit_test->cell_starts[y*hit_test->columns + x + 1];
+            }
+        }
+    }
+
+    for (int i = 0; i < cell_count; ++i) {
+        hit_test->cell_starts[i + 1] += hit_test->cell_starts[i];
+    }
+
+    int total = hit_test->cell_starts[cell_count];
+
+    if (total > hit_test->cell_entry_capacity) {
+        hit_test->cell_entry_capacity   = max(total, hit_test->cell_entry_capacity*2);
+        hit_test->cell_entries          = realloc(
+            hit_test->cell_entries,
+            hit_test->cell_entry_capacity*sizeof(int)
+        );
+    }
+
+    // Fills each cell from its start, which leaves every start moved along to the next cell's.
+    for (int i = 0; i < hit_test->entry_count; ++i) {
+        struct vec2i first, last;
+        cell_range(hit_test, hit_test->entries + i, &first, &last);
+
+        for (int y = first.y; y <= last.y; ++y) {
+            for (int x = first.x; x <= last.x; ++x) {
+                hit_test->cell_entries[hit_test->cell_starts[y*hit_test->columns + x]++] = i;
+            }
+        }
+    }
+
+    for (int i = cell_count; i > 0; --i) {
+        hit_test->cell_starts[i] = hit_test->cell_starts[i - 1];
+    }
+
+    hit_test->cell_starts[0] = 0;
+}
+
+void ui_hit_test_build(struct ui_hit_test *hit_test, struct ui_container *root)
+{
+    struct ui_rect rect = root->absolute_rect;
+
+    struct ui_hit_entry clip = {
+        .left   = rect.position.x,
+        .top    = rect.position.y,
+        .right  = rect.position.x + rect.size.x,
+        .bottom = rect.position.y + rect.size.y
+    };
+
+    hit_test->entry_count   = 0;
+    hit_test->generation    = root->layout_generation;
+    hit_test->built         = TRUE;
+
+    flatten(hit_test, root, &clip, 0);
+
+    if (hit_test->entry_count)
+        build_grid(hit_test);
+}
+
+/*
+ * Returns the container a click at the point lands on: starting from the root, the first
+ * child containing the point is followed down until no child contains it. In preorder, that is
+ * the first entry containing the point whose next such entry is not one of its descendants.
+ */
+struct ui_container *ui_hit_test_query(struct ui_hit_test *hit_test, struct vec2i point)
+{
+    if (!hit_test->entry_count)
+        return 0;
+
+    struct ui_hit_entry *root = hit_test->entries;
+
+    if (point.x < root->left || point.x > root->right ||
+        point.y < root->top || point.y > root->bottom)
+        return 0;
+
+    int x = (point.x - hit_test->origin.x)/hit_test->cell_size;
+    int y = (point.y - hit_test->origin.y)/hit_test->cell_size;
+    int cell = y*hit_test->columns + x;
+
+    struct ui_hit_entry *found = 0;
+
+    for (int i = hit_test->cell_starts[cell]; i < hit_test->cell_starts[cell + 1]; ++i) {
+        struct ui_hit_entry *entry = hit_test->entries + hit_test->cell_entries[i];
+
+        if (point.x < entry->left || point.x > entry->right ||
+            point.y < entry->top || point.y > entry->bottom)
+            continue;
+
+        if (found && entry->depth <= found->depth)
+            break;
+
+        found = entry;
+    }
+
+    return found ? found->container : 0;
+}
+
+void ui_hit_test_destroy(struct ui_hit_test *hit_test)
+{
+    free(hit_test->entries);
+    free(hit_test->cell_starts);
+    free(hit_test->cell_entries);
+}
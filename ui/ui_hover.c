@@ -0,0 +1,154 @@
+#include <soul/execution_order.h>
+#include <soul/scheduler.h>
+#include <soul/math/macros.h>
+#include <soul/ui/ui_hover.h>
+#include <soul/ui/ui_canvas.h>
+
+static void deallocate_state(struct ui_hover_state *state)
+{
+    free(state->active);
+}
+
+static void activate(struct ui_hover_state *state, struct ui_container *container, bool_t hovered)
+{
+    container->hovered = hovered;
+
+    if (container->hover_active)
+        return;
+
+    if (state->active_count == state->active_capacity) {
+        state->active_capacity  = max(state->active_capacity*2, UI_HOVER_MIN_ACTIVE_CAPACITY);
+        state->active           = realloc(
+            state->active,
+            state->active_capacity*sizeof(struct ui_container *)
+        );
+    }
+
+    state->active[state->active_count++] = container;
+    container->hover_active = TRUE;
+}
+
+static bool_t has_hover(struct ui_container *container)
+{
+    struct vec4f colour = container->hover_colour;
+
+    return colour.x || colour.y || colour.z || colour.w;
+}
+
+static void update_hovered(struct ui_hover_state *state, struct ui_canvas *canvas)
+{
+    struct ui_container *hovered = 0;
+
+    if (canvas->window && canvas->root_container)
+        hovered = ui_container_pick(canvas->root_container, canvas->window->input.mouse.position);
+
+    if (hovered == canvas->hovered)
+        return;
+
+    if (canvas->hovered && has_hover(canvas->hovered))
+        activate(state, canvas->hovered, FALSE);
+
+    if (hovered && has_hover(hovered))
+        activate(state, hovered, TRUE);
+
+    canvas->hovered = hovered;
+}
+
+// Returns whether the transition is over.
+static bool_t advance(struct ui_container *container, float delta_time)
+{
+    float duration = container->hover_transition_time;
+
+    if (container->hovered)
+        container->hover_timer = min(container->hover_timer + delta_time, duration);
+    else
+        container->hover_timer = max(container->hover_timer - delta_time, 0);
+
+    float progress = 0;
+
+    if (duration > 0)
+        progress = container->hover_timer/duration;
+    else
+        progress = container->hovered ? 1 : 0;
+
+    struct vec4f from = container->colour;
+    struct vec4f to = container->hover_colour;
+
+    container->current_colour = vec4f(
+        from.x + (to.x - from.x)*progress,
+        from.y + (to.y - from.y)*progress,
+        from.z + (to.z - from.z)*progress,
+        from.w + (to.w - from.w)*progress
+    );
+
+    return container->hovered ? progress >= 1 : progress <= 0;
+}
+
+static void update(struct ui_hover_state *state)
+{
+    double time = glfwGetTime();
+    float delta_time = state->last_time ? time - state->last_time : 0;
+
+    state->last_time = time;
+
+    list_for_each (struct ui_canvas, canvas, *state->canvas_instances) {
+        update_hovered(state, canvas);
+    }
+
+    // Finished containers are swapped out for the last, which still needs advancing.
+    for (int i = 0; i < state->active_count;) {
+        struct ui_container *container = state->active[i];
+
+        if (advance(container, delta_time)) {
+            container->hover_active = FALSE;
+            state->active[i] = state->active[--state->active_count];
+        } else {
+            ++i;
+        }
+    }
+}
+
+void ui_hover_register_system(struct soul_instance *soul_instance, struct list *canvas_instances)
+{
+    struct ui_hover_state *state = resource_create(
+        soul_instance,
+        UI_HOVER_STATE,
+        sizeof(struct ui_hover_state),
+        (resource_deallocator_t)&deallocate_state
+    );
+
+    state->canvas_instances = canvas_instances;
+
+    struct system_registry_info system_info = {
+        .name           = "ui_hover",
+        .fn             = (system_t)&update,
+        .data           = state,
+        .order          = EXECUTION_ORDER_PRE_RENDER,
+        .reads          = (const char *[]){ UI_CANVAS },
+        .read_count     = 1,
+        .writes         = (const char *[]){ UI_CONTAINER },
+        .write_count    = 1,
+        .main_thread    = TRUE
+    };
+
+    system_register(resource_get(soul_instance, SCHEDULER_SERVICE), &system_info);
+}
+
+// Drops every reference to a container about to be destroyed.
+void ui_hover_forget(struct ui_hover_state *state, struct ui_container *container)
+{
+    list_for_each (struct ui_canvas, canvas, *state->canvas_instances) {
+        if (canvas->hovered == container)
+            canvas->hovered = 0;
+    }
+
+    if (!container->hover_active)
+        return;
+
+    for (int i = 0; i < state->active_count; ++i) {
+        if (state->active[i] == container) {
+            state->active[i] = state->active[--state->active_count];
+            break;
+        }
+    }
+}
@@ -1,46 +1,29 @@
 #include <soul/ui/ui_render.h>
 
-struct mat4x4 ui_render_calculate_matrix(struct ui_rect *rect, int depth, struct window *window)
+struct mat4x4 ui_render_calculate_view(struct window *window)
 {
-    struct mat4x4 r = MAT4X4_IDENTITY;
-
-    float z = -depth/(float)65535;
-
-    mat4x4_set_pos(
-        &r,
-        vec3f(
-            rect->position.x,
-            -rect->position.y,
-            z
-        )
-    );
-
-    mat4x4_set_scale(
-        &r,
-        vec3f(rect->size.x, rect->size.y, 1)
-    );
-
-    struct mat4x4 view_matrix = MAT4X4_IDENTITY;
-
-    mat4x4_set_pos(
-        &view_matrix,
-        vec3f(
-            -1,
-            1,
-            0
-        )
+    float x_scale = 1.0/window->width*2.0;
+    float y_scale = 1.0/window->height*2.0;
+
+    return mat4x4(
+        x_scale, 0, 0, -1,
+        0, y_scale, 0, 1,
+        0, 0, 1, 0,
+        0, 0, 0, 1
     );
+}
 
-    mat4x4_set_scale(
-        &view_matrix,
-        vec3f(
-            1.0/window->width*2.0,
-            1.0/window->height*2.0,
-            1.0
-        )
-    );
+struct mat4x4 ui_render_calculate_matrix(struct ui_rect *rect,
+                                         int depth,
+                                         struct mat4x4 *view_matrix)
+{
+    struct transform transform = {
+        .position   = vec3f(rect->position.x, -rect->position.y, -depth/(float)65535),
+        .rotation   = QUAT_IDENTITY,
+        .scale      = vec3f(rect->size.x, rect->size.y, 1)
+    };
 
-    r = mul4x4(&view_matrix, &r);
+    struct mat4x4 model = mat4x4_compose(&transform);
 
-    return r;
+    return mul4x4(view_matrix, &model);
 }
@@ -7,39 +7,62 @@
 #define DEFAULT_LINE_GAP            5
 #define DEFAULT_SPACEWIDTH_RATIO    0.5
 
-struct text_row
-{
-    int width;
-    int count;
-};
-
 void ui_text_init(struct ui_text *text) { }
 
 void ui_text_destroy(struct ui_text *text)
 {
     if (text->characters)
         free(text->characters);
+
+    for (int i = 0; i < UI_TEXT_LAYOUT_CACHE_SIZE; ++i) {
+        free(text->layouts[i].rows);
+        free(text->layouts[i].offsets);
+    }
+}
+
+static void invalidate_layouts(struct ui_text *text)
+{
+    for (int i = 0; i < UI_TEXT_LAYOUT_CACHE_SIZE; ++i) {
+        text->layouts[i].valid = FALSE;
+    }
 }
 
-void ui_text_draw(struct ui_text *text,
-                  int depth,
-                  struct ui_render_cache *render_cache,
-                  struct window *window)
+void ui_text_draw(struct ui_text *text, int depth, struct ui_render_cache *render_cache)
 {
+    struct glyph_set *const set = text->glyph_set;
+
+    if (!set)
+        return;
+
+    shader_uniform_int(render_cache->sdf_uniform, set->sdf);
+
+    if (set->sdf)
+        shader_uniform_float(render_cache->sdf_smoothing_uniform, set->sdf_smoothing);
+
     for (int i = 0; i < text->character_count; ++i) {
-        if (!text->characters[i].glyph)
+        struct glyph *const glyph = text->characters[i].glyph;
+
+        if (!glyph || !glyph->texture)
             continue;
 
+        // Distance field quads reach past the glyph to keep the edge's falloff.
+        struct ui_rect rect = text->characters[i].absolute_rect;
+        rect.position.x -= set->sdf_padding;
+        rect.position.y -= set->sdf_padding;
+        rect.size.x     += 2*set->sdf_padding;
+        rect.size.y     += 2*set->sdf_padding;
+
         struct mat4x4 matrix = ui_render_calculate_matrix(
-            &text->characters[i].absolute_rect,
+            &rect,
             depth + 1,
-            window
+            &render_cache->view_matrix
         );
 
-        texture_bind(text->characters[i].glyph->texture);
+        texture_bind(glyph->texture);
 
         shader_uniform_int(render_cache->is_text_uniform, TRUE);
         shader_uniform_int(render_cache->use_texture_uniform, TRUE);
+        shader_uniform_vec4f(render_cache->uv_rect_uniform, glyph->uv_rect);
         shader_uniform_mat4x4(render_cache->matrix_uniform, &matrix);
 
         mesh_draw(render_cache->quad);
@@ -48,29 +71,40 @@ void ui_text_draw(struct ui_text *text,
 
 static void create_glyphs(struct ui_text *text)
 {
+    // Never fewer bytes than decoded characters, so sized by the former.
     text->characters = calloc(1, text->string.length*sizeof(struct ui_character));
-    text->character_count = text->string.length;
+    text->character_count = 0;
 
-    char *const string = text->string.chars;
+    invalidate_layouts(text);
 
-    for (int i = 0; i < text->string.length; ++i) {
-        switch (string[i]) {
+    size_t position = 0;
+
+    while (position < text->string.length) {
+        uint32_t code = string_decode_utf8(text->string.chars, text->string.length, &position);
+        struct ui_character *const c = text->characters + text->character_count++;
+
+        c->code = code;
+
+        switch (code) {
             case ' ':
-                text->characters[i].whitespace = TRUE;
+                c->whitespace = TRUE;
                 break;
 
             case '\t':
-                text->characters[i].whitespace = TRUE;
-                text->characters[i].is_tab = TRUE;
+                c->whitespace = TRUE;
+                c->is_tab = TRUE;
                 break;
 
             case '\n':
-                text->characters[i].new_line = TRUE;
+                c->new_line = TRUE;
                 break;
 
             default:
-                text->characters[i].glyph = text->glyph_set->glyphs + string[i];
-                text->characters[i].absolute_rect.size = text->characters[i].glyph->size;
+                if (!text->glyph_set)
+                    break;
+
+                c->glyph = font_get_glyph(text->font_service, text->glyph_set, code);
+                c->absolute_rect.size = c->glyph->size;
                 break;
         }
     }
@@ -107,8 +141,11 @@ void ui_text_set_font(struct font_service *service,
 
     bool_t recreate_glyphs = text->characters && text->string.chars; 
 
-    text->font      = font;
-    text->glyph_set = set;
+    text->font_service  = service;
+    text->font          = font;
+    text->glyph_set     = set;
+
+    invalidate_layouts(text);
 
     if (recreate_glyphs) {
         free(text->characters);
@@ -116,10 +153,38 @@ void ui_text_set_font(struct font_service *service,
     }
 }
 
-static struct list calculate_rows(struct ui_text *text, int max_width)
+static void push_row(struct ui_text_layout *layout, int width, int end)
+{
+    if (layout->row_count == layout->row_capacity) {
+        layout->row_capacity    = max(layout->row_capacity*2, 4);
+        layout->rows            = realloc(
+            layout->rows,
+            layout->row_capacity*sizeof(struct ui_text_row)
+        );
+    }
+
+    layout->rows[layout->row_count++] = (struct ui_text_row){ width, end };
+    layout->width = max(layout->width, width);
+}
+
+/*
+ * Breaks the text into rows no wider than max_width, at the last whitespace where possible,
+ * and records where each character sits along its row. A glyph too wide for an empty row is
+ * left to overflow it.
+ */
+static void calculate_layout(struct ui_text *text, struct ui_text_layout *layout, int max_width)
 {
-    struct list rows;
-    list_init(&rows, sizeof(struct text_row));
+    if (text->character_count > layout->offset_capacity) {
+        layout->offset_capacity = text->character_count;
+        layout->offsets         = realloc(layout->offsets, layout->offset_capacity*sizeof(int));
+    }
+
+    layout->valid       = TRUE;
+    layout->max_width   = max_width;
+    layout->row_count   = 0;
+    layout->width       = 0;
+
+    struct glyph_set *const set = text->glyph_set;
 
     int last_whitespace = 0;
     int cursor = 0;
@@ -127,21 +192,22 @@ static struct list calculate_rows(struct ui_text *text, int max_width)
 
     bool_t last_was_whitespace = FALSE;
 
+    // The glyph before on the same row, to kern against.
+    struct ui_character *previous = 0;
+
     for (int i = 0; i < text->character_count; ++i) {
-        struct glyph *const glyph = text->characters[i].glyph;
+        struct ui_character *const c = text->characters + i;
+        struct glyph *const glyph = c->glyph;
+
+        layout->offsets[i] = cursor;
 
         if (!glyph) {
-            if (text->characters[i].whitespace) {
+            if (c->whitespace) {
                 last_whitespace = i;
-                cursor += DEFAULT_SPACEWIDTH_RATIO*text->glyph_set->height;
+                cursor += DEFAULT_SPACEWIDTH_RATIO*set->height;
                 last_was_whitespace = TRUE;
-            } else if (text->characters[i].new_line) {
-                struct text_row row = {
-                    cursor - trailing,
-                    i
-                };
-
-                list_push(&rows, &row);
+            } else if (c->new_line) {
+                push_row(layout, cursor - trailing, i);
 
                 last_whitespace = 0;
                 cursor = 0;
@@ -149,34 +215,23 @@ static struct list calculate_rows(struct ui_text *text, int max_width)
                 last_was_whitespace = FALSE;
             }
 
+            previous = 0;
+
             continue;
         }
 
+        int kerning = previous ? font_get_kerning(set, previous->code, c->code) : 0;
         int width = glyph->size.x;
 
         if (!last_was_whitespace && cursor)
             width += glyph->bearing.x;
 
-        if (cursor + width > max_width) {
-            // If the cursor is already 0, this text cannot fit period.
-            if (!cursor)
-                return rows;
-
+        if (cursor && cursor + kerning + width > max_width) {
             if (!last_whitespace) {
-                struct text_row row = {
-                    cursor - trailing,
-                    i
-                };
-
-                list_push(&rows, &row);
+                push_row(layout, cursor - trailing, i);
                 --i;
             } else {
-                struct text_row row = {
-                    cursor - trailing,
-                    last_whitespace
-                };
-
-                list_push(&rows, &row);
+                push_row(layout, cursor - trailing, last_whitespace);
 
                 i = last_whitespace;
                 last_whitespace = 0;
@@ -184,61 +239,66 @@ static struct list calculate_rows(struct ui_text *text, int max_width)
 
             cursor = 0;
             trailing = 0;
+            previous = 0;
         } else {
+            cursor += kerning;
+
+            layout->offsets[i] = cursor + width - glyph->size.x;
+
             cursor += glyph->advance;
             trailing = glyph->advance - width;
+            previous = c;
         }
 
         last_was_whitespace = FALSE;
     }
 
-    struct text_row row = {
-        cursor - trailing,
-        text->character_count
-    };
-
-    list_push(&rows, &row);
-
-    return rows;
+    push_row(layout, cursor - trailing, text->character_count);
 }
 
-static int calculate_text_height(struct ui_container *container, struct list *rows)
+// Reuses a cached layout for the same width, replacing the least recently used otherwise.
+static struct ui_text_layout *get_layout(struct ui_text *text, int max_width)
 {
-    int row_count = 0;
+    struct ui_text_layout *layout = text->layouts;
+
+    for (int i = 0; i < UI_TEXT_LAYOUT_CACHE_SIZE; ++i) {
+        struct ui_text_layout *candidate = text->layouts + i;
+
+        if (candidate->valid && candidate->max_width == max_width) {
+            candidate->last_used = ++text->layout_clock;
+            return candidate;
+        }
 
-    list_for_each (int, p_new_line, *rows) {
-        ++row_count;
+        if (!candidate->valid || (layout->valid && candidate->last_used < layout->last_used))
+            layout = candidate;
     }
 
-    int gaps = max(row_count - 1, 0);
+    calculate_layout(text, layout, max_width);
+    layout->last_used = ++text->layout_clock;
 
-    return row_count*(container->ui_text.glyph_set->line_height) + gaps*DEFAULT_LINE_GAP;
+    return layout;
 }
 
-int ui_text_calculate_height(struct ui_container *container)
+static int calculate_text_height(struct ui_container *container, struct ui_text_layout *layout)
 {
-    struct list rows = calculate_rows(&container->ui_text, container->absolute_rect.size.x);
+    int gaps = max(layout->row_count - 1, 0);
 
-    int height = calculate_text_height(container, &rows);
+    return layout->row_count*(container->ui_text.glyph_set->line_height) + gaps*DEFAULT_LINE_GAP;
+}
 
-    list_destroy(&rows);
+int ui_text_calculate_height(struct ui_container *container)
+{
+    struct ui_text_layout *layout = get_layout(
+        &container->ui_text,
+        container->absolute_rect.size.x
+    );
 
-    return height;
+    return calculate_text_height(container, layout);
 }
 
 int ui_text_calculate_min_width(struct ui_container *container)
 {
-    struct list rows = calculate_rows(&container->ui_text, INT_MAX);
-
-    int width;
-    struct text_row *row = list_get_head(&rows);
-
-    if (row)
-        width = row->width;
-
-    list_destroy(&rows);
-
-    return width;
+    return get_layout(&container->ui_text, INT_MAX)->width;
 }
 
 static struct vec2i init_cursor(struct ui_rect *rect, ui_alignment_t alignment, int draw_size)
@@ -262,48 +322,33 @@ static struct vec2i init_cursor(struct ui_rect *rect, ui_alignment_t alignment,
 
 void ui_text_calculate(struct ui_container *container)
 {
-    struct list rows = calculate_rows(&container->ui_text, container->absolute_rect.size.x);
-    struct text_row *row = list_get_head(&rows);
+    struct ui_text *const text = &container->ui_text;
+    struct ui_text_layout *layout = get_layout(text, container->absolute_rect.size.x);
 
     struct ui_rect rect = container->absolute_rect;
     ui_margins_subtract(&rect, &container->margins);
 
-    int draw_size = calculate_text_height(container, &rows);
+    int draw_size = calculate_text_height(container, layout);
 
     struct vec2i cursor = init_cursor(&rect, container->alignment, draw_size);
-    cursor.y += container->ui_text.glyph_set->ascent;
-
-    bool_t last_was_whitespace = TRUE;
+    cursor.y += text->glyph_set->ascent;
 
-    for (int i = 0; i < container->ui_text.character_count; ++i) {
-        struct ui_character *const c = container->ui_text.characters + i;
+    int row = 0;
 
-        if (row && row->width == i) {
-            cursor.x = container->absolute_rect.position.x;
-            cursor.y += container->ui_text.glyph_set->line_height + DEFAULT_LINE_GAP;
-
-            row = list_get_next(row);
+    for (int i = 0; i < text->character_count; ++i) {
+        struct ui_character *const c = text->characters + i;
 
-            if (c->whitespace)
-                continue;
+        if (i == layout->rows[row].end) {
+            cursor.y += text->glyph_set->line_height + DEFAULT_LINE_GAP;
+            ++row;
         }
 
-        if (c->glyph) {
-            c->absolute_rect.position = cursor;
-
-            if (!last_was_whitespace)
-                c->absolute_rect.position.x += c->glyph->bearing.x;
-
-            c->absolute_rect.position.y -= c->glyph->bearing.y;
-
-            cursor.x += c->glyph->advance;
+        if (!c->glyph)
+            continue;
 
-            last_was_whitespace = FALSE;
-        } else if (c->whitespace) {
-            cursor.x += container->ui_text.glyph_set->height*DEFAULT_SPACEWIDTH_RATIO;
-            last_was_whitespace = TRUE;
-        }
+        c->absolute_rect.position = vec2i(
+            cursor.x + layout->offsets[i],
+            cursor.y - c->glyph->bearing.y
+        );
     }
-
-    list_destroy(&rows);
 }
\ No newline at end of file
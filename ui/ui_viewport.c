@@ -1,5 +1,6 @@
 #include <soul/ecs.h>
 #include <soul/callbacks.h>
+#include <soul/scheduler.h>
 #include <soul/ui/ui_viewport.h>
 #include <soul/ui/ui_container.h>
 
@@ -9,6 +10,7 @@ struct callback_data
 {
     struct ecs_service *    ecs;
     struct texture_service *texture_service;
+    int                     container_type;
 };
 
 static void on_resize(struct ui_container *container, struct ui_viewport *viewport)
@@ -26,7 +28,7 @@ static void init(struct entity *entity,
 {
     struct ui_viewport *const viewport = storage.passive;
 
-    viewport->container = component_get_storage(data->ecs, entity, UI_CONTAINER).passive;
+    viewport->container = entity_get_passive(entity, struct ui_container, data->container_type);
     callbacks_insert(&viewport->container->on_resize, (callback_t)&on_resize, viewport);
 
     int width = viewport->container->absolute_rect.size.x;
@@ -68,6 +70,7 @@ void ui_viewport_register_component(struct soul_instance *soul_instance)
 
     callback_data->ecs              = ecs;
     callback_data->texture_service  = resource_get(soul_instance, TEXTURE_SERVICE);
+    callback_data->container_type   = component_match_descriptor(ecs, UI_CONTAINER)->type_id;
 
     struct component_registry_info info = {
         .name                   = UI_VIEWPORT,
@@ -78,11 +81,15 @@ void ui_viewport_register_component(struct soul_instance *soul_instance)
 
     struct component_descriptor *descriptor = component_register(ecs, &info);
 
-    ordered_callbacks_insert(
-        &soul_instance->callbacks,
-        (ordered_callback_t)&clear,
-        EXECUTION_ORDER_PRE_RENDER,
-        &descriptor->passive_storage,
-        FALSE
-    );
+    struct system_registry_info system_info = {
+        .name           = "ui_viewport_clear",
+        .fn             = (system_t)&clear,
+        .data           = &descriptor->passive_storage,
+        .order          = EXECUTION_ORDER_PRE_RENDER,
+        .reads          = (const char *[]){ UI_VIEWPORT },
+        .read_count     = 1,
+        .main_thread    = TRUE
+    };
+
+    system_register(resource_get(soul_instance, SCHEDULER_SERVICE), &system_info);
 }
\ No newline at end of file